@@ -0,0 +1,154 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+
+/**
+ * @brief Log setup
+ *
+ */
+struct flash_log_config
+{
+    /* Dedicated flash area, e.g. FLASH_AREA_ID(log_storage) */
+    uint8_t area_id;
+
+    /* Every record has this size (up to CONFIG_FLASH_LOG_RECORD_MAX) */
+    uint16_t record_size;
+
+    /* Leave erasing the next sector to flash_log_erase_ahead().
+     * Appends only erase inline if it hasn't been called in time. */
+    bool deferred_erase;
+};
+
+/**
+ * @brief Flash operation counters
+ *
+ */
+struct flash_log_stats
+{
+    uint32_t appends;
+    uint32_t bytes_appended;
+    uint32_t bytes_programmed;
+    uint32_t sectors_erased;
+    uint32_t inline_erases;
+    uint32_t corrupt;
+};
+
+/**
+ * @brief Log instance. Treat as opaque.
+ *
+ */
+struct flash_log
+{
+    const struct flash_area *p_fa;
+    struct k_mutex lock;
+
+    size_t sector_size;
+    uint32_t sector_count;
+    size_t hdr_size;
+    size_t slot_size;
+    uint16_t record_size;
+    uint32_t slots_per_sector;
+    bool deferred_erase;
+
+    /* Sector sequence numbers. Sector seq lives in physical sector seq % count. */
+    uint32_t head;
+    uint32_t tail;
+    uint32_t erased;
+
+    /* Next free slot in the head sector */
+    uint32_t head_slot;
+
+    struct flash_log_stats stats;
+
+    uint8_t buf[CONFIG_FLASH_LOG_RECORD_MAX + 8 + CONFIG_FLASH_LOG_WRITE_ALIGN_MAX];
+};
+
+/**
+ * @brief Read position
+ *
+ */
+struct flash_log_cursor
+{
+    uint32_t sector;
+    uint32_t slot;
+};
+
+/**
+ * @brief Opens the log and recovers head and tail from the sector headers
+ *
+ * @param p_log log instance
+ * @param p_config log setup
+ * @return int 0 on success
+ */
+int flash_log_init(struct flash_log *p_log, const struct flash_log_config *p_config);
+
+/**
+ * @brief Appends a record. The oldest sector is dropped when the log is full.
+ *
+ * @param p_log log instance
+ * @param p_data record_size bytes
+ * @return int 0 on success
+ */
+int flash_log_append(struct flash_log *p_log, const void *p_data);
+
+/**
+ * @brief Erases the sector after the head if it's not erased yet. Meant for
+ * a low priority work item when deferred_erase is set.
+ *
+ * @param p_log log instance
+ * @return int 0 on success
+ */
+int flash_log_erase_ahead(struct flash_log *p_log);
+
+/**
+ * @brief Points the cursor at the oldest record
+ *
+ * @param p_log log instance
+ * @param p_cursor cursor
+ */
+void flash_log_cursor_init(struct flash_log *p_log, struct flash_log_cursor *p_cursor);
+
+/**
+ * @brief Reads the record at the cursor and moves it forward. Corrupt
+ * records are skipped.
+ *
+ * @param p_log log instance
+ * @param p_cursor cursor
+ * @param p_data destination with room for record_size bytes
+ * @return int 0 on success. -ENODATA at the head of the log.
+ */
+int flash_log_read(struct flash_log *p_log, struct flash_log_cursor *p_cursor, void *p_data);
+
+/**
+ * @brief Number of records in the log
+ *
+ * @param p_log log instance
+ * @return uint32_t record count
+ */
+uint32_t flash_log_count(struct flash_log *p_log);
+
+/**
+ * @brief Erases the whole log
+ *
+ * @param p_log log instance
+ * @return int 0 on success
+ */
+int flash_log_clear(struct flash_log *p_log);
+
+/**
+ * @brief Flash operation counters since init
+ *
+ * @param p_log log instance
+ * @param p_stats destination
+ */
+void flash_log_stats_get(struct flash_log *p_log, struct flash_log_stats *p_stats);
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FLASH_WEAR_H
+#define FLASH_WEAR_H
+
+#include <zephyr/kernel.h>
+
+#include <lib/stats/histogram.h>
+
+/**
+ * @brief Flash operations that are counted
+ *
+ */
+enum flash_wear_op
+{
+    FLASH_WEAR_READ,
+    FLASH_WEAR_PROGRAM,
+    FLASH_WEAR_ERASE,
+    FLASH_WEAR_OPS,
+};
+
+/**
+ * @brief Counters for one partition. Treat as opaque.
+ *
+ */
+struct flash_wear
+{
+    uint16_t *p_erase_counts;
+    size_t sectors;
+    size_t sector_size;
+
+    /* Per operation */
+    uint64_t bytes[FLASH_WEAR_OPS];
+    uint32_t calls[FLASH_WEAR_OPS];
+    uint32_t errors[FLASH_WEAR_OPS];
+
+    /* Latency (in us) */
+    struct histogram latency[FLASH_WEAR_OPS];
+
+    struct k_spinlock lock;
+};
+
+/**
+ * @brief Erase count spread over the sectors
+ *
+ */
+struct flash_wear_summary
+{
+    uint32_t erases;
+    uint16_t min;
+    uint16_t max;
+
+    /* Average erases per sector x100 */
+    uint32_t avg_x100;
+
+    /* Sectors erased at least once */
+    uint32_t used_sectors;
+};
+
+/**
+ * @brief Sets up counters for a partition
+ *
+ * @param p_wear the instance
+ * @param p_erase_counts one entry per sector
+ * @param sectors number of sectors
+ * @param sector_size erase unit in bytes
+ */
+void flash_wear_init(struct flash_wear *p_wear, uint16_t *p_erase_counts, size_t sectors,
+                     size_t sector_size);
+
+/**
+ * @brief Counts one operation
+ *
+ * @param p_wear the instance
+ * @param op which operation
+ * @param off offset within the partition
+ * @param len length in bytes
+ * @param us how long it took
+ * @param err result of the operation. Failed operations only count as errors.
+ */
+void flash_wear_record(struct flash_wear *p_wear, enum flash_wear_op op, off_t off, size_t len,
+                       uint32_t us, int err);
+
+/**
+ * @brief Summarizes the per sector erase counts
+ *
+ * @param p_wear the instance
+ * @param p_summary filled with the summary
+ */
+void flash_wear_summary_get(struct flash_wear *p_wear, struct flash_wear_summary *p_summary);
+
+/**
+ * @brief Days until the most worn sector reaches its rated cycles at the
+ * rate seen so far
+ *
+ * @param p_summary from flash_wear_summary_get()
+ * @param rated_cycles rated erase cycles per sector
+ * @param elapsed_ms time the counts were collected over
+ * @return uint32_t days left. UINT32_MAX if nothing was erased yet. 0 if worn out.
+ */
+uint32_t flash_wear_endurance_days(const struct flash_wear_summary *p_summary,
+                                   uint32_t rated_cycles, int64_t elapsed_ms);
+
+/**
+ * @brief Adds erase counts from before (e.g. saved across a reset)
+ *
+ * @param p_wear the instance
+ * @param first first sector
+ * @param p_counts one entry per sector
+ * @param count number of sectors. Sectors past the end are ignored.
+ */
+void flash_wear_erase_counts_add(struct flash_wear *p_wear, size_t first, const uint16_t *p_counts,
+                                 size_t count);
+
+/**
+ * @brief Copies erase counts out, e.g. to save them
+ *
+ * @param p_wear the instance
+ * @param first first sector
+ * @param p_counts filled with one entry per sector
+ * @param count number of sectors wanted
+ * @return size_t number of sectors copied
+ */
+size_t flash_wear_erase_counts_get(struct flash_wear *p_wear, size_t first, uint16_t *p_counts,
+                                   size_t count);
+
+/**
+ * @brief Clears every counter
+ *
+ * @param p_wear the instance
+ */
+void flash_wear_reset(struct flash_wear *p_wear);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef GNSS_FILTER_H
+#define GNSS_FILTER_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief A single GNSS measurement in fixed point
+ *
+ */
+struct gnss_filter_meas
+{
+    /* Time of the measurement in ms */
+    int64_t ts;
+
+    /* Position in 1e-7 degrees */
+    int32_t lat_e7;
+    int32_t lng_e7;
+
+    /* Reported horizontal accuracy in cm */
+    uint32_t accuracy_cm;
+
+    /* Satellites used in the fix */
+    uint8_t sats_used;
+};
+
+/**
+ * @brief Filtered position
+ *
+ */
+struct gnss_filter_fix
+{
+    int64_t ts;
+    int32_t lat_e7;
+    int32_t lng_e7;
+
+    /* Estimated accuracy of the filtered position in cm */
+    uint32_t accuracy_cm;
+};
+
+/**
+ * @brief Filter tuning
+ *
+ */
+struct gnss_filter_config
+{
+    /* Measurements implying a higher speed than this are rejected (cm/s) */
+    uint32_t max_speed_cm_s;
+
+    /* Expected change in speed between measurements (cm/s per second) */
+    uint32_t accel_sigma_cm_s2;
+
+    /* Measurements further apart than this restart the filter (ms) */
+    uint32_t max_gap_ms;
+
+    /* Consecutive rejections before the filter gives up and restarts */
+    uint8_t max_rejects;
+};
+
+/**
+ * @brief Result of an update
+ *
+ */
+enum gnss_filter_result
+{
+    GNSS_FILTER_ACCEPTED,
+    GNSS_FILTER_REJECTED,
+    GNSS_FILTER_RESET,
+};
+
+/**
+ * @brief Filter context. Owned by the caller.
+ *
+ */
+struct gnss_filter
+{
+    struct gnss_filter_config config;
+
+    bool valid;
+    int64_t ts;
+
+    /* Position (1e-7 deg) and velocity (1e-7 deg/s) */
+    int32_t lat_e7;
+    int32_t lng_e7;
+    int32_t lat_vel_e7;
+    int32_t lng_vel_e7;
+
+    /* Position variance in cm^2 */
+    int64_t var_cm2;
+
+    /* cos(latitude) in Q15 for east-west distances */
+    int32_t cos_lat_q15;
+
+    uint8_t rejects;
+};
+
+/**
+ * @brief Initialize (or reset) a filter
+ *
+ * @param p_ctx pointer to the context
+ * @param p_config filter tuning
+ */
+void gnss_filter_init(struct gnss_filter *p_ctx, const struct gnss_filter_config *p_config);
+
+/**
+ * @brief Runs a new measurement through the filter
+ *
+ * Measurements are weighted by their accuracy and satellite count. Ones that
+ * imply an impossible speed are rejected and don't change the filter state.
+ *
+ * @param p_ctx pointer to the context
+ * @param p_meas the new measurement
+ * @return enum gnss_filter_result
+ */
+enum gnss_filter_result gnss_filter_update(struct gnss_filter *p_ctx,
+                                           const struct gnss_filter_meas *p_meas);
+
+/**
+ * @brief Get the current filtered position
+ *
+ * @param p_ctx pointer to the context
+ * @param p_fix where the filtered position is copied to
+ * @return int 0 on success. -ENODATA if there haven't been any measurements.
+ */
+int gnss_filter_get(struct gnss_filter *p_ctx, struct gnss_filter_fix *p_fix);
+
+#endif
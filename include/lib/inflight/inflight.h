@@ -0,0 +1,217 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INFLIGHT_H
+#define INFLIGHT_H
+
+#include <zephyr/kernel.h>
+
+#include <lib/stats/histogram.h>
+
+/**
+ * @brief Sends one attempt of a request. Called without the table lock held,
+ * so it may take transport locks that are also held around inflight_complete().
+ *
+ * @param id pass back to inflight_complete() with the result
+ * @param p_topic the topic
+ * @param kind what to do with it. Opaque to the table.
+ * @param p_data the payload
+ * @param len length of the payload
+ * @param p_user user pointer from init
+ * @return int 0 if the attempt went out. An error counts as a failed attempt.
+ */
+typedef int (*inflight_send_t)(uint32_t id, const char *p_topic, uint8_t kind,
+                               const uint8_t *p_data, size_t len, void *p_user);
+
+/**
+ * @brief Called with the result of every attempt that went out
+ *
+ * @param p_topic the topic
+ * @param kind from inflight_submit()
+ * @param err 0 if acknowledged. -ETIMEDOUT if there was no result in time.
+ * @param ms time since the request was submitted
+ * @param p_user user pointer from init
+ */
+typedef void (*inflight_result_t)(const char *p_topic, uint8_t kind, int err, uint32_t ms,
+                                  void *p_user);
+
+/**
+ * @brief Called once a request ran out of attempts. The payload is only
+ * valid during the call.
+ *
+ * @param p_topic the topic
+ * @param kind from inflight_submit()
+ * @param p_data the payload
+ * @param len length of the payload
+ * @param err result of the last attempt
+ * @param p_user user pointer from init
+ */
+typedef void (*inflight_fail_t)(const char *p_topic, uint8_t kind, const uint8_t *p_data,
+                                size_t len, int err, void *p_user);
+
+/**
+ * @brief Timeouts and retries
+ *
+ */
+struct inflight_config
+{
+    /* Time to wait for the result of an attempt */
+    uint32_t timeout_ms;
+
+    /* Delay after the first failure. Doubles up to backoff_max_ms. */
+    uint32_t backoff_min_ms;
+    uint32_t backoff_max_ms;
+
+    /* Attempts before the request is handed to the fail callback */
+    uint8_t max_attempts;
+};
+
+/**
+ * @brief Request counters
+ *
+ */
+struct inflight_stats
+{
+    uint32_t submitted;
+    uint32_t acked;
+    uint32_t retries;
+    uint32_t timeouts;
+    uint32_t failed;
+
+    /* Turned away because every slot was taken */
+    uint32_t window_full;
+
+    /* Results for attempts that had already timed out */
+    uint32_t late;
+
+    /* Submit (first attempt) to ack in ms */
+    struct histogram latency;
+};
+
+/**
+ * @brief State of a slot
+ *
+ */
+enum inflight_state
+{
+    INFLIGHT_FREE,
+    INFLIGHT_PENDING,
+    INFLIGHT_BACKOFF,
+};
+
+/**
+ * @brief One outstanding request
+ *
+ */
+struct inflight_slot
+{
+    char topic[CONFIG_INFLIGHT_TOPIC_LEN];
+    uint8_t *p_buf;
+    size_t len;
+    uint32_t id;
+    uint8_t kind;
+    uint8_t state;
+    uint8_t attempts;
+    int64_t submitted_ms;
+
+    /* Timeout while pending, next attempt while backing off */
+    int64_t due_ms;
+};
+
+/**
+ * @brief In-flight table. Treat as opaque.
+ *
+ */
+struct inflight
+{
+    struct inflight_slot slots[CONFIG_INFLIGHT_WINDOW];
+    size_t slot_size;
+    struct inflight_config config;
+    inflight_send_t send;
+    inflight_result_t result;
+    inflight_fail_t fail;
+    void *p_user;
+    uint32_t next_id;
+    struct inflight_stats stats;
+    struct k_mutex lock;
+};
+
+/**
+ * @brief Sets up a table. The memory is split evenly between the slots.
+ *
+ * @param p_table table instance
+ * @param p_mem backing memory for the payloads
+ * @param size size of the backing memory
+ * @param p_config timeouts and retries
+ * @param send called for every attempt
+ * @param result called with the result of every attempt (optional)
+ * @param fail called for requests that ran out of attempts
+ * @param p_user passed to all three
+ */
+void inflight_init(struct inflight *p_table, uint8_t *p_mem, size_t size,
+                   const struct inflight_config *p_config, inflight_send_t send,
+                   inflight_result_t result, inflight_fail_t fail, void *p_user);
+
+/**
+ * @brief Copies a request into a free slot and makes the first attempt
+ *
+ * @param p_table table instance
+ * @param p_topic the topic
+ * @param kind passed to send and fail
+ * @param p_data the payload
+ * @param len length of the payload
+ * @param now_ms current time in ms
+ * @return int 0 when the request was taken. The error of the first attempt
+ * if it failed right away, in which case the table doesn't keep it. -EBUSY
+ * if the window is full. -EMSGSIZE if it never fits.
+ */
+int inflight_submit(struct inflight *p_table, const char *p_topic, uint8_t kind,
+                    const uint8_t *p_data, size_t len, int64_t now_ms);
+
+/**
+ * @brief Result of an attempt. A failure backs off and retries.
+ *
+ * @param p_table table instance
+ * @param id from the send callback
+ * @param err 0 if acknowledged
+ * @param now_ms current time in ms
+ */
+void inflight_complete(struct inflight *p_table, uint32_t id, int err, int64_t now_ms);
+
+/**
+ * @brief Times out attempts without a result and retries the ones whose
+ * backoff is over
+ *
+ * @param p_table table instance
+ * @param now_ms current time in ms
+ */
+void inflight_poll(struct inflight *p_table, int64_t now_ms);
+
+/**
+ * @brief When inflight_poll() has something to do next
+ *
+ * @param p_table table instance
+ * @return int64_t time in ms. INT64_MAX if the table is empty.
+ */
+int64_t inflight_deadline(struct inflight *p_table);
+
+/**
+ * @brief Number of requests in the table
+ *
+ * @param p_table table instance
+ * @return size_t request count
+ */
+size_t inflight_count(struct inflight *p_table);
+
+/**
+ * @brief Request counters
+ *
+ * @param p_table table instance
+ * @param p_stats destination
+ */
+void inflight_stats_get(struct inflight *p_table, struct inflight_stats *p_stats);
+
+#endif
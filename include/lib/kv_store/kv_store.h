@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/storage/flash_map.h>
+
+/* Counters use NVS ids from here up. Plain values use the ids below it. */
+#define KV_STORE_COUNTER_ID_BASE 0x8000
+
+/**
+ * @brief Operation counters
+ *
+ */
+struct kv_store_stats
+{
+    uint32_t writes;
+    uint32_t unchanged;
+    uint32_t counter_reads;
+    uint32_t bytes_written;
+};
+
+/**
+ * @brief Store instance. Treat as opaque.
+ *
+ */
+struct kv_store
+{
+    struct nvs_fs fs;
+    struct k_mutex lock;
+    uint32_t counters[CONFIG_KV_STORE_COUNTERS];
+    struct kv_store_stats stats;
+};
+
+/**
+ * @brief Mounts NVS on a dedicated flash area and loads every counter into RAM
+ *
+ * @param p_kv store instance
+ * @param area_id flash area, e.g. FLASH_AREA_ID(nvs_storage)
+ * @return int 0 on success
+ */
+int kv_store_init(struct kv_store *p_kv, uint8_t area_id);
+
+/**
+ * @brief Reads a value
+ *
+ * @param p_kv store instance
+ * @param id below KV_STORE_COUNTER_ID_BASE
+ * @param p_data destination
+ * @param len size of the destination
+ * @return ssize_t length of the stored value. -ENOENT if it was never written.
+ */
+ssize_t kv_store_read(struct kv_store *p_kv, uint16_t id, void *p_data, size_t len);
+
+/**
+ * @brief Writes a value. Unchanged values aren't written again.
+ *
+ * @param p_kv store instance
+ * @param id below KV_STORE_COUNTER_ID_BASE
+ * @param p_data value
+ * @param len length of the value
+ * @return int 0 on success
+ */
+int kv_store_write(struct kv_store *p_kv, uint16_t id, const void *p_data, size_t len);
+
+/**
+ * @brief Current counter value. Served from RAM.
+ *
+ * @param p_kv store instance
+ * @param idx counter index (below CONFIG_KV_STORE_COUNTERS)
+ * @return uint32_t the value. 0 if it was never written.
+ */
+uint32_t kv_store_counter_get(struct kv_store *p_kv, uint8_t idx);
+
+/**
+ * @brief Adds to a counter. One NVS append, no read.
+ *
+ * @param p_kv store instance
+ * @param idx counter index (below CONFIG_KV_STORE_COUNTERS)
+ * @param delta added to the counter
+ * @return int 0 on success
+ */
+int kv_store_counter_add(struct kv_store *p_kv, uint8_t idx, uint32_t delta);
+
+/**
+ * @brief Erases everything
+ *
+ * @param p_kv store instance
+ * @return int 0 on success. The store must be initialized again.
+ */
+int kv_store_clear(struct kv_store *p_kv);
+
+/**
+ * @brief Operation counters
+ *
+ * @param p_kv store instance
+ * @param p_stats destination
+ */
+void kv_store_stats_get(struct kv_store *p_kv, struct kv_store_stats *p_stats);
+
+#endif
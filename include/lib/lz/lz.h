@@ -0,0 +1,51 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <zephyr/kernel.h>
+
+/* Largest output for len bytes of input. Incompressible data grows by a
+ * control byte every 8 bytes. */
+#define LZ_BOUND(len) ((len) + ((len) + 7) / 8)
+
+/**
+ * @brief Compressor state. No heap. Keep it static, it's
+ * 2^CONFIG_LZ_HASH_BITS * 2 bytes.
+ *
+ */
+struct lz_ctx
+{
+    uint16_t table[1 << CONFIG_LZ_HASH_BITS];
+};
+
+/**
+ * @brief Compresses a buffer (LZSS, 4 KB window)
+ *
+ * @param p_ctx compressor state
+ * @param p_in input
+ * @param in_len length of the input (up to 65535 bytes)
+ * @param p_out output
+ * @param out_size size of the output buffer
+ * @return int compressed length. -ENOSPC if it doesn't fit.
+ */
+int lz_compress(struct lz_ctx *p_ctx, const uint8_t *p_in, size_t in_len,
+                uint8_t *p_out, size_t out_size);
+
+/**
+ * @brief Decompresses a buffer
+ *
+ * @param p_in compressed input
+ * @param in_len length of the input
+ * @param p_out output
+ * @param out_size size of the output buffer
+ * @return int decompressed length. -ENOSPC if it doesn't fit, -EINVAL if
+ * the input is corrupt.
+ */
+int lz_decompress(const uint8_t *p_in, size_t in_len, uint8_t *p_out, size_t out_size);
+
+#endif
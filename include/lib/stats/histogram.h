@@ -0,0 +1,79 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <zephyr/kernel.h>
+
+/* Upper limit of buckets in a histogram (including the overflow bucket) */
+#define HISTOGRAM_MAX_BUCKETS 16
+
+/**
+ * @brief Fixed size histogram
+ *
+ * Bucket i counts values <= bounds[i] (and above the previous bound).
+ * The last bucket counts everything above the largest bound.
+ */
+struct histogram
+{
+    const int32_t *p_bounds;
+    uint8_t bounds_count;
+    uint32_t counts[HISTOGRAM_MAX_BUCKETS];
+};
+
+/**
+ * @brief Static initializer for a histogram with ascending bounds
+ *
+ */
+#define HISTOGRAM_INITIALIZER(_bounds)          \
+    {                                           \
+        .p_bounds = _bounds,                    \
+        .bounds_count = ARRAY_SIZE(_bounds),    \
+    }
+
+/**
+ * @brief Adds a value to the histogram
+ *
+ * @param p_hist pointer to the histogram
+ * @param val the value
+ */
+void histogram_add(struct histogram *p_hist, int32_t val);
+
+/**
+ * @brief Clears all counts
+ *
+ * @param p_hist pointer to the histogram
+ */
+void histogram_reset(struct histogram *p_hist);
+
+/**
+ * @brief Number of buckets (bounds + overflow)
+ *
+ * @param p_hist pointer to the histogram
+ * @return size_t bucket count
+ */
+size_t histogram_buckets(const struct histogram *p_hist);
+
+/**
+ * @brief Total number of values added
+ *
+ * @param p_hist pointer to the histogram
+ * @return uint32_t total count
+ */
+uint32_t histogram_total(const struct histogram *p_hist);
+
+/**
+ * @brief Upper bound of the bucket containing the given percentile
+ *
+ * @param p_hist pointer to the histogram
+ * @param pct percentile (0-100)
+ * @return int32_t the bucket bound. INT32_MAX if it's in the overflow bucket.
+ * 0 if the histogram is empty.
+ */
+int32_t histogram_percentile(const struct histogram *p_hist, uint8_t pct);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief A single point of a track
+ *
+ */
+struct track_simplify_point
+{
+    /* Time of the fix in ms */
+    int64_t ts;
+
+    /* Position in degrees */
+    double lat;
+    double lng;
+};
+
+/**
+ * @brief Result of pushing a point through the simplifier
+ *
+ */
+enum track_simplify_result
+{
+    /* Point is held. Nothing needs to be sent. */
+    TRACK_SIMPLIFY_HOLD,
+    /* The pushed point starts the track and should be sent */
+    TRACK_SIMPLIFY_EMIT_CURRENT,
+    /* The previously pushed point is a vertex of the track and should be sent */
+    TRACK_SIMPLIFY_EMIT_PREVIOUS,
+};
+
+/**
+ * @brief Simplification statistics
+ *
+ */
+struct track_simplify_stats
+{
+    /* Points pushed into the simplifier */
+    uint32_t points_in;
+
+    /* Points that were emitted as vertices */
+    uint32_t points_out;
+
+    /* Points dropped from the reconstructed path */
+    uint32_t points_dropped;
+
+    /* Largest distance between a dropped point and the reconstructed path (m) */
+    float max_error_m;
+
+    /* Sum of all dropped point errors (m). Used for the mean. */
+    float sum_error_m;
+};
+
+/**
+ * @brief Simplifier context. Owned by the caller.
+ *
+ */
+struct track_simplify
+{
+    /* Allowed distance between dropped points and the reconstructed path (m) */
+    float tolerance_m;
+
+    /* Maximum time a point can be held before it's emitted anyway (ms). 0 to disable */
+    int64_t max_hold_ms;
+
+    /* Last emitted point */
+    struct track_simplify_point anchor;
+    bool has_anchor;
+
+    /* Points received since the anchor. The last one is the candidate vertex. */
+    struct track_simplify_point pending[CONFIG_TRACK_SIMPLIFY_WINDOW];
+    size_t pending_count;
+
+    struct track_simplify_stats stats;
+};
+
+/**
+ * @brief Initialize (or reset) a simplifier context
+ *
+ * @param p_ctx pointer to the context
+ * @param tolerance_m error bound in meters
+ * @param max_hold_ms maximum time between emitted points in ms. 0 to disable.
+ */
+void track_simplify_init(struct track_simplify *p_ctx, float tolerance_m, int64_t max_hold_ms);
+
+/**
+ * @brief Push a new point through the simplifier
+ *
+ * A point is only passed through once it's known to change the reconstructed
+ * path. That means the emitted point is usually the one pushed before the
+ * current one.
+ *
+ * @param p_ctx pointer to the context
+ * @param p_point the new point
+ * @return enum track_simplify_result which point (if any) should be sent
+ */
+enum track_simplify_result track_simplify_push(struct track_simplify *p_ctx,
+                                               const struct track_simplify_point *p_point);
+
+/**
+ * @brief Emit the held candidate point (if any)
+ *
+ * Used when the track ends (i.e. the device stops moving or GPS times out)
+ *
+ * @param p_ctx pointer to the context
+ * @return true the last pushed point should be sent
+ * @return false nothing held
+ */
+bool track_simplify_flush(struct track_simplify *p_ctx);
+
+/**
+ * @brief Get the simplification statistics
+ *
+ * @param p_ctx pointer to the context
+ * @param p_stats where the stats are copied to
+ */
+void track_simplify_stats_get(struct track_simplify *p_ctx, struct track_simplify_stats *p_stats);
+
+#endif
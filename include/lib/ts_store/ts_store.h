@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TS_STORE_H
+#define TS_STORE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+
+/* Room for "<dir>/<16 hex digits>.x" */
+#define TS_STORE_PATH_MAX 48
+
+/* Records don't cross blocks. Each one has a timestamp and a length. */
+#define TS_STORE_RECORD_MAX (CONFIG_TS_STORE_BLOCK_SIZE - sizeof(int64_t) - sizeof(uint16_t))
+
+/**
+ * @brief Called for every record in a range query
+ *
+ * @param ts timestamp of the record
+ * @param p_data record data
+ * @param len length of the record
+ * @param p_user user pointer passed to the query
+ * @return int 0 to continue. Anything else stops the query.
+ */
+typedef int (*ts_store_cb_t)(int64_t ts, const uint8_t *p_data, size_t len, void *p_user);
+
+/**
+ * @brief Store setup
+ *
+ */
+struct ts_store_config
+{
+    /* Existing directory, e.g. "/lfs/ts" */
+    const char *p_dir;
+
+    /* Blocks per segment file before a new one is started */
+    uint16_t segment_blocks;
+
+    /* Oldest segment is deleted beyond this (up to CONFIG_TS_STORE_MAX_SEGMENTS) */
+    uint16_t max_segments;
+};
+
+/**
+ * @brief Store counters
+ *
+ */
+struct ts_store_stats
+{
+    uint32_t appends;
+    uint32_t segments_deleted;
+    uint32_t pad_bytes;
+    uint32_t blocks_read;
+    uint32_t index_reads;
+};
+
+/**
+ * @brief Store instance. Treat as opaque.
+ *
+ */
+struct ts_store
+{
+    struct ts_store_config config;
+    struct k_mutex lock;
+
+    /* First timestamp of every segment, oldest first */
+    int64_t segments[CONFIG_TS_STORE_MAX_SEGMENTS];
+    uint16_t segment_count;
+
+    /* Newest segment */
+    struct fs_file_t file;
+    bool file_open;
+    uint32_t head_off;
+    uint32_t indexed_blocks;
+    int64_t last_ts;
+
+    struct ts_store_stats stats;
+
+    char path[TS_STORE_PATH_MAX];
+    uint8_t block[CONFIG_TS_STORE_BLOCK_SIZE];
+};
+
+/**
+ * @brief Opens the store and recovers the newest segment
+ *
+ * @param p_store store instance
+ * @param p_config store setup
+ * @return int 0 on success
+ */
+int ts_store_init(struct ts_store *p_store, const struct ts_store_config *p_config);
+
+/**
+ * @brief Closes the newest segment. Call before init is used again.
+ *
+ * @param p_store store instance
+ * @return int 0 on success
+ */
+int ts_store_close(struct ts_store *p_store);
+
+/**
+ * @brief Appends a record. Timestamps must not go backwards.
+ *
+ * @param p_store store instance
+ * @param ts timestamp of the record
+ * @param p_data record data
+ * @param len length of the record
+ * @return int 0 on success. -EINVAL if ts is older than the last record.
+ */
+int ts_store_append(struct ts_store *p_store, int64_t ts, const void *p_data, size_t len);
+
+/**
+ * @brief Commits appended records to flash
+ *
+ * @param p_store store instance
+ * @return int 0 on success
+ */
+int ts_store_sync(struct ts_store *p_store);
+
+/**
+ * @brief Calls cb for every record with from <= ts <= to, oldest first
+ *
+ * @param p_store store instance
+ * @param from start of the range
+ * @param to end of the range
+ * @param cb called for every record
+ * @param p_user passed to cb
+ * @return int number of records or negative error
+ */
+int ts_store_query(struct ts_store *p_store, int64_t from, int64_t to, ts_store_cb_t cb, void *p_user);
+
+/**
+ * @brief Deletes all segments
+ *
+ * @param p_store store instance
+ * @return int 0 on success
+ */
+int ts_store_clear(struct ts_store *p_store);
+
+/**
+ * @brief Store counters since init
+ *
+ * @param p_store store instance
+ * @param p_stats destination
+ */
+void ts_store_stats_get(struct ts_store *p_store, struct ts_store_stats *p_stats);
+
+#endif
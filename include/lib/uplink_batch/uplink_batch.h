@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef UPLINK_BATCH_H
+#define UPLINK_BATCH_H
+
+#include <zephyr/kernel.h>
+
+/* Room kept in front of each topic's records for the CBOR array header */
+#define UPLINK_BATCH_HEADER 3
+
+/* Records of this class send every batch right away */
+#define UPLINK_BATCH_PRIO_URGENT 0
+
+/* For records that never expire */
+#define UPLINK_BATCH_NO_DEADLINE INT64_MAX
+
+/**
+ * @brief Why a batch was sent
+ *
+ */
+enum uplink_batch_reason
+{
+    UPLINK_BATCH_FLUSH_SIZE,
+    UPLINK_BATCH_FLUSH_AGE,
+    UPLINK_BATCH_FLUSH_URGENT,
+    UPLINK_BATCH_FLUSH_MANUAL,
+    UPLINK_BATCH_FLUSH_REASONS,
+};
+
+/**
+ * @brief Sends one topic's batch
+ *
+ * @param p_topic the topic
+ * @param p_packed the records as one CBOR array. Each record must be a
+ * single CBOR item.
+ * @param len length of the array
+ * @param p_latest the newest record on its own
+ * @param latest_len length of the newest record
+ * @param records number of records in the array
+ * @param p_user user pointer from init
+ * @return int 0 on success. The records are kept on failure.
+ */
+typedef int (*uplink_batch_send_t)(const char *p_topic, const uint8_t *p_packed, size_t len,
+                                   const uint8_t *p_latest, size_t latest_len, uint16_t records,
+                                   void *p_user);
+
+/**
+ * @brief Called with the oldest records of a batch once their deadline has
+ * passed. The rest of the batch keeps waiting. The records are dropped
+ * after the call.
+ *
+ * @param p_topic the topic
+ * @param prio the batch's class
+ * @param p_packed the expired records as one CBOR array
+ * @param len length of the array
+ * @param p_latest the newest record on its own
+ * @param latest_len length of the newest record
+ * @param records number of records in the array
+ * @param p_user user pointer from init
+ */
+typedef void (*uplink_batch_expired_t)(const char *p_topic, uint8_t prio, const uint8_t *p_packed,
+                                       size_t len, const uint8_t *p_latest, size_t latest_len,
+                                       uint16_t records, void *p_user);
+
+/**
+ * @brief Batch counters
+ *
+ */
+struct uplink_batch_stats
+{
+    uint32_t records;
+    uint32_t uplinks;
+    uint32_t bytes;
+    uint32_t send_errors;
+
+    /* Records handed to the expired callback */
+    uint32_t expired;
+
+    uint32_t reasons[UPLINK_BATCH_FLUSH_REASONS];
+};
+
+/**
+ * @brief Where a record ends and when it expires
+ *
+ */
+struct uplink_batch_record
+{
+    int64_t deadline_ms;
+    uint16_t end;
+};
+
+/**
+ * @brief Records waiting for one topic
+ *
+ */
+struct uplink_batch_slot
+{
+    char topic[CONFIG_UPLINK_BATCH_TOPIC_LEN];
+    uint8_t *p_buf;
+    size_t used;
+    uint16_t count;
+    int64_t first_ms;
+    struct uplink_batch_record records[CONFIG_UPLINK_BATCH_RECORDS];
+
+    /* Most important class and earliest deadline of the records */
+    uint8_t prio;
+    int64_t deadline_ms;
+};
+
+/**
+ * @brief Batch instance. Treat as opaque.
+ *
+ */
+struct uplink_batch
+{
+    struct uplink_batch_slot slots[CONFIG_UPLINK_BATCH_TOPICS];
+    size_t slot_size;
+    uint32_t max_age_ms;
+    uplink_batch_send_t send;
+    uplink_batch_expired_t expired;
+    void *p_user;
+    struct uplink_batch_stats stats;
+    struct k_mutex lock;
+};
+
+/**
+ * @brief Sets up a batch. The memory is split evenly between the topics.
+ *
+ * @param p_batch batch instance
+ * @param p_mem backing memory
+ * @param size size of the backing memory
+ * @param max_age_ms oldest record age before uplink_batch_poll() sends
+ * @param send called with each topic's records
+ * @param expired called with batches that missed their deadline (optional)
+ * @param p_user passed to both
+ */
+void uplink_batch_init(struct uplink_batch *p_batch, uint8_t *p_mem, size_t size,
+                       uint32_t max_age_ms, uplink_batch_send_t send,
+                       uplink_batch_expired_t expired, void *p_user);
+
+/**
+ * @brief Adds a record to its topic's batch. Sends the batch first if the
+ * record doesn't fit.
+ *
+ * @param p_batch batch instance
+ * @param p_topic the topic
+ * @param p_data one encoded CBOR item
+ * @param len length of the record
+ * @param prio class, lower goes first. UPLINK_BATCH_PRIO_URGENT sends every
+ * batch right away (the radio is woken up anyway).
+ * @param deadline_ms time the record is no longer worth sending live. If
+ * it's still waiting by then it goes to the expired callback instead, along
+ * with the older records of the batch.
+ * UPLINK_BATCH_NO_DEADLINE if never.
+ * @param now_ms current time in ms
+ * @return int 0 when the record was taken. -ENOSPC if every topic slot is
+ * in use. -EMSGSIZE if it never fits. Otherwise the send error.
+ */
+int uplink_batch_put(struct uplink_batch *p_batch, const char *p_topic, const uint8_t *p_data,
+                     size_t len, uint8_t prio, int64_t deadline_ms, int64_t now_ms);
+
+/**
+ * @brief Sends every non-empty batch by class, then deadline. Stops at the
+ * first error so a short window isn't spent on less important batches.
+ *
+ * @param p_batch batch instance
+ * @param reason why, for the counters
+ * @return int 0 on success. The send error otherwise.
+ */
+int uplink_batch_flush(struct uplink_batch *p_batch, enum uplink_batch_reason reason);
+
+/**
+ * @brief Hands the records past their deadline to the expired callback and
+ * sends the batches whose oldest record is older than max_age_ms
+ *
+ * @param p_batch batch instance
+ * @param now_ms current time in ms
+ * @return int 0 on success
+ */
+int uplink_batch_poll(struct uplink_batch *p_batch, int64_t now_ms);
+
+/**
+ * @brief When the next batch is due by age or deadline
+ *
+ * @param p_batch batch instance
+ * @return int64_t time in ms. INT64_MAX if nothing is waiting.
+ */
+int64_t uplink_batch_deadline(struct uplink_batch *p_batch);
+
+/**
+ * @brief Earliest deadline of the waiting batches. What a retry timer needs
+ * while batches that are due by age can't be sent.
+ *
+ * @param p_batch batch instance
+ * @return int64_t time in ms. INT64_MAX if no batch has a deadline.
+ */
+int64_t uplink_batch_expiry(struct uplink_batch *p_batch);
+
+/**
+ * @brief Batch counters
+ *
+ * @param p_batch batch instance
+ * @param p_stats destination
+ */
+void uplink_batch_stats_get(struct uplink_batch *p_batch, struct uplink_batch_stats *p_stats);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef UPLINK_FRAME_H
+#define UPLINK_FRAME_H
+
+#include <zephyr/kernel.h>
+
+/* First byte of every frame */
+#define UPLINK_FRAME_VERSION 1
+
+/* Record lengths are 1 byte below 128, 2 bytes up to this */
+#define UPLINK_FRAME_RECORD_MAX 0x3fff
+
+/* Largest frame for one record of len bytes */
+#define UPLINK_FRAME_BOUND(len) (1 + 2 + (len))
+
+/**
+ * @brief Several records packed into one transmit. A version byte, then
+ * every record behind its length (LEB128). Treat as opaque.
+ *
+ */
+struct uplink_frame
+{
+    uint8_t *p_buf;
+    size_t size;
+    size_t used;
+    uint16_t count;
+};
+
+/**
+ * @brief Sets up an empty frame
+ *
+ * @param p_frame frame instance
+ * @param p_buf backing memory
+ * @param size size of the backing memory
+ */
+void uplink_frame_init(struct uplink_frame *p_frame, uint8_t *p_buf, size_t size);
+
+/**
+ * @brief Empties the frame, usually after it was sent
+ *
+ * @param p_frame frame instance
+ */
+void uplink_frame_reset(struct uplink_frame *p_frame);
+
+/**
+ * @brief Appends a record
+ *
+ * @param p_frame frame instance
+ * @param p_data the record
+ * @param len length of the record
+ * @return int 0 on success. -ENOSPC if it doesn't fit what's left (send and
+ * reset first). -EMSGSIZE if it never fits.
+ */
+int uplink_frame_add(struct uplink_frame *p_frame, const uint8_t *p_data, size_t len);
+
+/**
+ * @brief Walks the records of a frame without a copy
+ *
+ * @param p_buf the frame
+ * @param len length of the frame
+ * @param p_offset where to continue. Start at 0.
+ * @param pp_record set to the record
+ * @param p_record_len set to the length of the record
+ * @return int 0 with a record. -ENOENT after the last one. -EBADMSG if the
+ * frame is corrupt or of another version.
+ */
+int uplink_frame_next(const uint8_t *p_buf, size_t len, size_t *p_offset,
+                      const uint8_t **pp_record, size_t *p_record_len);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef WRITE_BUFFER_H
+#define WRITE_BUFFER_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Why a buffer was flushed
+ *
+ */
+enum write_buffer_reason
+{
+    WRITE_BUFFER_FLUSH_SIZE,
+    WRITE_BUFFER_FLUSH_AGE,
+    WRITE_BUFFER_FLUSH_BATTERY,
+    WRITE_BUFFER_FLUSH_RESET,
+    WRITE_BUFFER_FLUSH_READ,
+    WRITE_BUFFER_FLUSH_REASONS,
+};
+
+/**
+ * @brief Writes out the buffered records in one go
+ *
+ * @param p_data framed records. Walk them with write_buffer_next().
+ * @param len length of the data
+ * @param p_done set to where the records that are dealt with end (written
+ * out, or rejected for good). They're dropped even on failure.
+ * @param p_user user pointer from init
+ * @return int 0 on success. The records past p_done are kept on failure.
+ */
+typedef int (*write_buffer_flush_t)(const uint8_t *p_data, size_t len, size_t *p_done,
+                                    void *p_user);
+
+/**
+ * @brief Buffer counters
+ *
+ */
+struct write_buffer_stats
+{
+    uint32_t records;
+    uint32_t flushes;
+    uint32_t bytes_flushed;
+    uint32_t flush_errors;
+    uint32_t reasons[WRITE_BUFFER_FLUSH_REASONS];
+};
+
+/**
+ * @brief Buffer instance. Treat as opaque.
+ *
+ */
+struct write_buffer
+{
+    uint8_t *p_buf;
+    size_t size;
+    size_t used;
+    int64_t first_ms;
+    uint32_t max_age_ms;
+    write_buffer_flush_t flush;
+    void *p_user;
+    struct write_buffer_stats stats;
+    struct k_mutex lock;
+};
+
+/**
+ * @brief Sets up a buffer. Size it to a multiple of the flash program block
+ * so flushes line up with it.
+ *
+ * @param p_wb buffer instance
+ * @param p_buf backing memory
+ * @param size size of the backing memory
+ * @param max_age_ms oldest record age before write_buffer_poll() flushes
+ * @param flush called with the buffered records
+ * @param p_user passed to flush
+ */
+void write_buffer_init(struct write_buffer *p_wb, uint8_t *p_buf, size_t size, uint32_t max_age_ms,
+                       write_buffer_flush_t flush, void *p_user);
+
+/**
+ * @brief Buffers a record. Flushes first if it doesn't fit.
+ *
+ * @param p_wb buffer instance
+ * @param p_data record
+ * @param len length of the record
+ * @param now_ms current time in ms
+ * @return int 0 on success
+ */
+int write_buffer_put(struct write_buffer *p_wb, const void *p_data, size_t len, int64_t now_ms);
+
+/**
+ * @brief Writes out whatever is buffered
+ *
+ * @param p_wb buffer instance
+ * @param reason why, for the counters
+ * @return int 0 on success
+ */
+int write_buffer_flush(struct write_buffer *p_wb, enum write_buffer_reason reason);
+
+/**
+ * @brief Flushes if the oldest record is older than max_age_ms
+ *
+ * @param p_wb buffer instance
+ * @param now_ms current time in ms
+ * @return int 0 on success
+ */
+int write_buffer_poll(struct write_buffer *p_wb, int64_t now_ms);
+
+/**
+ * @brief Walks the framed records passed to the flush callback
+ *
+ * @param p_data framed records
+ * @param len length of the data
+ * @param p_pos position. Start at 0.
+ * @param pp_rec set to the record
+ * @param p_rec_len set to the record length
+ * @return int 0 on success. -ENODATA after the last record.
+ */
+int write_buffer_next(const uint8_t *p_data, size_t len, size_t *p_pos,
+                      const uint8_t **pp_rec, size_t *p_rec_len);
+
+/**
+ * @brief Buffer counters
+ *
+ * @param p_wb buffer instance
+ * @param p_stats destination
+ */
+void write_buffer_stats_get(struct write_buffer *p_wb, struct write_buffer_stats *p_stats);
+
+#endif
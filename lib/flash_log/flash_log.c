@@ -0,0 +1,446 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/drivers/flash.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(flash_log);
+
+#include <lib/flash_log/flash_log.h>
+
+/*
+ * Layout
+ *
+ * Every sector starts with a header holding a sequence number. The sector
+ * with sequence n lives in physical sector n % sector_count. Records are
+ * written to fixed slots after the header and never cross a sector.
+ *
+ * sector: [magic][seq] [marker][record][crc] [marker][record][crc] ...
+ *
+ * The sector after the head is always erased before it's needed. Erasing it
+ * drops the oldest sector once the log has wrapped. At init only the sector
+ * headers are read to find head and tail, then the free slot in the head
+ * sector is found with a binary search.
+ */
+
+#define FLASH_LOG_SECTOR_MAGIC 0x464c4f47 /* FLOG */
+#define FLASH_LOG_RECORD_MARKER 0x52454331 /* REC1 */
+#define FLASH_LOG_ERASED 0xffffffff
+
+struct flash_log_sector_hdr
+{
+    uint32_t magic;
+    uint32_t seq;
+};
+
+static off_t flash_log_sector_off(struct flash_log *p_log, uint32_t seq)
+{
+    return (off_t)(seq % p_log->sector_count) * p_log->sector_size;
+}
+
+static off_t flash_log_slot_off(struct flash_log *p_log, uint32_t seq, uint32_t slot)
+{
+    return flash_log_sector_off(p_log, seq) + p_log->hdr_size + (off_t)slot * p_log->slot_size;
+}
+
+/* Ties the CRC to the position so stale data from an older lap doesn't pass */
+static uint32_t flash_log_crc(uint32_t seq, uint32_t slot, const uint8_t *p_data, size_t len)
+{
+    uint32_t pos[2] = {sys_cpu_to_le32(seq), sys_cpu_to_le32(slot)};
+    uint32_t crc = crc32_ieee((uint8_t *)pos, sizeof(pos));
+
+    return crc32_ieee_update(crc, p_data, len);
+}
+
+static int flash_log_sector_hdr_read(struct flash_log *p_log, uint32_t index, struct flash_log_sector_hdr *p_hdr)
+{
+    return flash_area_read(p_log->p_fa, (off_t)index * p_log->sector_size, p_hdr, sizeof(*p_hdr));
+}
+
+static int flash_log_erase(struct flash_log *p_log, uint32_t seq)
+{
+    int err = flash_area_erase(p_log->p_fa, flash_log_sector_off(p_log, seq), p_log->sector_size);
+    if (err)
+        return err;
+
+    p_log->stats.sectors_erased++;
+
+    /* Oldest sector is gone */
+    if ((int32_t)(seq - p_log->tail) >= (int32_t)p_log->sector_count)
+        p_log->tail = seq - p_log->sector_count + 1;
+
+    if ((int32_t)(seq - p_log->erased) > 0)
+        p_log->erased = seq;
+
+    return 0;
+}
+
+static int flash_log_sector_open(struct flash_log *p_log, uint32_t seq)
+{
+    int err;
+
+    memset(p_log->buf, 0xff, p_log->hdr_size);
+
+    struct flash_log_sector_hdr hdr = {
+        .magic = sys_cpu_to_le32(FLASH_LOG_SECTOR_MAGIC),
+        .seq = sys_cpu_to_le32(seq),
+    };
+
+    memcpy(p_log->buf, &hdr, sizeof(hdr));
+
+    err = flash_area_write(p_log->p_fa, flash_log_sector_off(p_log, seq), p_log->buf, p_log->hdr_size);
+    if (err)
+        return err;
+
+    p_log->stats.bytes_programmed += p_log->hdr_size;
+    p_log->head = seq;
+    p_log->head_slot = 0;
+
+    return 0;
+}
+
+static bool flash_log_sector_is_erased(struct flash_log *p_log, uint32_t seq)
+{
+    off_t off = flash_log_sector_off(p_log, seq);
+    size_t chunk = sizeof(p_log->buf) & ~0x3;
+
+    for (size_t i = 0; i < p_log->sector_size; i += chunk)
+    {
+        size_t len = MIN(chunk, p_log->sector_size - i);
+
+        if (flash_area_read(p_log->p_fa, off + i, p_log->buf, len))
+            return false;
+
+        for (size_t j = 0; j < len; j++)
+        {
+            if (p_log->buf[j] != 0xff)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool flash_log_slot_is_used(struct flash_log *p_log, uint32_t seq, uint32_t slot)
+{
+    uint32_t marker;
+
+    if (flash_area_read(p_log->p_fa, flash_log_slot_off(p_log, seq, slot), &marker, sizeof(marker)))
+        return true;
+
+    return marker != FLASH_LOG_ERASED;
+}
+
+static int flash_log_recover(struct flash_log *p_log)
+{
+    int err;
+    bool found = false;
+    struct flash_log_sector_hdr hdr;
+
+    for (uint32_t i = 0; i < p_log->sector_count; i++)
+    {
+        err = flash_log_sector_hdr_read(p_log, i, &hdr);
+        if (err)
+            return err;
+
+        uint32_t seq = sys_le32_to_cpu(hdr.seq);
+
+        /* Ignore erased or foreign sectors */
+        if (sys_le32_to_cpu(hdr.magic) != FLASH_LOG_SECTOR_MAGIC ||
+            seq % p_log->sector_count != i)
+            continue;
+
+        if (!found)
+        {
+            p_log->head = seq;
+            p_log->tail = seq;
+            found = true;
+        }
+        else
+        {
+            /* Sequence numbers are close together so this handles wrapping */
+            if ((int32_t)(seq - p_log->head) > 0)
+                p_log->head = seq;
+            if ((int32_t)(seq - p_log->tail) < 0)
+                p_log->tail = seq;
+        }
+    }
+
+    if (!found)
+    {
+        LOG_INF("No log found. Starting fresh.");
+        return flash_log_clear(p_log);
+    }
+
+    /* Binary search for the first free slot. Slots fill up in order. */
+    uint32_t lo = 0;
+    uint32_t hi = p_log->slots_per_sector;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (flash_log_slot_is_used(p_log, p_log->head, mid))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    p_log->head_slot = lo;
+
+    /* An erase may have been interrupted. Don't trust it without checking. */
+    if (flash_log_sector_is_erased(p_log, p_log->head + 1))
+        p_log->erased = p_log->head + 1;
+    else
+        p_log->erased = p_log->head;
+
+    LOG_INF("Recovered sectors %u..%u, slot %u", p_log->tail, p_log->head, p_log->head_slot);
+
+    return 0;
+}
+
+int flash_log_init(struct flash_log *p_log, const struct flash_log_config *p_config)
+{
+    int err;
+    struct flash_pages_info info;
+
+    memset(p_log, 0, sizeof(*p_log));
+    k_mutex_init(&p_log->lock);
+
+    err = flash_area_open(p_config->area_id, &p_log->p_fa);
+    if (err)
+    {
+        LOG_ERR("Unable to open flash area %u. Err: %i", p_config->area_id, err);
+        return err;
+    }
+
+    /* Uniform sectors are assumed */
+    err = flash_get_page_info_by_offs(flash_area_get_device(p_log->p_fa), p_log->p_fa->fa_off, &info);
+    if (err)
+        goto close;
+
+    size_t align = flash_area_align(p_log->p_fa);
+
+    if (p_config->record_size == 0 || p_config->record_size > CONFIG_FLASH_LOG_RECORD_MAX ||
+        align > CONFIG_FLASH_LOG_WRITE_ALIGN_MAX)
+    {
+        err = -EINVAL;
+        goto close;
+    }
+
+    p_log->sector_size = info.size;
+    p_log->sector_count = p_log->p_fa->fa_size / info.size;
+    p_log->hdr_size = ROUND_UP(sizeof(struct flash_log_sector_hdr), align);
+    p_log->slot_size = ROUND_UP(p_config->record_size + 2 * sizeof(uint32_t), align);
+    p_log->record_size = p_config->record_size;
+    p_log->slots_per_sector = (p_log->sector_size - p_log->hdr_size) / p_log->slot_size;
+    p_log->deferred_erase = p_config->deferred_erase;
+
+    /* One sector being written and one erased ahead */
+    if (p_log->sector_count < 2)
+    {
+        err = -ENOSPC;
+        goto close;
+    }
+
+    err = flash_log_recover(p_log);
+    if (err)
+        goto close;
+
+    return 0;
+
+close:
+    LOG_ERR("Unable to init log. Err: %i", err);
+    flash_area_close(p_log->p_fa);
+    return err;
+}
+
+int flash_log_clear(struct flash_log *p_log)
+{
+    int err;
+
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    err = flash_area_erase(p_log->p_fa, 0, p_log->sector_count * p_log->sector_size);
+    if (err)
+        goto unlock;
+
+    p_log->stats.sectors_erased += p_log->sector_count;
+    p_log->tail = 0;
+    p_log->erased = p_log->sector_count - 1;
+
+    err = flash_log_sector_open(p_log, 0);
+
+unlock:
+    k_mutex_unlock(&p_log->lock);
+
+    return err;
+}
+
+int flash_log_erase_ahead(struct flash_log *p_log)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    if ((int32_t)(p_log->erased - p_log->head) <= 0)
+        err = flash_log_erase(p_log, p_log->head + 1);
+
+    k_mutex_unlock(&p_log->lock);
+
+    return err;
+}
+
+int flash_log_append(struct flash_log *p_log, const void *p_data)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    /* Move on to the next sector */
+    if (p_log->head_slot == p_log->slots_per_sector)
+    {
+        uint32_t next = p_log->head + 1;
+
+        if ((int32_t)(p_log->erased - next) < 0)
+        {
+            p_log->stats.inline_erases++;
+
+            err = flash_log_erase(p_log, next);
+            if (err)
+                goto unlock;
+        }
+
+        err = flash_log_sector_open(p_log, next);
+        if (err)
+            goto unlock;
+
+        /* Keep one sector ready */
+        if (!p_log->deferred_erase && (int32_t)(p_log->erased - (next + 1)) < 0)
+        {
+            err = flash_log_erase(p_log, next + 1);
+            if (err)
+                goto unlock;
+        }
+    }
+
+    /* Record goes out in one program operation */
+    uint32_t marker = sys_cpu_to_le32(FLASH_LOG_RECORD_MARKER);
+    uint32_t crc = sys_cpu_to_le32(flash_log_crc(p_log->head, p_log->head_slot, p_data, p_log->record_size));
+
+    memset(p_log->buf, 0xff, p_log->slot_size);
+    memcpy(p_log->buf, &marker, sizeof(marker));
+    memcpy(p_log->buf + sizeof(marker), p_data, p_log->record_size);
+    memcpy(p_log->buf + sizeof(marker) + p_log->record_size, &crc, sizeof(crc));
+
+    err = flash_area_write(p_log->p_fa, flash_log_slot_off(p_log, p_log->head, p_log->head_slot),
+                           p_log->buf, p_log->slot_size);
+    if (err)
+        goto unlock;
+
+    p_log->head_slot++;
+    p_log->stats.appends++;
+    p_log->stats.bytes_appended += p_log->record_size;
+    p_log->stats.bytes_programmed += p_log->slot_size;
+
+unlock:
+    k_mutex_unlock(&p_log->lock);
+
+    return err;
+}
+
+void flash_log_cursor_init(struct flash_log *p_log, struct flash_log_cursor *p_cursor)
+{
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    p_cursor->sector = p_log->tail;
+    p_cursor->slot = 0;
+
+    k_mutex_unlock(&p_log->lock);
+}
+
+int flash_log_read(struct flash_log *p_log, struct flash_log_cursor *p_cursor, void *p_data)
+{
+    int err = -ENODATA;
+
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    for (;;)
+    {
+        /* Data under the cursor was overwritten */
+        if ((int32_t)(p_cursor->sector - p_log->tail) < 0)
+        {
+            p_cursor->sector = p_log->tail;
+            p_cursor->slot = 0;
+        }
+
+        if (p_cursor->slot == p_log->slots_per_sector)
+        {
+            p_cursor->sector++;
+            p_cursor->slot = 0;
+        }
+
+        /* Caught up. A full head sector moves the cursor past it. */
+        if ((int32_t)(p_cursor->sector - p_log->head) > 0 ||
+            (p_cursor->sector == p_log->head && p_cursor->slot >= p_log->head_slot))
+        {
+            err = -ENODATA;
+            break;
+        }
+
+        uint32_t marker;
+        uint32_t crc;
+        off_t off = flash_log_slot_off(p_log, p_cursor->sector, p_cursor->slot);
+
+        err = flash_area_read(p_log->p_fa, off, p_log->buf, p_log->record_size + 2 * sizeof(uint32_t));
+        if (err)
+            break;
+
+        memcpy(&marker, p_log->buf, sizeof(marker));
+        memcpy(&crc, p_log->buf + sizeof(marker) + p_log->record_size, sizeof(crc));
+
+        uint32_t slot = p_cursor->slot++;
+
+        if (sys_le32_to_cpu(marker) != FLASH_LOG_RECORD_MARKER ||
+            sys_le32_to_cpu(crc) != flash_log_crc(p_cursor->sector, slot,
+                                                  p_log->buf + sizeof(marker), p_log->record_size))
+        {
+            p_log->stats.corrupt++;
+            continue;
+        }
+
+        memcpy(p_data, p_log->buf + sizeof(marker), p_log->record_size);
+        err = 0;
+        break;
+    }
+
+    k_mutex_unlock(&p_log->lock);
+
+    return err;
+}
+
+uint32_t flash_log_count(struct flash_log *p_log)
+{
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    uint32_t count = (p_log->head - p_log->tail) * p_log->slots_per_sector + p_log->head_slot;
+
+    k_mutex_unlock(&p_log->lock);
+
+    return count;
+}
+
+void flash_log_stats_get(struct flash_log *p_log, struct flash_log_stats *p_stats)
+{
+    k_mutex_lock(&p_log->lock, K_FOREVER);
+
+    *p_stats = p_log->stats;
+
+    k_mutex_unlock(&p_log->lock);
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/flash_wear/flash_wear.h>
+
+/* Read and program take tens of us, sector erases tens of ms */
+static const int32_t flash_wear_latency_bounds[] = {
+    50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+};
+
+#define FLASH_WEAR_MS_PER_DAY (24LL * 3600 * MSEC_PER_SEC)
+
+void flash_wear_init(struct flash_wear *p_wear, uint16_t *p_erase_counts, size_t sectors,
+                     size_t sector_size)
+{
+    memset(p_wear, 0, sizeof(*p_wear));
+
+    p_wear->p_erase_counts = p_erase_counts;
+    p_wear->sectors = sectors;
+    p_wear->sector_size = sector_size;
+
+    for (int i = 0; i < FLASH_WEAR_OPS; i++)
+    {
+        p_wear->latency[i].p_bounds = flash_wear_latency_bounds;
+        p_wear->latency[i].bounds_count = ARRAY_SIZE(flash_wear_latency_bounds);
+    }
+
+    memset(p_erase_counts, 0, sectors * sizeof(*p_erase_counts));
+}
+
+void flash_wear_record(struct flash_wear *p_wear, enum flash_wear_op op, off_t off, size_t len,
+                       uint32_t us, int err)
+{
+    if (op >= FLASH_WEAR_OPS)
+        return;
+
+    k_spinlock_key_t key = k_spin_lock(&p_wear->lock);
+
+    if (err)
+    {
+        p_wear->errors[op]++;
+        k_spin_unlock(&p_wear->lock, key);
+        return;
+    }
+
+    p_wear->calls[op]++;
+    p_wear->bytes[op] += len;
+    histogram_add(&p_wear->latency[op], MIN(us, INT32_MAX));
+
+    /* Every sector the erase touched */
+    if (op == FLASH_WEAR_ERASE && len > 0 && off >= 0)
+    {
+        size_t first = off / p_wear->sector_size;
+        size_t last = (off + len - 1) / p_wear->sector_size;
+
+        for (size_t i = first; i <= last && i < p_wear->sectors; i++)
+        {
+            if (p_wear->p_erase_counts[i] < UINT16_MAX)
+                p_wear->p_erase_counts[i]++;
+        }
+    }
+
+    k_spin_unlock(&p_wear->lock, key);
+}
+
+void flash_wear_summary_get(struct flash_wear *p_wear, struct flash_wear_summary *p_summary)
+{
+    memset(p_summary, 0, sizeof(*p_summary));
+
+    if (p_wear->sectors == 0)
+        return;
+
+    p_summary->min = UINT16_MAX;
+
+    k_spinlock_key_t key = k_spin_lock(&p_wear->lock);
+
+    for (size_t i = 0; i < p_wear->sectors; i++)
+    {
+        uint16_t count = p_wear->p_erase_counts[i];
+
+        p_summary->erases += count;
+        p_summary->min = MIN(p_summary->min, count);
+        p_summary->max = MAX(p_summary->max, count);
+
+        if (count)
+            p_summary->used_sectors++;
+    }
+
+    k_spin_unlock(&p_wear->lock, key);
+
+    p_summary->avg_x100 = (uint64_t)p_summary->erases * 100 / p_wear->sectors;
+}
+
+uint32_t flash_wear_endurance_days(const struct flash_wear_summary *p_summary,
+                                   uint32_t rated_cycles, int64_t elapsed_ms)
+{
+    if (p_summary->max == 0 || elapsed_ms <= 0)
+        return UINT32_MAX;
+
+    if (p_summary->max >= rated_cycles)
+        return 0;
+
+    /* Cycles left over the rate of the worst sector */
+    uint64_t days = (uint64_t)(rated_cycles - p_summary->max) * elapsed_ms /
+                    p_summary->max / FLASH_WEAR_MS_PER_DAY;
+
+    return MIN(days, UINT32_MAX - 1);
+}
+
+void flash_wear_erase_counts_add(struct flash_wear *p_wear, size_t first, const uint16_t *p_counts,
+                                 size_t count)
+{
+    k_spinlock_key_t key = k_spin_lock(&p_wear->lock);
+
+    for (size_t i = 0; i < count && first + i < p_wear->sectors; i++)
+    {
+        uint32_t sum = (uint32_t)p_wear->p_erase_counts[first + i] + p_counts[i];
+
+        p_wear->p_erase_counts[first + i] = MIN(sum, UINT16_MAX);
+    }
+
+    k_spin_unlock(&p_wear->lock, key);
+}
+
+size_t flash_wear_erase_counts_get(struct flash_wear *p_wear, size_t first, uint16_t *p_counts,
+                                   size_t count)
+{
+    if (first >= p_wear->sectors)
+        return 0;
+
+    count = MIN(count, p_wear->sectors - first);
+
+    k_spinlock_key_t key = k_spin_lock(&p_wear->lock);
+
+    memcpy(p_counts, &p_wear->p_erase_counts[first], count * sizeof(*p_counts));
+
+    k_spin_unlock(&p_wear->lock, key);
+
+    return count;
+}
+
+void flash_wear_reset(struct flash_wear *p_wear)
+{
+    k_spinlock_key_t key = k_spin_lock(&p_wear->lock);
+
+    memset(p_wear->bytes, 0, sizeof(p_wear->bytes));
+    memset(p_wear->calls, 0, sizeof(p_wear->calls));
+    memset(p_wear->errors, 0, sizeof(p_wear->errors));
+
+    for (int i = 0; i < FLASH_WEAR_OPS; i++)
+        histogram_reset(&p_wear->latency[i]);
+
+    memset(p_wear->p_erase_counts, 0, p_wear->sectors * sizeof(*p_wear->p_erase_counts));
+
+    k_spin_unlock(&p_wear->lock, key);
+}
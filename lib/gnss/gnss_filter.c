@@ -0,0 +1,194 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/gnss/gnss_filter.h>
+
+/* 1e-7 degrees of latitude is 1.11195 cm. Scaled by 1e5. */
+#define GNSS_FILTER_CM_PER_E7_1E5 111195
+
+/* Satellite count at which a fix gets its full weight */
+#define GNSS_FILTER_SATS_FULL_WEIGHT 8
+
+#define GNSS_FILTER_Q16_ONE (1 << 16)
+
+/* Cosine in Q15 from latitude in 1e-7 degrees. Runs once per (re)start. */
+static int32_t gnss_filter_cos_q15(int32_t lat_e7)
+{
+    /* Angle in Q15 radians */
+    int64_t x = (int64_t)lat_e7 * 5719 / 100000000;
+    int64_t x2 = (x * x) >> 15;
+
+    /* 1 - x^2/2 + x^4/24 - x^6/720 */
+    int64_t term = GNSS_FILTER_Q16_ONE >> 1;
+    int64_t sum = term;
+
+    term = -((term * x2) >> 15) / 2;
+    sum += term;
+    term = -((term * x2) >> 15) / 12;
+    sum += term;
+    term = -((term * x2) >> 15) / 30;
+    sum += term;
+
+    return (int32_t)CLAMP(sum, 0, GNSS_FILTER_Q16_ONE >> 1);
+}
+
+static uint32_t gnss_filter_sqrt(uint64_t val)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > val)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (val >= res + bit)
+        {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+/* Longitude back into +-180 degrees. Deltas across the antimeridian take the short way. */
+static int64_t gnss_filter_wrap_lng(int64_t lng_e7)
+{
+    const int64_t half = 1800000000LL;
+
+    while (lng_e7 > half)
+        lng_e7 -= 2 * half;
+
+    while (lng_e7 < -half)
+        lng_e7 += 2 * half;
+
+    return lng_e7;
+}
+
+/* Distance between two positions in cm */
+static uint32_t gnss_filter_distance_cm(struct gnss_filter *p_ctx, int64_t dlat_e7, int64_t dlng_e7)
+{
+    int64_t dy = dlat_e7 * GNSS_FILTER_CM_PER_E7_1E5 / 100000;
+    int64_t dx = ((dlng_e7 * GNSS_FILTER_CM_PER_E7_1E5 / 100000) * p_ctx->cos_lat_q15) >> 15;
+
+    return gnss_filter_sqrt(dx * dx + dy * dy);
+}
+
+/* Measurement variance in cm^2. Fewer satellites means less weight. */
+static int64_t gnss_filter_meas_var(const struct gnss_filter_meas *p_meas)
+{
+    int64_t acc = MAX(p_meas->accuracy_cm, 1);
+    int64_t sats = CLAMP(p_meas->sats_used, 1, GNSS_FILTER_SATS_FULL_WEIGHT);
+
+    return acc * acc * GNSS_FILTER_SATS_FULL_WEIGHT / sats;
+}
+
+static void gnss_filter_restart(struct gnss_filter *p_ctx, const struct gnss_filter_meas *p_meas)
+{
+    p_ctx->valid = true;
+    p_ctx->ts = p_meas->ts;
+    p_ctx->lat_e7 = p_meas->lat_e7;
+    p_ctx->lng_e7 = p_meas->lng_e7;
+    p_ctx->lat_vel_e7 = 0;
+    p_ctx->lng_vel_e7 = 0;
+    p_ctx->var_cm2 = gnss_filter_meas_var(p_meas);
+    p_ctx->cos_lat_q15 = gnss_filter_cos_q15(p_meas->lat_e7);
+    p_ctx->rejects = 0;
+}
+
+void gnss_filter_init(struct gnss_filter *p_ctx, const struct gnss_filter_config *p_config)
+{
+    memset(p_ctx, 0, sizeof(struct gnss_filter));
+
+    p_ctx->config = *p_config;
+}
+
+enum gnss_filter_result gnss_filter_update(struct gnss_filter *p_ctx,
+                                           const struct gnss_filter_meas *p_meas)
+{
+    if (!p_ctx->valid)
+    {
+        gnss_filter_restart(p_ctx, p_meas);
+        return GNSS_FILTER_RESET;
+    }
+
+    int64_t dt = p_meas->ts - p_ctx->ts;
+    if (dt <= 0)
+        dt = 1;
+
+    /* Reject jumps that imply an impossible speed */
+    uint32_t dist = gnss_filter_distance_cm(
+        p_ctx, (int64_t)p_meas->lat_e7 - p_ctx->lat_e7,
+        gnss_filter_wrap_lng((int64_t)p_meas->lng_e7 - p_ctx->lng_e7));
+
+    if ((int64_t)dist * MSEC_PER_SEC / dt > p_ctx->config.max_speed_cm_s)
+    {
+        p_ctx->rejects++;
+
+        /* The filter is probably the one that's wrong */
+        if (p_ctx->rejects > p_ctx->config.max_rejects)
+        {
+            gnss_filter_restart(p_ctx, p_meas);
+            return GNSS_FILTER_RESET;
+        }
+
+        return GNSS_FILTER_REJECTED;
+    }
+
+    /* Velocity is stale after a long gap */
+    if (dt > p_ctx->config.max_gap_ms)
+    {
+        gnss_filter_restart(p_ctx, p_meas);
+        return GNSS_FILTER_RESET;
+    }
+
+    /* Predict */
+    int32_t lat = p_ctx->lat_e7 + (int32_t)(p_ctx->lat_vel_e7 * dt / MSEC_PER_SEC);
+    int64_t lng = gnss_filter_wrap_lng(p_ctx->lng_e7 + (int64_t)p_ctx->lng_vel_e7 * dt / MSEC_PER_SEC);
+    int64_t spread = (int64_t)p_ctx->config.accel_sigma_cm_s2 * dt * dt / (MSEC_PER_SEC * MSEC_PER_SEC);
+    int64_t var = p_ctx->var_cm2 + spread * spread;
+
+    /* Gains in Q16. beta follows alpha (Benedict-Bordner) */
+    int64_t meas_var = gnss_filter_meas_var(p_meas);
+    int64_t alpha = (var << 16) / (var + meas_var);
+    int64_t beta = alpha * alpha / (2 * GNSS_FILTER_Q16_ONE - alpha);
+
+    /* Update */
+    int64_t res_lat = p_meas->lat_e7 - lat;
+    int64_t res_lng = gnss_filter_wrap_lng(p_meas->lng_e7 - lng);
+
+    p_ctx->lat_e7 = lat + (int32_t)((alpha * res_lat) >> 16);
+    p_ctx->lng_e7 = (int32_t)gnss_filter_wrap_lng(lng + ((alpha * res_lng) >> 16));
+    p_ctx->lat_vel_e7 += (int32_t)(((beta * res_lat) >> 16) * MSEC_PER_SEC / dt);
+    p_ctx->lng_vel_e7 += (int32_t)(((beta * res_lng) >> 16) * MSEC_PER_SEC / dt);
+    p_ctx->var_cm2 = MAX(((GNSS_FILTER_Q16_ONE - alpha) * var) >> 16, 1);
+    p_ctx->ts = p_meas->ts;
+    p_ctx->rejects = 0;
+
+    return GNSS_FILTER_ACCEPTED;
+}
+
+int gnss_filter_get(struct gnss_filter *p_ctx, struct gnss_filter_fix *p_fix)
+{
+    if (!p_ctx->valid)
+        return -ENODATA;
+
+    p_fix->ts = p_ctx->ts;
+    p_fix->lat_e7 = p_ctx->lat_e7;
+    p_fix->lng_e7 = p_ctx->lng_e7;
+    p_fix->accuracy_cm = gnss_filter_sqrt(p_ctx->var_cm2);
+
+    return 0;
+}
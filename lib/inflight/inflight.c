@@ -0,0 +1,268 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/random/rand32.h>
+
+#include <lib/inflight/inflight.h>
+
+/* From a CoAP round trip to a request that waited out a retransmit */
+static const int32_t inflight_latency_bounds[] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 60000, 120000, 300000,
+};
+
+void inflight_init(struct inflight *p_table, uint8_t *p_mem, size_t size,
+                   const struct inflight_config *p_config, inflight_send_t send,
+                   inflight_result_t result, inflight_fail_t fail, void *p_user)
+{
+    memset(p_table, 0, sizeof(*p_table));
+    k_mutex_init(&p_table->lock);
+
+    p_table->slot_size = size / CONFIG_INFLIGHT_WINDOW;
+    p_table->config = *p_config;
+    p_table->send = send;
+    p_table->result = result;
+    p_table->fail = fail;
+    p_table->p_user = p_user;
+
+    p_table->stats.latency.p_bounds = inflight_latency_bounds;
+    p_table->stats.latency.bounds_count = ARRAY_SIZE(inflight_latency_bounds);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+        p_table->slots[i].p_buf = &p_mem[i * p_table->slot_size];
+}
+
+/* Exponential, with half of it random so retries of a burst spread out */
+static uint32_t inflight_backoff(struct inflight *p_table, uint8_t attempts)
+{
+    uint32_t delay = p_table->config.backoff_min_ms;
+
+    for (uint8_t i = 1; i < attempts && delay < p_table->config.backoff_max_ms; i++)
+        delay *= 2;
+
+    delay = MIN(delay, p_table->config.backoff_max_ms);
+
+    return delay / 2 + sys_rand32_get() % (delay / 2 + 1);
+}
+
+static void inflight_result(struct inflight *p_table, struct inflight_slot *p_slot, int err,
+                            int64_t now_ms)
+{
+    uint32_t ms = MIN(now_ms - p_slot->submitted_ms, UINT32_MAX);
+
+    if (p_table->result)
+        p_table->result(p_slot->topic, p_slot->kind, err, ms, p_table->p_user);
+}
+
+static void inflight_free(struct inflight_slot *p_slot)
+{
+    p_slot->state = INFLIGHT_FREE;
+    p_slot->len = 0;
+}
+
+static void inflight_failed_locked(struct inflight *p_table, struct inflight_slot *p_slot, int err,
+                                   int64_t now_ms)
+{
+    if (p_slot->attempts < p_table->config.max_attempts)
+    {
+        p_slot->state = INFLIGHT_BACKOFF;
+        p_slot->due_ms = now_ms + inflight_backoff(p_table, p_slot->attempts);
+        return;
+    }
+
+    /* Out of attempts. Hand it over before the slot is reused. */
+    p_table->stats.failed++;
+
+    if (p_table->fail)
+        p_table->fail(p_slot->topic, p_slot->kind, p_slot->p_buf, p_slot->len, err,
+                      p_table->p_user);
+
+    inflight_free(p_slot);
+}
+
+/* Called with the lock held. It is released around send() since the transport
+ * takes its own locks and reports results through inflight_complete(). */
+static int inflight_attempt_locked(struct inflight *p_table, struct inflight_slot *p_slot,
+                                   int64_t now_ms)
+{
+    /* A new id per attempt. Results of earlier attempts no longer match. */
+    uint32_t id = p_table->next_id++;
+
+    p_slot->id = id;
+    p_slot->attempts++;
+    p_slot->state = INFLIGHT_PENDING;
+    p_slot->due_ms = now_ms + p_table->config.timeout_ms;
+
+    k_mutex_unlock(&p_table->lock);
+
+    int err = p_table->send(id, p_slot->topic, p_slot->kind, p_slot->p_buf, p_slot->len,
+                            p_table->p_user);
+
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    /* Already completed (or timed out) while unlocked */
+    if (p_slot->state != INFLIGHT_PENDING || p_slot->id != id)
+        return 0;
+
+    return err;
+}
+
+int inflight_submit(struct inflight *p_table, const char *p_topic, uint8_t kind,
+                    const uint8_t *p_data, size_t len, int64_t now_ms)
+{
+    struct inflight_slot *p_slot = NULL;
+
+    if (len > p_table->slot_size || len == 0)
+        return -EMSGSIZE;
+
+    if (strlen(p_topic) >= CONFIG_INFLIGHT_TOPIC_LEN)
+        return -EINVAL;
+
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+    {
+        if (p_table->slots[i].state == INFLIGHT_FREE)
+        {
+            p_slot = &p_table->slots[i];
+            break;
+        }
+    }
+
+    if (p_slot == NULL)
+    {
+        p_table->stats.window_full++;
+        k_mutex_unlock(&p_table->lock);
+
+        return -EBUSY;
+    }
+
+    strcpy(p_slot->topic, p_topic);
+    memcpy(p_slot->p_buf, p_data, len);
+    p_slot->len = len;
+    p_slot->kind = kind;
+    p_slot->attempts = 0;
+    p_slot->submitted_ms = now_ms;
+
+    int err = inflight_attempt_locked(p_table, p_slot, now_ms);
+
+    /* Not taken. The caller still has the data and keeps it. */
+    if (err)
+        inflight_free(p_slot);
+    else
+        p_table->stats.submitted++;
+
+    k_mutex_unlock(&p_table->lock);
+
+    return err;
+}
+
+void inflight_complete(struct inflight *p_table, uint32_t id, int err, int64_t now_ms)
+{
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+    {
+        struct inflight_slot *p_slot = &p_table->slots[i];
+
+        if (p_slot->state != INFLIGHT_PENDING || p_slot->id != id)
+            continue;
+
+        inflight_result(p_table, p_slot, err, now_ms);
+
+        if (err)
+        {
+            inflight_failed_locked(p_table, p_slot, err, now_ms);
+        }
+        else
+        {
+            p_table->stats.acked++;
+            histogram_add(&p_table->stats.latency, MIN(now_ms - p_slot->submitted_ms, INT32_MAX));
+            inflight_free(p_slot);
+        }
+
+        k_mutex_unlock(&p_table->lock);
+        return;
+    }
+
+    p_table->stats.late++;
+
+    k_mutex_unlock(&p_table->lock);
+}
+
+void inflight_poll(struct inflight *p_table, int64_t now_ms)
+{
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+    {
+        struct inflight_slot *p_slot = &p_table->slots[i];
+
+        if (p_slot->state == INFLIGHT_FREE || now_ms < p_slot->due_ms)
+            continue;
+
+        if (p_slot->state == INFLIGHT_PENDING)
+        {
+            p_table->stats.timeouts++;
+            inflight_result(p_table, p_slot, -ETIMEDOUT, now_ms);
+            inflight_failed_locked(p_table, p_slot, -ETIMEDOUT, now_ms);
+        }
+        else
+        {
+            p_table->stats.retries++;
+
+            int err = inflight_attempt_locked(p_table, p_slot, now_ms);
+            if (err)
+                inflight_failed_locked(p_table, p_slot, err, now_ms);
+        }
+    }
+
+    k_mutex_unlock(&p_table->lock);
+}
+
+int64_t inflight_deadline(struct inflight *p_table)
+{
+    int64_t deadline = INT64_MAX;
+
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+    {
+        if (p_table->slots[i].state != INFLIGHT_FREE)
+            deadline = MIN(deadline, p_table->slots[i].due_ms);
+    }
+
+    k_mutex_unlock(&p_table->lock);
+
+    return deadline;
+}
+
+size_t inflight_count(struct inflight *p_table)
+{
+    size_t count = 0;
+
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_INFLIGHT_WINDOW; i++)
+    {
+        if (p_table->slots[i].state != INFLIGHT_FREE)
+            count++;
+    }
+
+    k_mutex_unlock(&p_table->lock);
+
+    return count;
+}
+
+void inflight_stats_get(struct inflight *p_table, struct inflight_stats *p_stats)
+{
+    k_mutex_lock(&p_table->lock, K_FOREVER);
+
+    *p_stats = p_table->stats;
+
+    k_mutex_unlock(&p_table->lock);
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/drivers/flash.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(kv_store);
+
+#include <lib/kv_store/kv_store.h>
+
+int kv_store_init(struct kv_store *p_kv, uint8_t area_id)
+{
+    int err;
+    const struct flash_area *p_fa;
+    struct flash_pages_info info;
+
+    memset(p_kv, 0, sizeof(*p_kv));
+    k_mutex_init(&p_kv->lock);
+
+    err = flash_area_open(area_id, &p_fa);
+    if (err)
+    {
+        LOG_ERR("Unable to open flash area %u. Err: %i", area_id, err);
+        return err;
+    }
+
+    p_kv->fs.flash_device = flash_area_get_device(p_fa);
+    p_kv->fs.offset = p_fa->fa_off;
+
+    /* Uniform sectors are assumed */
+    err = flash_get_page_info_by_offs(p_kv->fs.flash_device, p_fa->fa_off, &info);
+    if (err)
+        goto close;
+
+    p_kv->fs.sector_size = info.size;
+    p_kv->fs.sector_count = p_fa->fa_size / info.size;
+
+    /* NVS garbage collects a sector into the next free one when it rolls over */
+    err = nvs_mount(&p_kv->fs);
+    if (err)
+    {
+        LOG_ERR("Unable to mount NVS. Err: %i", err);
+        goto close;
+    }
+
+    /* One pass at init. Every read after this comes from RAM. */
+    for (int i = 0; i < CONFIG_KV_STORE_COUNTERS; i++)
+    {
+        ssize_t len = nvs_read(&p_kv->fs, KV_STORE_COUNTER_ID_BASE + i,
+                               &p_kv->counters[i], sizeof(p_kv->counters[i]));
+        if (len != sizeof(p_kv->counters[i]))
+            p_kv->counters[i] = 0;
+    }
+
+close:
+    flash_area_close(p_fa);
+    return err;
+}
+
+static int kv_store_write_locked(struct kv_store *p_kv, uint16_t id, const void *p_data, size_t len)
+{
+    ssize_t written = nvs_write(&p_kv->fs, id, p_data, len);
+    if (written < 0)
+        return written;
+
+    /* NVS skips values that didn't change */
+    if (written == 0)
+    {
+        p_kv->stats.unchanged++;
+        return 0;
+    }
+
+    p_kv->stats.writes++;
+    p_kv->stats.bytes_written += written;
+
+    return 0;
+}
+
+ssize_t kv_store_read(struct kv_store *p_kv, uint16_t id, void *p_data, size_t len)
+{
+    if (id >= KV_STORE_COUNTER_ID_BASE)
+        return -EINVAL;
+
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    ssize_t ret = nvs_read(&p_kv->fs, id, p_data, len);
+
+    k_mutex_unlock(&p_kv->lock);
+
+    return ret;
+}
+
+int kv_store_write(struct kv_store *p_kv, uint16_t id, const void *p_data, size_t len)
+{
+    if (id >= KV_STORE_COUNTER_ID_BASE)
+        return -EINVAL;
+
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    int err = kv_store_write_locked(p_kv, id, p_data, len);
+
+    k_mutex_unlock(&p_kv->lock);
+
+    return err;
+}
+
+uint32_t kv_store_counter_get(struct kv_store *p_kv, uint8_t idx)
+{
+    if (idx >= CONFIG_KV_STORE_COUNTERS)
+        return 0;
+
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    uint32_t val = p_kv->counters[idx];
+    p_kv->stats.counter_reads++;
+
+    k_mutex_unlock(&p_kv->lock);
+
+    return val;
+}
+
+int kv_store_counter_add(struct kv_store *p_kv, uint8_t idx, uint32_t delta)
+{
+    if (idx >= CONFIG_KV_STORE_COUNTERS)
+        return -EINVAL;
+
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    /* The cached value is the truth. Append the new one. */
+    uint32_t val = p_kv->counters[idx] + delta;
+
+    int err = kv_store_write_locked(p_kv, KV_STORE_COUNTER_ID_BASE + idx, &val, sizeof(val));
+    if (err == 0)
+        p_kv->counters[idx] = val;
+
+    k_mutex_unlock(&p_kv->lock);
+
+    return err;
+}
+
+int kv_store_clear(struct kv_store *p_kv)
+{
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    int err = nvs_clear(&p_kv->fs);
+    if (err == 0)
+        memset(p_kv->counters, 0, sizeof(p_kv->counters));
+
+    k_mutex_unlock(&p_kv->lock);
+
+    return err;
+}
+
+void kv_store_stats_get(struct kv_store *p_kv, struct kv_store_stats *p_stats)
+{
+    k_mutex_lock(&p_kv->lock, K_FOREVER);
+
+    *p_stats = p_kv->stats;
+
+    k_mutex_unlock(&p_kv->lock);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/lz/lz.h>
+
+/* A match is two bytes: 12 bit distance, 4 bit length */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 0x0f)
+#define LZ_MAX_DIST 0x0fff
+
+static inline uint32_t lz_hash(const uint8_t *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+    return (v * 2654435761u) >> (32 - CONFIG_LZ_HASH_BITS);
+}
+
+int lz_compress(struct lz_ctx *p_ctx, const uint8_t *p_in, size_t in_len,
+                uint8_t *p_out, size_t out_size)
+{
+    size_t ip = 0;
+    size_t op = 0;
+    size_t flag_pos = 0;
+    int bit = 8;
+
+    if (in_len > UINT16_MAX)
+        return -EINVAL;
+
+    /* Positions are stored +1 so 0 is empty */
+    memset(p_ctx->table, 0, sizeof(p_ctx->table));
+
+    while (ip < in_len)
+    {
+        /* Control byte for the next 8 items */
+        if (bit == 8)
+        {
+            if (op >= out_size)
+                return -ENOSPC;
+
+            flag_pos = op;
+            p_out[op++] = 0;
+            bit = 0;
+        }
+
+        size_t len = 0;
+        size_t dist = 0;
+
+        if (ip + LZ_MIN_MATCH <= in_len)
+        {
+            uint32_t h = lz_hash(&p_in[ip]);
+            size_t cand = p_ctx->table[h];
+
+            p_ctx->table[h] = ip + 1;
+
+            if (cand != 0 && ip - (cand - 1) <= LZ_MAX_DIST)
+            {
+                size_t max = MIN(LZ_MAX_MATCH, in_len - ip);
+
+                cand--;
+                while (len < max && p_in[cand + len] == p_in[ip + len])
+                    len++;
+
+                dist = ip - cand;
+            }
+        }
+
+        if (len >= LZ_MIN_MATCH)
+        {
+            if (op + 2 > out_size)
+                return -ENOSPC;
+
+            p_out[flag_pos] |= BIT(bit);
+            p_out[op++] = dist & 0xff;
+            p_out[op++] = ((dist >> 8) << 4) | (len - LZ_MIN_MATCH);
+
+            /* Index what the match covered */
+            for (size_t i = 1; i < len && ip + i + LZ_MIN_MATCH <= in_len; i++)
+                p_ctx->table[lz_hash(&p_in[ip + i])] = ip + i + 1;
+
+            ip += len;
+        }
+        else
+        {
+            if (op >= out_size)
+                return -ENOSPC;
+
+            p_out[op++] = p_in[ip++];
+        }
+
+        bit++;
+    }
+
+    return op;
+}
+
+int lz_decompress(const uint8_t *p_in, size_t in_len, uint8_t *p_out, size_t out_size)
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < in_len)
+    {
+        uint8_t flags = p_in[ip++];
+
+        for (int bit = 0; bit < 8 && ip < in_len; bit++)
+        {
+            if (flags & BIT(bit))
+            {
+                if (ip + 2 > in_len)
+                    return -EINVAL;
+
+                size_t dist = p_in[ip] | ((p_in[ip + 1] >> 4) << 8);
+                size_t len = (p_in[ip + 1] & 0x0f) + LZ_MIN_MATCH;
+                ip += 2;
+
+                if (dist == 0 || dist > op)
+                    return -EINVAL;
+
+                if (op + len > out_size)
+                    return -ENOSPC;
+
+                /* Byte by byte. Matches can overlap what they produce. */
+                for (size_t i = 0; i < len; i++, op++)
+                    p_out[op] = p_out[op - dist];
+            }
+            else
+            {
+                if (op >= out_size)
+                    return -ENOSPC;
+
+                p_out[op++] = p_in[ip++];
+            }
+        }
+    }
+
+    return op;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/stats/histogram.h>
+
+void histogram_add(struct histogram *p_hist, int32_t val)
+{
+    size_t i = 0;
+
+    while (i < p_hist->bounds_count && val > p_hist->p_bounds[i])
+        i++;
+
+    p_hist->counts[MIN(i, HISTOGRAM_MAX_BUCKETS - 1)]++;
+}
+
+void histogram_reset(struct histogram *p_hist)
+{
+    memset(p_hist->counts, 0, sizeof(p_hist->counts));
+}
+
+size_t histogram_buckets(const struct histogram *p_hist)
+{
+    return MIN(p_hist->bounds_count + 1, HISTOGRAM_MAX_BUCKETS);
+}
+
+uint32_t histogram_total(const struct histogram *p_hist)
+{
+    uint32_t total = 0;
+
+    for (size_t i = 0; i < histogram_buckets(p_hist); i++)
+        total += p_hist->counts[i];
+
+    return total;
+}
+
+int32_t histogram_percentile(const struct histogram *p_hist, uint8_t pct)
+{
+    uint32_t total = histogram_total(p_hist);
+
+    if (total == 0)
+        return 0;
+
+    /* Rank of the value we're looking for (1 based) */
+    uint64_t rank = MAX(((uint64_t)total * MIN(pct, 100) + 99) / 100, 1);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < p_hist->bounds_count; i++)
+    {
+        seen += p_hist->counts[i];
+
+        if (seen >= rank)
+            return p_hist->p_bounds[i];
+    }
+
+    return INT32_MAX;
+}
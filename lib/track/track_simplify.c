@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <lib/track/track_simplify.h>
+
+/* Meters per degree of latitude (mean earth radius) */
+#define TRACK_SIMPLIFY_M_PER_DEG 111194.93f
+#define TRACK_SIMPLIFY_RAD_PER_DEG 0.017453293f
+
+/* Local flat projection around the anchor. Good enough for segments of a few km. */
+static void track_simplify_project(const struct track_simplify_point *p_origin,
+                                   const struct track_simplify_point *p_point,
+                                   float *p_x, float *p_y)
+{
+    float cos_lat = cosf((float)p_origin->lat * TRACK_SIMPLIFY_RAD_PER_DEG);
+
+    *p_x = (float)(p_point->lng - p_origin->lng) * cos_lat * TRACK_SIMPLIFY_M_PER_DEG;
+    *p_y = (float)(p_point->lat - p_origin->lat) * TRACK_SIMPLIFY_M_PER_DEG;
+}
+
+/* Distance between a point and the segment start -> end (m) */
+static float track_simplify_distance(const struct track_simplify_point *p_start,
+                                     const struct track_simplify_point *p_end,
+                                     const struct track_simplify_point *p_point)
+{
+    float ex, ey, px, py;
+
+    track_simplify_project(p_start, p_end, &ex, &ey);
+    track_simplify_project(p_start, p_point, &px, &py);
+
+    float len_sq = ex * ex + ey * ey;
+    float t = 0.0f;
+
+    /* Project onto the segment, clamped to the end points */
+    if (len_sq > 0.0f)
+    {
+        t = (px * ex + py * ey) / len_sq;
+
+        if (t < 0.0f)
+            t = 0.0f;
+        else if (t > 1.0f)
+            t = 1.0f;
+    }
+
+    float dx = px - t * ex;
+    float dy = py - t * ey;
+
+    return sqrtf(dx * dx + dy * dy);
+}
+
+/* Largest distance between the held points and the segment anchor -> end */
+static float track_simplify_max_distance(struct track_simplify *p_ctx, size_t count,
+                                         const struct track_simplify_point *p_end)
+{
+    float max = 0.0f;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float dist = track_simplify_distance(&p_ctx->anchor, p_end, &p_ctx->pending[i]);
+
+        if (dist > max)
+            max = dist;
+    }
+
+    return max;
+}
+
+/* Closes the segment at pending[index]. Everything before it is dropped. */
+static void track_simplify_close(struct track_simplify *p_ctx, size_t index)
+{
+    struct track_simplify_point *p_end = &p_ctx->pending[index];
+
+    for (size_t i = 0; i < index; i++)
+    {
+        float dist = track_simplify_distance(&p_ctx->anchor, p_end, &p_ctx->pending[i]);
+
+        p_ctx->stats.points_dropped++;
+        p_ctx->stats.sum_error_m += dist;
+
+        if (dist > p_ctx->stats.max_error_m)
+            p_ctx->stats.max_error_m = dist;
+    }
+
+    p_ctx->anchor = *p_end;
+    p_ctx->stats.points_out++;
+
+    /* Move whatever came after the vertex to the front */
+    size_t remaining = p_ctx->pending_count - index - 1;
+
+    memmove(&p_ctx->pending[0], &p_ctx->pending[index + 1],
+            remaining * sizeof(struct track_simplify_point));
+    p_ctx->pending_count = remaining;
+}
+
+void track_simplify_init(struct track_simplify *p_ctx, float tolerance_m, int64_t max_hold_ms)
+{
+    memset(p_ctx, 0, sizeof(struct track_simplify));
+
+    p_ctx->tolerance_m = tolerance_m;
+    p_ctx->max_hold_ms = max_hold_ms;
+}
+
+enum track_simplify_result track_simplify_push(struct track_simplify *p_ctx,
+                                               const struct track_simplify_point *p_point)
+{
+    p_ctx->stats.points_in++;
+
+    /* First point always starts the track */
+    if (!p_ctx->has_anchor)
+    {
+        p_ctx->anchor = *p_point;
+        p_ctx->has_anchor = true;
+        p_ctx->stats.points_out++;
+
+        return TRACK_SIMPLIFY_EMIT_CURRENT;
+    }
+
+    /* If a straight line to the new point no longer covers the held points
+     * the previous point is a vertex. Same if we've run out of room. */
+    if (p_ctx->pending_count > 0 &&
+        (p_ctx->pending_count == CONFIG_TRACK_SIMPLIFY_WINDOW ||
+         track_simplify_max_distance(p_ctx, p_ctx->pending_count, p_point) > p_ctx->tolerance_m))
+    {
+        track_simplify_close(p_ctx, p_ctx->pending_count - 1);
+
+        p_ctx->pending[0] = *p_point;
+        p_ctx->pending_count = 1;
+
+        return TRACK_SIMPLIFY_EMIT_PREVIOUS;
+    }
+
+    p_ctx->pending[p_ctx->pending_count++] = *p_point;
+
+    /* Don't hold on to the track forever */
+    if (p_ctx->max_hold_ms > 0 && (p_point->ts - p_ctx->anchor.ts) >= p_ctx->max_hold_ms)
+    {
+        track_simplify_close(p_ctx, p_ctx->pending_count - 1);
+
+        return TRACK_SIMPLIFY_EMIT_CURRENT;
+    }
+
+    return TRACK_SIMPLIFY_HOLD;
+}
+
+bool track_simplify_flush(struct track_simplify *p_ctx)
+{
+    if (p_ctx->pending_count == 0)
+        return false;
+
+    track_simplify_close(p_ctx, p_ctx->pending_count - 1);
+
+    return true;
+}
+
+void track_simplify_stats_get(struct track_simplify *p_ctx, struct track_simplify_stats *p_stats)
+{
+    *p_stats = p_ctx->stats;
+}
@@ -0,0 +1,613 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(ts_store);
+
+#include <lib/ts_store/ts_store.h>
+
+/*
+ * Layout
+ *
+ * Records are appended to segment files named after their first timestamp
+ * (<dir>/<ts in hex>.d). A segment is split into fixed size blocks and
+ * records never cross a block. Each segment has an index file (.i) with
+ * the first timestamp of every block, so block k starts at k * block size.
+ *
+ * A query picks the segment by name, binary searches its index with
+ * seeks and then reads forward from the right block.
+ *
+ * The index entry for a block is written before its first record. After a
+ * reset the index may be ahead of the data, never behind, and it's trimmed
+ * to match at init.
+ */
+
+#define TS_STORE_BLOCK CONFIG_TS_STORE_BLOCK_SIZE
+#define TS_STORE_PAD 0xffff
+
+struct ts_store_hdr
+{
+    int64_t ts;
+    uint16_t len;
+} __packed;
+
+static char *ts_store_path(struct ts_store *p_store, int64_t first_ts, char type)
+{
+    snprintf(p_store->path, sizeof(p_store->path), "%s/%016llx.%c",
+             p_store->config.p_dir, (unsigned long long)first_ts, type);
+
+    return p_store->path;
+}
+
+static int ts_store_cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int ts_store_segment_delete(struct ts_store *p_store, uint16_t index)
+{
+    int err;
+    int64_t first_ts = p_store->segments[index];
+
+    err = fs_unlink(ts_store_path(p_store, first_ts, 'd'));
+    if (err && err != -ENOENT)
+        return err;
+
+    err = fs_unlink(ts_store_path(p_store, first_ts, 'i'));
+    if (err && err != -ENOENT)
+        return err;
+
+    memmove(&p_store->segments[index], &p_store->segments[index + 1],
+            (p_store->segment_count - index - 1) * sizeof(int64_t));
+    p_store->segment_count--;
+
+    return 0;
+}
+
+static int ts_store_index_append(struct ts_store *p_store, int64_t ts)
+{
+    int err;
+    struct fs_file_t file;
+    int64_t first_ts = p_store->segments[p_store->segment_count - 1];
+
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, ts_store_path(p_store, first_ts, 'i'), FS_O_CREATE | FS_O_APPEND | FS_O_WRITE);
+    if (err)
+        return err;
+
+    err = fs_write(&file, &ts, sizeof(ts));
+
+    int close_err = fs_close(&file);
+
+    if (err < 0)
+        return err;
+
+    if (close_err)
+        return close_err;
+
+    p_store->indexed_blocks++;
+
+    return 0;
+}
+
+static int ts_store_segment_open(struct ts_store *p_store, int64_t first_ts)
+{
+    int err;
+
+    fs_file_t_init(&p_store->file);
+
+    err = fs_open(&p_store->file, ts_store_path(p_store, first_ts, 'd'), FS_O_CREATE | FS_O_RDWR);
+    if (err)
+        return err;
+
+    err = fs_seek(&p_store->file, 0, FS_SEEK_END);
+    if (err)
+    {
+        fs_close(&p_store->file);
+        return err;
+    }
+
+    p_store->head_off = fs_tell(&p_store->file);
+    p_store->file_open = true;
+
+    return 0;
+}
+
+static int ts_store_segment_new(struct ts_store *p_store, int64_t first_ts)
+{
+    int err;
+
+    if (p_store->file_open)
+    {
+        p_store->file_open = false;
+
+        err = fs_close(&p_store->file);
+        if (err)
+            return err;
+    }
+
+    /* Make room */
+    while (p_store->segment_count >= p_store->config.max_segments)
+    {
+        err = ts_store_segment_delete(p_store, 0);
+        if (err)
+            return err;
+
+        p_store->stats.segments_deleted++;
+    }
+
+    /* Two segments can't share a name */
+    if (p_store->segment_count > 0 && p_store->segments[p_store->segment_count - 1] == first_ts)
+        return -EEXIST;
+
+    /* Left over index from a segment that never got data */
+    err = fs_unlink(ts_store_path(p_store, first_ts, 'i'));
+    if (err && err != -ENOENT)
+        return err;
+
+    p_store->segments[p_store->segment_count++] = first_ts;
+    p_store->indexed_blocks = 0;
+
+    return ts_store_segment_open(p_store, first_ts);
+}
+
+/* Finds the last record in the newest segment and trims the index */
+static int ts_store_recover(struct ts_store *p_store)
+{
+    int err;
+    struct fs_dirent entry;
+    int64_t first_ts = p_store->segments[p_store->segment_count - 1];
+
+    err = ts_store_segment_open(p_store, first_ts);
+    if (err)
+        return err;
+
+    uint32_t blocks = DIV_ROUND_UP(p_store->head_off, TS_STORE_BLOCK);
+
+    p_store->indexed_blocks = blocks;
+
+    err = fs_stat(ts_store_path(p_store, first_ts, 'i'), &entry);
+    if (err == 0 && entry.size > blocks * sizeof(int64_t))
+    {
+        struct fs_file_t file;
+
+        LOG_WRN("Trimming index of segment %016llx", (unsigned long long)first_ts);
+
+        fs_file_t_init(&file);
+
+        err = fs_open(&file, p_store->path, FS_O_RDWR);
+        if (err)
+            return err;
+
+        err = fs_truncate(&file, blocks * sizeof(int64_t));
+        fs_close(&file);
+
+        if (err)
+            return err;
+    }
+
+    /* Walk the last block for the newest timestamp */
+    p_store->last_ts = first_ts;
+
+    if (blocks == 0)
+        return 0;
+
+    off_t off = (blocks - 1) * TS_STORE_BLOCK;
+    size_t pos = 0;
+
+    err = fs_seek(&p_store->file, off, FS_SEEK_SET);
+    if (err)
+        return err;
+
+    ssize_t len = fs_read(&p_store->file, p_store->block, TS_STORE_BLOCK);
+    if (len < 0)
+        return len;
+
+    while (pos + sizeof(struct ts_store_hdr) <= (size_t)len)
+    {
+        struct ts_store_hdr hdr;
+
+        memcpy(&hdr, &p_store->block[pos], sizeof(hdr));
+
+        if (hdr.len == TS_STORE_PAD || pos + sizeof(hdr) + hdr.len > (size_t)len)
+            break;
+
+        p_store->last_ts = hdr.ts;
+        pos += sizeof(hdr) + hdr.len;
+    }
+
+    return fs_seek(&p_store->file, 0, FS_SEEK_END);
+}
+
+int ts_store_init(struct ts_store *p_store, const struct ts_store_config *p_config)
+{
+    int err;
+    struct fs_dir_t dir;
+    struct fs_dirent entry;
+
+    if (p_config->max_segments == 0 || p_config->max_segments > CONFIG_TS_STORE_MAX_SEGMENTS ||
+        p_config->segment_blocks == 0)
+        return -EINVAL;
+
+    memset(p_store, 0, sizeof(*p_store));
+    k_mutex_init(&p_store->lock);
+    p_store->config = *p_config;
+
+    fs_dir_t_init(&dir);
+
+    err = fs_opendir(&dir, p_config->p_dir);
+    if (err)
+    {
+        LOG_ERR("Unable to open %s. Err: %i", p_config->p_dir, err);
+        return err;
+    }
+
+    /* Segments are named after their first timestamp */
+    while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0')
+    {
+        char *p_end;
+        int64_t first_ts = (int64_t)strtoull(entry.name, &p_end, 16);
+
+        if (entry.type != FS_DIR_ENTRY_FILE || strcmp(p_end, ".d") != 0)
+            continue;
+
+        if (p_store->segment_count == CONFIG_TS_STORE_MAX_SEGMENTS)
+        {
+            LOG_WRN("Too many segments in %s", p_config->p_dir);
+            break;
+        }
+
+        p_store->segments[p_store->segment_count++] = first_ts;
+    }
+
+    fs_closedir(&dir);
+
+    qsort(p_store->segments, p_store->segment_count, sizeof(int64_t), ts_store_cmp);
+
+    if (p_store->segment_count > 0)
+    {
+        err = ts_store_recover(p_store);
+        if (err)
+        {
+            LOG_ERR("Unable to recover newest segment. Err: %i", err);
+            return err;
+        }
+    }
+
+    LOG_INF("%u segments in %s", p_store->segment_count, p_config->p_dir);
+
+    return 0;
+}
+
+int ts_store_close(struct ts_store *p_store)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    if (p_store->file_open)
+    {
+        p_store->file_open = false;
+        err = fs_close(&p_store->file);
+    }
+
+    k_mutex_unlock(&p_store->lock);
+
+    return err;
+}
+
+/* All or nothing. A failed write is cut off again. */
+static int ts_store_write(struct ts_store *p_store, const void *p_data, size_t len)
+{
+    ssize_t written = fs_write(&p_store->file, p_data, len);
+
+    if (written == len)
+    {
+        p_store->head_off += len;
+        return 0;
+    }
+
+    fs_truncate(&p_store->file, p_store->head_off);
+    fs_seek(&p_store->file, 0, FS_SEEK_END);
+
+    return written < 0 ? written : -ENOSPC;
+}
+
+static int ts_store_append_locked(struct ts_store *p_store, int64_t ts, const void *p_data, size_t len)
+{
+    int err;
+    uint32_t segment_size = p_store->config.segment_blocks * TS_STORE_BLOCK;
+    struct ts_store_hdr hdr = {
+        .ts = ts,
+        .len = len,
+    };
+
+    /* Finish the block if the record doesn't fit */
+    uint32_t rem = TS_STORE_BLOCK - (p_store->head_off % TS_STORE_BLOCK);
+
+    if (p_store->file_open && rem < TS_STORE_BLOCK && rem < sizeof(hdr) + len)
+    {
+        memset(p_store->block, 0xff, rem);
+
+        err = ts_store_write(p_store, p_store->block, rem);
+        if (err)
+            return err;
+
+        p_store->stats.pad_bytes += rem;
+    }
+
+    if (!p_store->file_open || p_store->head_off >= segment_size)
+    {
+        err = ts_store_segment_new(p_store, ts);
+        if (err)
+            return err;
+    }
+
+    /* First record of a block goes into the index */
+    if (p_store->head_off / TS_STORE_BLOCK >= p_store->indexed_blocks)
+    {
+        err = ts_store_index_append(p_store, ts);
+        if (err)
+            return err;
+    }
+
+    /* Header and data in one write */
+    memcpy(p_store->block, &hdr, sizeof(hdr));
+    memcpy(p_store->block + sizeof(hdr), p_data, len);
+
+    return ts_store_write(p_store, p_store->block, sizeof(hdr) + len);
+}
+
+int ts_store_append(struct ts_store *p_store, int64_t ts, const void *p_data, size_t len)
+{
+    int err;
+
+    if (len + sizeof(struct ts_store_hdr) > TS_STORE_BLOCK || len >= TS_STORE_PAD)
+        return -EMSGSIZE;
+
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    if (p_store->segment_count > 0 && ts < p_store->last_ts)
+    {
+        err = -EINVAL;
+        goto unlock;
+    }
+
+    err = ts_store_append_locked(p_store, ts, p_data, len);
+
+    /* Full file system. Drop the oldest segment and try again. */
+    if (err == -ENOSPC && p_store->segment_count > 1)
+    {
+        LOG_WRN("Out of space. Deleting oldest segment.");
+
+        err = ts_store_segment_delete(p_store, 0);
+        if (err == 0)
+        {
+            p_store->stats.segments_deleted++;
+            err = ts_store_append_locked(p_store, ts, p_data, len);
+        }
+    }
+
+    if (err == 0)
+    {
+        p_store->last_ts = ts;
+        p_store->stats.appends++;
+    }
+
+unlock:
+    k_mutex_unlock(&p_store->lock);
+
+    return err;
+}
+
+int ts_store_sync(struct ts_store *p_store)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    if (p_store->file_open)
+        err = fs_sync(&p_store->file);
+
+    k_mutex_unlock(&p_store->lock);
+
+    return err;
+}
+
+/* Last block whose first timestamp is before from. Block 0 if there's none. */
+static int ts_store_index_search(struct ts_store *p_store, int64_t first_ts, int64_t from, uint32_t *p_block)
+{
+    int err;
+    struct fs_file_t file;
+    struct fs_dirent entry;
+
+    err = fs_stat(ts_store_path(p_store, first_ts, 'i'), &entry);
+    if (err)
+        return err;
+
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, p_store->path, FS_O_READ);
+    if (err)
+        return err;
+
+    uint32_t lo = 0;
+    uint32_t hi = entry.size / sizeof(int64_t);
+
+    while (lo < hi)
+    {
+        int64_t ts;
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        err = fs_seek(&file, mid * sizeof(int64_t), FS_SEEK_SET);
+        if (err)
+            break;
+
+        if (fs_read(&file, &ts, sizeof(ts)) != sizeof(ts))
+        {
+            err = -EIO;
+            break;
+        }
+
+        p_store->stats.index_reads++;
+
+        if (ts < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    fs_close(&file);
+
+    *p_block = lo > 0 ? lo - 1 : 0;
+
+    return err;
+}
+
+/* Returns 1 once past the end of the range */
+static int ts_store_segment_query(struct ts_store *p_store, int64_t first_ts, uint32_t block,
+                                  int64_t from, int64_t to, ts_store_cb_t cb, void *p_user, int *p_count)
+{
+    int err;
+    struct fs_file_t file;
+
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, ts_store_path(p_store, first_ts, 'd'), FS_O_READ);
+    if (err)
+        return err;
+
+    err = fs_seek(&file, (off_t)block * TS_STORE_BLOCK, FS_SEEK_SET);
+
+    while (err == 0)
+    {
+        size_t pos = 0;
+        ssize_t len = fs_read(&file, p_store->block, TS_STORE_BLOCK);
+
+        if (len <= 0)
+        {
+            err = len;
+            break;
+        }
+
+        p_store->stats.blocks_read++;
+
+        while (err == 0 && pos + sizeof(struct ts_store_hdr) <= (size_t)len)
+        {
+            struct ts_store_hdr hdr;
+
+            memcpy(&hdr, &p_store->block[pos], sizeof(hdr));
+
+            if (hdr.len == TS_STORE_PAD || pos + sizeof(hdr) + hdr.len > (size_t)len)
+                break;
+
+            if (hdr.ts > to)
+            {
+                err = 1;
+                break;
+            }
+
+            if (hdr.ts >= from)
+            {
+                (*p_count)++;
+
+                /* Stopped by the caller */
+                if (cb(hdr.ts, &p_store->block[pos + sizeof(hdr)], hdr.len, p_user))
+                    err = 1;
+            }
+
+            pos += sizeof(hdr) + hdr.len;
+        }
+    }
+
+    fs_close(&file);
+
+    return err;
+}
+
+int ts_store_query(struct ts_store *p_store, int64_t from, int64_t to, ts_store_cb_t cb, void *p_user)
+{
+    int err = 0;
+    int count = 0;
+
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    /* Queries read through their own handle */
+    if (p_store->file_open)
+    {
+        err = fs_sync(&p_store->file);
+        if (err)
+            goto unlock;
+    }
+
+    /* Last segment starting before the range */
+    uint16_t seg = 0;
+
+    while (seg + 1 < p_store->segment_count && p_store->segments[seg + 1] < from)
+        seg++;
+
+    for (; seg < p_store->segment_count && p_store->segments[seg] <= to; seg++)
+    {
+        uint32_t block = 0;
+        int64_t first_ts = p_store->segments[seg];
+
+        if (first_ts < from)
+        {
+            err = ts_store_index_search(p_store, first_ts, from, &block);
+            if (err)
+                break;
+        }
+
+        err = ts_store_segment_query(p_store, first_ts, block, from, to, cb, p_user, &count);
+        if (err)
+            break;
+    }
+
+unlock:
+    k_mutex_unlock(&p_store->lock);
+
+    return err < 0 ? err : count;
+}
+
+int ts_store_clear(struct ts_store *p_store)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    if (p_store->file_open)
+    {
+        p_store->file_open = false;
+        fs_close(&p_store->file);
+    }
+
+    while (p_store->segment_count > 0 && err == 0)
+        err = ts_store_segment_delete(p_store, 0);
+
+    p_store->head_off = 0;
+    p_store->last_ts = 0;
+
+    k_mutex_unlock(&p_store->lock);
+
+    return err;
+}
+
+void ts_store_stats_get(struct ts_store *p_store, struct ts_store_stats *p_stats)
+{
+    k_mutex_lock(&p_store->lock, K_FOREVER);
+
+    *p_stats = p_store->stats;
+
+    k_mutex_unlock(&p_store->lock);
+}
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/uplink_batch/uplink_batch.h>
+
+/* CBOR major type 4 (array) */
+#define CBOR_ARRAY 0x80
+#define CBOR_UINT8_FOLLOWS 24
+#define CBOR_UINT16_FOLLOWS 25
+
+void uplink_batch_init(struct uplink_batch *p_batch, uint8_t *p_mem, size_t size,
+                       uint32_t max_age_ms, uplink_batch_send_t send,
+                       uplink_batch_expired_t expired, void *p_user)
+{
+    memset(p_batch, 0, sizeof(*p_batch));
+    k_mutex_init(&p_batch->lock);
+
+    p_batch->slot_size = size / CONFIG_UPLINK_BATCH_TOPICS;
+    p_batch->max_age_ms = max_age_ms;
+    p_batch->send = send;
+    p_batch->expired = expired;
+    p_batch->p_user = p_user;
+
+    for (int i = 0; i < CONFIG_UPLINK_BATCH_TOPICS; i++)
+        p_batch->slots[i].p_buf = &p_mem[i * p_batch->slot_size];
+}
+
+/* Writes the header of an array of the first count records right in front
+ * of them */
+static uint8_t *uplink_batch_header(struct uplink_batch_slot *p_slot, uint16_t count,
+                                    size_t *p_len)
+{
+    uint8_t *p_start = &p_slot->p_buf[UPLINK_BATCH_HEADER];
+
+    if (count < CBOR_UINT8_FOLLOWS)
+    {
+        *--p_start = CBOR_ARRAY | count;
+    }
+    else if (count <= UINT8_MAX)
+    {
+        *--p_start = count;
+        *--p_start = CBOR_ARRAY | CBOR_UINT8_FOLLOWS;
+    }
+    else
+    {
+        *--p_start = count & 0xff;
+        *--p_start = count >> 8;
+        *--p_start = CBOR_ARRAY | CBOR_UINT16_FOLLOWS;
+    }
+
+    *p_len = &p_slot->p_buf[UPLINK_BATCH_HEADER + p_slot->records[count - 1].end] - p_start;
+
+    return p_start;
+}
+
+/* The last of the first count records */
+static uint8_t *uplink_batch_latest(struct uplink_batch_slot *p_slot, uint16_t count,
+                                    size_t *p_len)
+{
+    size_t start = count > 1 ? p_slot->records[count - 2].end : 0;
+
+    *p_len = p_slot->records[count - 1].end - start;
+
+    return &p_slot->p_buf[UPLINK_BATCH_HEADER + start];
+}
+
+static void uplink_batch_clear(struct uplink_batch_slot *p_slot)
+{
+    p_slot->used = 0;
+    p_slot->count = 0;
+}
+
+/* Class first, then deadline, then age */
+static bool uplink_batch_before(const struct uplink_batch_slot *p_a,
+                                const struct uplink_batch_slot *p_b)
+{
+    if (p_a->prio != p_b->prio)
+        return p_a->prio < p_b->prio;
+
+    if (p_a->deadline_ms != p_b->deadline_ms)
+        return p_a->deadline_ms < p_b->deadline_ms;
+
+    return p_a->first_ms < p_b->first_ms;
+}
+
+/* Non-empty slots in the order they should go out */
+static int uplink_batch_order_locked(struct uplink_batch *p_batch,
+                                     struct uplink_batch_slot *p_order[])
+{
+    int count = 0;
+
+    for (int i = 0; i < CONFIG_UPLINK_BATCH_TOPICS; i++)
+    {
+        struct uplink_batch_slot *p_slot = &p_batch->slots[i];
+        int j = count;
+
+        if (p_slot->count == 0)
+            continue;
+
+        count++;
+
+        /* Insertion sort. There are only a few. */
+        for (; j > 0 && uplink_batch_before(p_slot, p_order[j - 1]); j--)
+            p_order[j] = p_order[j - 1];
+
+        p_order[j] = p_slot;
+    }
+
+    return count;
+}
+
+static int uplink_batch_send_locked(struct uplink_batch *p_batch, struct uplink_batch_slot *p_slot,
+                                    enum uplink_batch_reason reason)
+{
+    size_t len;
+
+    if (p_slot->count == 0)
+        return 0;
+
+    size_t latest_len;
+    uint8_t *p_packed = uplink_batch_header(p_slot, p_slot->count, &len);
+    uint8_t *p_latest = uplink_batch_latest(p_slot, p_slot->count, &latest_len);
+
+    int err = p_batch->send(p_slot->topic, p_packed, len, p_latest, latest_len, p_slot->count,
+                            p_batch->p_user);
+    if (err)
+    {
+        p_batch->stats.send_errors++;
+        return err;
+    }
+
+    p_batch->stats.uplinks++;
+    p_batch->stats.bytes += len;
+    p_batch->stats.reasons[reason]++;
+
+    uplink_batch_clear(p_slot);
+
+    return 0;
+}
+
+/* Hands over the records up to the last one that's past its deadline */
+static void uplink_batch_expire_locked(struct uplink_batch *p_batch,
+                                       struct uplink_batch_slot *p_slot, int64_t now_ms)
+{
+    uint16_t expired = 0;
+    size_t len, latest_len;
+
+    for (uint16_t i = 0; i < p_slot->count; i++)
+    {
+        if (now_ms >= p_slot->records[i].deadline_ms)
+            expired = i + 1;
+    }
+
+    if (expired == 0)
+        return;
+
+    uint8_t *p_packed = uplink_batch_header(p_slot, expired, &len);
+    uint8_t *p_latest = uplink_batch_latest(p_slot, expired, &latest_len);
+
+    p_batch->stats.expired += expired;
+
+    if (p_batch->expired)
+        p_batch->expired(p_slot->topic, p_slot->prio, p_packed, len, p_latest, latest_len,
+                         expired, p_batch->p_user);
+
+    if (expired == p_slot->count)
+    {
+        uplink_batch_clear(p_slot);
+        return;
+    }
+
+    /* Newer records keep waiting. Age still counts from the expired ones, so
+     * they go out no later than they would have. */
+    size_t cut = p_slot->records[expired - 1].end;
+    uint8_t *p_records = &p_slot->p_buf[UPLINK_BATCH_HEADER];
+
+    memmove(p_records, &p_records[cut], p_slot->used - cut);
+    p_slot->used -= cut;
+    p_slot->count -= expired;
+    p_slot->deadline_ms = UPLINK_BATCH_NO_DEADLINE;
+
+    for (uint16_t i = 0; i < p_slot->count; i++)
+    {
+        p_slot->records[i] = p_slot->records[i + expired];
+        p_slot->records[i].end -= cut;
+        p_slot->deadline_ms = MIN(p_slot->deadline_ms, p_slot->records[i].deadline_ms);
+    }
+}
+
+static int uplink_batch_flush_locked(struct uplink_batch *p_batch, enum uplink_batch_reason reason)
+{
+    struct uplink_batch_slot *order[CONFIG_UPLINK_BATCH_TOPICS];
+    int count = uplink_batch_order_locked(p_batch, order);
+
+    for (int i = 0; i < count; i++)
+    {
+        int err = uplink_batch_send_locked(p_batch, order[i], reason);
+
+        /* Likely out of coverage. The rest waits for the next window. */
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static struct uplink_batch_slot *uplink_batch_slot_get(struct uplink_batch *p_batch,
+                                                       const char *p_topic)
+{
+    struct uplink_batch_slot *p_free = NULL;
+
+    for (int i = 0; i < CONFIG_UPLINK_BATCH_TOPICS; i++)
+    {
+        struct uplink_batch_slot *p_slot = &p_batch->slots[i];
+
+        if (strncmp(p_slot->topic, p_topic, sizeof(p_slot->topic)) == 0)
+            return p_slot;
+
+        if (p_free == NULL && p_slot->count == 0)
+            p_free = p_slot;
+    }
+
+    /* Take over an empty one */
+    if (p_free)
+    {
+        strncpy(p_free->topic, p_topic, sizeof(p_free->topic) - 1);
+        p_free->topic[sizeof(p_free->topic) - 1] = '\0';
+    }
+
+    return p_free;
+}
+
+int uplink_batch_put(struct uplink_batch *p_batch, const char *p_topic, const uint8_t *p_data,
+                     size_t len, uint8_t prio, int64_t deadline_ms, int64_t now_ms)
+{
+    int err = 0;
+
+    if (len + UPLINK_BATCH_HEADER > p_batch->slot_size || len == 0)
+        return -EMSGSIZE;
+
+    if (strlen(p_topic) >= CONFIG_UPLINK_BATCH_TOPIC_LEN)
+        return -EINVAL;
+
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    struct uplink_batch_slot *p_slot = uplink_batch_slot_get(p_batch, p_topic);
+    if (p_slot == NULL)
+    {
+        err = -ENOSPC;
+        goto unlock;
+    }
+
+    /* Make room */
+    if (UPLINK_BATCH_HEADER + p_slot->used + len > p_batch->slot_size ||
+        p_slot->count == CONFIG_UPLINK_BATCH_RECORDS)
+    {
+        err = uplink_batch_send_locked(p_batch, p_slot, UPLINK_BATCH_FLUSH_SIZE);
+        if (err)
+            goto unlock;
+    }
+
+    if (p_slot->count == 0)
+    {
+        p_slot->first_ms = now_ms;
+        p_slot->prio = prio;
+        p_slot->deadline_ms = deadline_ms;
+    }
+
+    /* The batch goes out as one. It's as important as its best record. */
+    p_slot->prio = MIN(p_slot->prio, prio);
+    p_slot->deadline_ms = MIN(p_slot->deadline_ms, deadline_ms);
+
+    memcpy(&p_slot->p_buf[UPLINK_BATCH_HEADER + p_slot->used], p_data, len);
+    p_slot->used += len;
+    p_slot->records[p_slot->count].end = p_slot->used;
+    p_slot->records[p_slot->count].deadline_ms = deadline_ms;
+    p_slot->count++;
+    p_batch->stats.records++;
+
+    /* The record is taken either way. A failed send is retried later. */
+    if (prio == UPLINK_BATCH_PRIO_URGENT)
+        uplink_batch_flush_locked(p_batch, UPLINK_BATCH_FLUSH_URGENT);
+
+unlock:
+    k_mutex_unlock(&p_batch->lock);
+
+    return err;
+}
+
+int uplink_batch_flush(struct uplink_batch *p_batch, enum uplink_batch_reason reason)
+{
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    int err = uplink_batch_flush_locked(p_batch, reason);
+
+    k_mutex_unlock(&p_batch->lock);
+
+    return err;
+}
+
+int uplink_batch_poll(struct uplink_batch *p_batch, int64_t now_ms)
+{
+    int ret = 0;
+    struct uplink_batch_slot *order[CONFIG_UPLINK_BATCH_TOPICS];
+
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    int count = uplink_batch_order_locked(p_batch, order);
+
+    for (int i = 0; i < count; i++)
+    {
+        struct uplink_batch_slot *p_slot = order[i];
+
+        /* Missed every window. Not worth waking the radio for now. */
+        if (now_ms >= p_slot->deadline_ms)
+            uplink_batch_expire_locked(p_batch, p_slot, now_ms);
+
+        /* After a failure only the expired ones are dealt with */
+        if (p_slot->count == 0 || ret || now_ms - p_slot->first_ms < p_batch->max_age_ms)
+            continue;
+
+        ret = uplink_batch_send_locked(p_batch, p_slot, UPLINK_BATCH_FLUSH_AGE);
+    }
+
+    k_mutex_unlock(&p_batch->lock);
+
+    return ret;
+}
+
+int64_t uplink_batch_deadline(struct uplink_batch *p_batch)
+{
+    int64_t deadline = INT64_MAX;
+
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_UPLINK_BATCH_TOPICS; i++)
+    {
+        struct uplink_batch_slot *p_slot = &p_batch->slots[i];
+
+        if (p_slot->count)
+            deadline = MIN(deadline, MIN(p_slot->first_ms + p_batch->max_age_ms,
+                                         p_slot->deadline_ms));
+    }
+
+    k_mutex_unlock(&p_batch->lock);
+
+    return deadline;
+}
+
+int64_t uplink_batch_expiry(struct uplink_batch *p_batch)
+{
+    int64_t expiry = INT64_MAX;
+
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_UPLINK_BATCH_TOPICS; i++)
+    {
+        if (p_batch->slots[i].count)
+            expiry = MIN(expiry, p_batch->slots[i].deadline_ms);
+    }
+
+    k_mutex_unlock(&p_batch->lock);
+
+    return expiry;
+}
+
+void uplink_batch_stats_get(struct uplink_batch *p_batch, struct uplink_batch_stats *p_stats)
+{
+    k_mutex_lock(&p_batch->lock, K_FOREVER);
+
+    *p_stats = p_batch->stats;
+
+    k_mutex_unlock(&p_batch->lock);
+}
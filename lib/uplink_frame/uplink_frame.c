@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/uplink_frame/uplink_frame.h>
+
+#define LEB128_MORE 0x80
+
+void uplink_frame_init(struct uplink_frame *p_frame, uint8_t *p_buf, size_t size)
+{
+    p_frame->p_buf = p_buf;
+    p_frame->size = size;
+
+    uplink_frame_reset(p_frame);
+}
+
+void uplink_frame_reset(struct uplink_frame *p_frame)
+{
+    p_frame->p_buf[0] = UPLINK_FRAME_VERSION;
+    p_frame->used = 1;
+    p_frame->count = 0;
+}
+
+int uplink_frame_add(struct uplink_frame *p_frame, const uint8_t *p_data, size_t len)
+{
+    size_t header = len < LEB128_MORE ? 1 : 2;
+
+    if (len == 0 || len > UPLINK_FRAME_RECORD_MAX || 1 + header + len > p_frame->size)
+        return -EMSGSIZE;
+
+    if (p_frame->used + header + len > p_frame->size || p_frame->count == UINT16_MAX)
+        return -ENOSPC;
+
+    uint8_t *p_out = &p_frame->p_buf[p_frame->used];
+
+    if (header == 1)
+    {
+        *p_out++ = len;
+    }
+    else
+    {
+        *p_out++ = LEB128_MORE | (len & 0x7f);
+        *p_out++ = len >> 7;
+    }
+
+    memcpy(p_out, p_data, len);
+    p_frame->used += header + len;
+    p_frame->count++;
+
+    return 0;
+}
+
+int uplink_frame_next(const uint8_t *p_buf, size_t len, size_t *p_offset,
+                      const uint8_t **pp_record, size_t *p_record_len)
+{
+    size_t offset = *p_offset;
+
+    if (offset == 0)
+    {
+        if (len == 0 || p_buf[0] != UPLINK_FRAME_VERSION)
+            return -EBADMSG;
+
+        offset = 1;
+    }
+
+    if (offset >= len)
+        return -ENOENT;
+
+    size_t record_len = p_buf[offset] & 0x7f;
+
+    if (p_buf[offset++] & LEB128_MORE)
+    {
+        /* Never more than 2 bytes */
+        if (offset >= len || p_buf[offset] & LEB128_MORE)
+            return -EBADMSG;
+
+        record_len |= p_buf[offset++] << 7;
+    }
+
+    if (record_len == 0 || record_len > len - offset)
+        return -EBADMSG;
+
+    *pp_record = &p_buf[offset];
+    *p_record_len = record_len;
+    *p_offset = offset + record_len;
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <lib/write_buffer/write_buffer.h>
+
+/* Records are framed with a 16 bit length */
+#define WRITE_BUFFER_FRAME sizeof(uint16_t)
+
+void write_buffer_init(struct write_buffer *p_wb, uint8_t *p_buf, size_t size, uint32_t max_age_ms,
+                       write_buffer_flush_t flush, void *p_user)
+{
+    memset(p_wb, 0, sizeof(*p_wb));
+    k_mutex_init(&p_wb->lock);
+
+    p_wb->p_buf = p_buf;
+    p_wb->size = size;
+    p_wb->max_age_ms = max_age_ms;
+    p_wb->flush = flush;
+    p_wb->p_user = p_user;
+}
+
+static int write_buffer_flush_locked(struct write_buffer *p_wb, enum write_buffer_reason reason)
+{
+    if (p_wb->used == 0)
+        return 0;
+
+    size_t done = 0;
+
+    int err = p_wb->flush(p_wb->p_buf, p_wb->used, &done, p_wb->p_user);
+    if (err)
+    {
+        p_wb->stats.flush_errors++;
+
+        /* Keep the rest for the next attempt. Writing them again would
+         * duplicate them. */
+        done = MIN(done, p_wb->used);
+        memmove(p_wb->p_buf, &p_wb->p_buf[done], p_wb->used - done);
+        p_wb->used -= done;
+        p_wb->stats.bytes_flushed += done;
+
+        return err;
+    }
+
+    p_wb->stats.flushes++;
+    p_wb->stats.bytes_flushed += p_wb->used;
+    p_wb->stats.reasons[reason]++;
+    p_wb->used = 0;
+
+    return 0;
+}
+
+int write_buffer_put(struct write_buffer *p_wb, const void *p_data, size_t len, int64_t now_ms)
+{
+    int err = 0;
+    uint16_t frame = len;
+
+    if (len + WRITE_BUFFER_FRAME > p_wb->size || len > UINT16_MAX)
+        return -EMSGSIZE;
+
+    k_mutex_lock(&p_wb->lock, K_FOREVER);
+
+    /* Make room */
+    if (p_wb->used + WRITE_BUFFER_FRAME + len > p_wb->size)
+    {
+        err = write_buffer_flush_locked(p_wb, WRITE_BUFFER_FLUSH_SIZE);
+        if (err)
+            goto unlock;
+    }
+
+    if (p_wb->used == 0)
+        p_wb->first_ms = now_ms;
+
+    memcpy(&p_wb->p_buf[p_wb->used], &frame, WRITE_BUFFER_FRAME);
+    memcpy(&p_wb->p_buf[p_wb->used + WRITE_BUFFER_FRAME], p_data, len);
+    p_wb->used += WRITE_BUFFER_FRAME + len;
+    p_wb->stats.records++;
+
+    /* Nothing else fits. Don't wait for the next record. The record is
+     * buffered either way so a failure here is retried on the next put. */
+    if (p_wb->size - p_wb->used <= WRITE_BUFFER_FRAME)
+        write_buffer_flush_locked(p_wb, WRITE_BUFFER_FLUSH_SIZE);
+
+unlock:
+    k_mutex_unlock(&p_wb->lock);
+
+    return err;
+}
+
+int write_buffer_flush(struct write_buffer *p_wb, enum write_buffer_reason reason)
+{
+    k_mutex_lock(&p_wb->lock, K_FOREVER);
+
+    int err = write_buffer_flush_locked(p_wb, reason);
+
+    k_mutex_unlock(&p_wb->lock);
+
+    return err;
+}
+
+int write_buffer_poll(struct write_buffer *p_wb, int64_t now_ms)
+{
+    int err = 0;
+
+    k_mutex_lock(&p_wb->lock, K_FOREVER);
+
+    if (p_wb->used > 0 && now_ms - p_wb->first_ms >= p_wb->max_age_ms)
+        err = write_buffer_flush_locked(p_wb, WRITE_BUFFER_FLUSH_AGE);
+
+    k_mutex_unlock(&p_wb->lock);
+
+    return err;
+}
+
+int write_buffer_next(const uint8_t *p_data, size_t len, size_t *p_pos,
+                      const uint8_t **pp_rec, size_t *p_rec_len)
+{
+    uint16_t frame;
+
+    if (*p_pos + WRITE_BUFFER_FRAME > len)
+        return -ENODATA;
+
+    memcpy(&frame, &p_data[*p_pos], WRITE_BUFFER_FRAME);
+
+    if (*p_pos + WRITE_BUFFER_FRAME + frame > len)
+        return -ENODATA;
+
+    *pp_rec = &p_data[*p_pos + WRITE_BUFFER_FRAME];
+    *p_rec_len = frame;
+    *p_pos += WRITE_BUFFER_FRAME + frame;
+
+    return 0;
+}
+
+void write_buffer_stats_get(struct write_buffer *p_wb, struct write_buffer_stats *p_stats)
+{
+    k_mutex_lock(&p_wb->lock, K_FOREVER);
+
+    *p_stats = p_wb->stats;
+
+    k_mutex_unlock(&p_wb->lock);
+}
@@ -9,6 +9,41 @@
 
 #include <zephyr/kernel.h>
 
+/**
+ * @brief How a topic's records reach the backend. Each is sent once.
+ * 
+ */
+enum app_backend_route
+{
+    /* Latest state only (app_backend_publish) */
+    APP_BACKEND_ROUTE_LATEST,
+
+    /* Time series only (app_backend_stream) */
+    APP_BACKEND_ROUTE_SERIES,
+
+    /* One transmit the server keeps as both (app_backend_merged) */
+    APP_BACKEND_ROUTE_MERGED,
+
+    APP_BACKEND_ROUTES,
+};
+
+/**
+ * @brief Uplink classes. When the connected window is short the more
+ * important ones go first.
+ * 
+ */
+enum app_backend_prio
+{
+    /* Alarms (motion). Sent right away along with everything queued. */
+    APP_BACKEND_PRIO_ALARM,
+
+    /* Device state (position) */
+    APP_BACKEND_PRIO_STATE,
+
+    /* Diagnostics. Only sent if connected anyway, never queued. */
+    APP_BACKEND_PRIO_DIAG,
+};
+
 /**
  * @brief Initialize the backend
  * 
@@ -38,6 +73,71 @@ int app_backend_publish(char *topic, uint8_t *p_data, size_t len);
  */
 int app_backend_stream(char *topic, uint8_t *p_data, size_t len);
 
+/**
+ * @brief Adds to the backend stream. Where the backend packs records into one
+ * transmit they're held until app_backend_stream_flush().
+ * 
+ * @param topic topic string used
+ * @param p_data pointer to data structure
+ * @param len length of data
+ * @return int 0 on success
+ */
+int app_backend_stream_add(char *topic, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Sends what app_backend_stream_add() held. Held records are dropped
+ * either way, the caller keeps its copy until this succeeds.
+ * 
+ * @return int 0 if everything added since the last flush went out
+ */
+int app_backend_stream_flush(void);
+
+/**
+ * @brief Publish once where the server keeps it as both latest state and
+ * time series
+ * 
+ * @param topic topic string used
+ * @param p_data pointer to data structure
+ * @param len length of data
+ * @return int 0 on success
+ */
+int app_backend_merged(char *topic, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Sends according to the topic's route
+ * 
+ * @param topic topic string used
+ * @param p_data pointer to data structure
+ * @param len length of data
+ * @return int 0 on success
+ */
+int app_backend_send(char *topic, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Changes a topic's route until the next boot
+ * 
+ * @param topic a routed topic ("gps" or "motion")
+ * @param route the new route
+ * @return int 0 on success. -ENOENT if the topic isn't routed.
+ */
+int app_backend_route_set(const char *topic, enum app_backend_route route);
+
+/**
+ * @brief Gets a topic's route
+ * 
+ * @param topic topic string
+ * @return enum app_backend_route the route. Topics without one are merged.
+ */
+enum app_backend_route app_backend_route_get(const char *topic);
+
+/**
+ * @brief Name of a route
+ * 
+ * @param route the route
+ * @return const char* "latest", "series" or "merged"
+ */
+const char *app_backend_route_name(enum app_backend_route route);
+
 /**
  * @brief Connect to the backend
  * 
@@ -60,4 +160,265 @@ int app_backend_disconnect(void);
  */
 bool app_backend_is_connected(void);
 
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+/**
+ * @brief A received payload. Borrowed from the backend's receive buffer:
+ * only valid during the handler call. Copy what's needed.
+ * 
+ */
+struct app_backend_downlink
+{
+    /* Not terminated */
+    const char *topic;
+    size_t topic_len;
+
+    const uint8_t *p_data;
+    size_t len;
+};
+
+/**
+ * @brief Handles a received payload. Called on the backend's receive thread,
+ * so keep it short.
+ * 
+ * @param p_downlink the payload
+ * @param p_user user pointer from app_backend_downlink_register()
+ */
+typedef void (*app_backend_downlink_cb_t)(const struct app_backend_downlink *p_downlink,
+                                          void *p_user);
+
+/**
+ * @brief Delivers a topic's downlinks to a handler. Subscribes (Pyrinas) or
+ * observes (Golioth LightDB path) the topic, now or on connect.
+ * 
+ * @param topic topic or LightDB path. Must stay valid.
+ * @param cb the handler
+ * @param p_user passed to the handler
+ * @return int 0 on success. -ENOMEM if CONFIG_APP_BACKEND_DOWNLINK_HANDLERS
+ * are registered already.
+ */
+int app_backend_downlink_register(const char *topic, app_backend_downlink_cb_t cb, void *p_user);
+
+/**
+ * @brief Hands a received payload to the topic's handler. Called by the
+ * backends.
+ * 
+ * @param topic the topic (not terminated)
+ * @param topic_len length of the topic
+ * @param p_data the payload, in the backend's receive buffer
+ * @param len length of the payload
+ * @return int 0 on success. -ENOENT if there's no handler.
+ */
+int app_backend_downlink_dispatch(const char *topic, size_t topic_len, const uint8_t *p_data,
+                                  size_t len);
+
+/**
+ * @brief Subscribes to every registered topic. Called by backends whose
+ * subscriptions end with the session.
+ * 
+ * @return int 0 on success. The last error otherwise.
+ */
+int app_backend_downlink_subscribe_all(void);
+
+/**
+ * @brief Subscribes to a topic. Implemented by each backend.
+ * 
+ * @param topic topic or LightDB path. Stays valid.
+ * @return int 0 on success
+ */
+int app_backend_subscribe(const char *topic);
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+#include <lib/stats/histogram.h>
+
+/**
+ * @brief Traffic of one topic since boot
+ * 
+ */
+struct app_backend_metrics
+{
+    char topic[16];
+    uint32_t messages;
+    uint32_t failures;
+
+    /* Payload and estimated protocol bytes (IP, transport, security, framing) */
+    uint32_t bytes;
+    uint32_t overhead;
+
+    /* Publish to ack (ms). Only backends with acks fill it. */
+    struct histogram latency;
+};
+
+/**
+ * @brief Counts a transmit. Called by the backends.
+ * 
+ * @param topic topic string used
+ * @param len payload length
+ */
+void app_backend_metrics_sent(const char *topic, size_t len);
+
+/**
+ * @brief Counts a failed transmit. Called by the backends.
+ * 
+ * @param topic topic string used
+ */
+void app_backend_metrics_failed(const char *topic);
+
+/**
+ * @brief Records an ack. Called by the backends.
+ * 
+ * @param topic topic string used
+ * @param ms time from the publish
+ */
+void app_backend_metrics_acked(const char *topic, uint32_t ms);
+
+/**
+ * @brief Number of topics seen
+ * 
+ * @return int topic count
+ */
+int app_backend_metrics_count(void);
+
+/**
+ * @brief Gets a topic's metrics
+ * 
+ * @param idx 0 to app_backend_metrics_count() - 1
+ * @param p_metrics destination
+ * @return int 0 on success. -ENOENT if there's no such topic.
+ */
+int app_backend_metrics_get(int idx, struct app_backend_metrics *p_metrics);
+
+/**
+ * @brief Whether CONFIG_APP_BACKEND_METRICS_UPLINK_INTERVAL has passed since
+ * the last metrics record. Clears the condition when it returns true.
+ * 
+ * @return true if a record should be sent
+ */
+bool app_backend_metrics_uplink_due(void);
+#endif
+
+#ifdef CONFIG_APP_BACKEND_SESSION
+/**
+ * @brief Session counters
+ * 
+ */
+struct app_backend_session_stats
+{
+    /* Sessions and the time spent in them (ms) */
+    uint32_t sessions;
+    int64_t connected_ms;
+
+    /* Sessions closed for being idle */
+    uint32_t idle_teardowns;
+
+    /* Request to connected (ms). Measured for sessions opened on request. */
+    uint32_t connects_measured;
+    int64_t connect_ms_total;
+    uint32_t connect_ms_max;
+};
+
+/**
+ * @brief Connects if not connected. Call when there's something to send.
+ * 
+ * @return int 0 on success
+ */
+int app_backend_session_request(void);
+
+/**
+ * @brief Restarts the idle timer. Call after every transmit.
+ * 
+ */
+void app_backend_session_touch(void);
+
+/**
+ * @brief Tracks the connection state (from the event manager)
+ * 
+ * @param connected true if the backend connected
+ */
+void app_backend_session_update(bool connected);
+
+/**
+ * @brief Gets the session counters
+ * 
+ * @param p_stats destination
+ */
+void app_backend_session_stats_get(struct app_backend_session_stats *p_stats);
+#endif
+
+#ifdef CONFIG_APP_BACKEND_BATCH
+#include <lib/uplink_batch/uplink_batch.h>
+
+/**
+ * @brief Batching statistics
+ * 
+ */
+struct app_backend_batch_stats
+{
+    struct uplink_batch_stats batch;
+
+    /* Records per uplink x100 */
+    uint32_t records_per_uplink_x100;
+
+    /* Estimated RRC connected time saved (in seconds) */
+    uint32_t radio_seconds_saved;
+};
+
+/**
+ * @brief Queues a record for its topic. The batch is sent once, following
+ * the topic's route: only the newest record for latest state topics, all of
+ * them as one CBOR array otherwise (see app_backend_send()).
+ * 
+ * @param topic topic string used
+ * @param p_data one encoded CBOR item
+ * @param len length of data
+ * @param prio the record's class. Alarms send everything that's queued now.
+ * @param deadline_s seconds until the record isn't worth sending live. If
+ * it's still queued by then it moves to the store and forward queue, or is
+ * dropped without one. 0 if never.
+ * @return int 0 when queued. An error means the record wasn't taken.
+ */
+int app_backend_batch_put(char *topic, uint8_t *p_data, size_t len, enum app_backend_prio prio,
+                          uint32_t deadline_s);
+
+/**
+ * @brief Sends everything that's queued, most important class first
+ * 
+ * @return int 0 on success
+ */
+int app_backend_batch_flush(void);
+
+/**
+ * @brief Sends anything that's overdue and re-arms the age timer. Call on
+ * (re)connect.
+ * 
+ * @return int 0 on success
+ */
+int app_backend_batch_poll(void);
+
+/**
+ * @brief Whether any records are queued
+ * 
+ * @return true if a flush has something to send
+ */
+bool app_backend_batch_pending(void);
+
+/**
+ * @brief Gets the batching statistics
+ * 
+ * @param p_stats destination
+ */
+void app_backend_batch_stats_get(struct app_backend_batch_stats *p_stats);
+#endif
+
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+#include <lib/inflight/inflight.h>
+
+/**
+ * @brief Gets the counters of requests waiting for their result
+ * 
+ * @param p_stats destination
+ */
+void app_backend_inflight_stats_get(struct inflight_stats *p_stats);
+#endif
+
 #endif
\ No newline at end of file
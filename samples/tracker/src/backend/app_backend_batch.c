@@ -0,0 +1,202 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <app_backend.h>
+#include <app_radio.h>
+
+#ifdef CONFIG_APP_COUNTERS
+#include <app_counters.h>
+#endif
+
+#ifdef CONFIG_APP_FIFO
+#include <app_fifo.h>
+#include <app_storage.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_batch);
+
+/* Alarms are what flushes everything */
+BUILD_ASSERT(APP_BACKEND_PRIO_ALARM == UPLINK_BATCH_PRIO_URGENT, "Alarms must be urgent");
+
+#ifdef CONFIG_APP_FIFO
+/* Expired records are queued as one array */
+BUILD_ASSERT(CONFIG_APP_BACKEND_BATCH_SIZE / CONFIG_UPLINK_BATCH_TOPICS <= CONFIG_APP_FIFO_RECORD_SIZE,
+             "Raise CONFIG_APP_FIFO_RECORD_SIZE to fit a batch");
+#endif
+
+static uint8_t batch_mem[CONFIG_APP_BACKEND_BATCH_SIZE];
+static struct uplink_batch batch;
+
+static void app_backend_batch_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(batch_work, app_backend_batch_work_fn);
+
+static int app_backend_batch_send(const char *p_topic, const uint8_t *p_packed, size_t len,
+                                  const uint8_t *p_latest, size_t latest_len, uint16_t records,
+                                  void *p_user)
+{
+    int err;
+
+    /* Kept until we're back */
+    if (!app_backend_is_connected())
+    {
+#ifdef CONFIG_APP_BACKEND_SESSION
+        app_backend_session_request();
+#endif
+        return -ENOTCONN;
+    }
+
+    /* Before the transmit opens the window itself */
+    app_radio_tx_count();
+
+#ifdef CONFIG_APP_BACKEND_SESSION
+    /* Still in use */
+    app_backend_session_touch();
+#endif
+
+    /* One transmit. Latest state only needs the newest record. */
+    if (app_backend_route_get(p_topic) == APP_BACKEND_ROUTE_LATEST)
+        err = app_backend_publish((char *)p_topic, (uint8_t *)p_latest, latest_len);
+    else
+        err = app_backend_send((char *)p_topic, (uint8_t *)p_packed, len);
+
+    if (err)
+    {
+        LOG_ERR("Unable to send. Err: %i", err);
+
+#ifdef CONFIG_APP_COUNTERS
+        app_counters_inc(APP_COUNTER_PUBLISH_ERRORS);
+#endif
+        return err;
+    }
+
+#ifdef CONFIG_APP_COUNTERS
+    app_counters_inc(APP_COUNTER_UPLINKS);
+#endif
+
+    LOG_INF("Sent %u %s records in %u bytes", records, p_topic, len);
+
+    return 0;
+}
+
+static void app_backend_batch_expired(const char *p_topic, uint8_t prio, const uint8_t *p_packed,
+                                      size_t len, const uint8_t *p_latest, size_t latest_len,
+                                      uint16_t records, void *p_user)
+{
+#ifdef CONFIG_APP_FIFO
+    /* Goes out as history after the live records, as the same array a batch
+     * streams. Work queue thread. Don't wait for the mount. */
+    if (app_storage_wait_ready(K_NO_WAIT) == 0 &&
+        app_fifo_put((char *)p_topic, (uint8_t *)p_packed, len) == 0)
+    {
+        LOG_INF("Moved %u expired %s records to the queue", records, p_topic);
+        return;
+    }
+#endif
+
+    LOG_WRN("Dropped %u expired %s records", records, p_topic);
+
+#ifdef CONFIG_APP_COUNTERS
+    app_counters_inc(APP_COUNTER_DROPPED);
+#endif
+}
+
+static void app_backend_batch_arm_at(int64_t deadline)
+{
+    if (deadline == INT64_MAX)
+        return;
+
+    k_work_reschedule(&batch_work, K_MSEC(MAX(deadline - k_uptime_get(), 0)));
+}
+
+/* Wake up when the oldest record is due */
+static void app_backend_batch_arm(void)
+{
+    app_backend_batch_arm_at(uplink_batch_deadline(&batch));
+}
+
+static void app_backend_batch_work_fn(struct k_work *work)
+{
+    /* Offline. Picked up by app_backend_batch_poll() on connect. Until then
+     * only expiring records need the timer. */
+    if (uplink_batch_poll(&batch, k_uptime_get()))
+    {
+        app_backend_batch_arm_at(uplink_batch_expiry(&batch));
+        return;
+    }
+
+    app_backend_batch_arm();
+}
+
+int app_backend_batch_put(char *topic, uint8_t *p_data, size_t len, enum app_backend_prio prio,
+                          uint32_t deadline_s)
+{
+    int64_t now = k_uptime_get();
+    int64_t deadline = deadline_s ? now + (int64_t)deadline_s * MSEC_PER_SEC
+                                  : UPLINK_BATCH_NO_DEADLINE;
+
+    int err = uplink_batch_put(&batch, topic, p_data, len, prio, deadline, now);
+    if (err)
+        return err;
+
+    app_backend_batch_arm();
+
+    return 0;
+}
+
+int app_backend_batch_flush(void)
+{
+    return uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL);
+}
+
+int app_backend_batch_poll(void)
+{
+    int err = uplink_batch_poll(&batch, k_uptime_get());
+
+    app_backend_batch_arm();
+
+    return err;
+}
+
+bool app_backend_batch_pending(void)
+{
+    return uplink_batch_deadline(&batch) != INT64_MAX;
+}
+
+void app_backend_batch_stats_get(struct app_backend_batch_stats *p_stats)
+{
+    struct app_radio_stats radio;
+
+    uplink_batch_stats_get(&batch, &p_stats->batch);
+    app_radio_stats_get(&radio);
+
+    uint32_t sent = p_stats->batch.records;
+    uint32_t uplinks = p_stats->batch.uplinks;
+
+    p_stats->records_per_uplink_x100 = uplinks ? (uint64_t)sent * 100 / uplinks : 0;
+
+    /* Each record sent on its own would have cost an RRC connection of the
+     * average length seen so far */
+    p_stats->radio_seconds_saved = 0;
+
+    if (radio.rrc_connections && sent > uplinks)
+        p_stats->radio_seconds_saved = (uint64_t)(sent - uplinks) * radio.rrc_connected_ms /
+                                       radio.rrc_connections / MSEC_PER_SEC;
+}
+
+static int app_backend_batch_init(void)
+{
+    uplink_batch_init(&batch, batch_mem, sizeof(batch_mem),
+                      CONFIG_APP_BACKEND_BATCH_MAX_AGE * MSEC_PER_SEC,
+                      app_backend_batch_send, app_backend_batch_expired, NULL);
+
+    return 0;
+}
+
+SYS_INIT(app_backend_batch_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include <app_backend.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_downlink);
+
+static struct
+{
+    const char *topic;
+    app_backend_downlink_cb_t cb;
+    void *p_user;
+} handlers[CONFIG_APP_BACKEND_DOWNLINK_HANDLERS];
+
+/* Entries are filled in before they're counted. Dispatch doesn't lock. */
+static atomic_t handler_count;
+
+static K_MUTEX_DEFINE(lock);
+
+int app_backend_downlink_register(const char *topic, app_backend_downlink_cb_t cb, void *p_user)
+{
+    k_mutex_lock(&lock, K_FOREVER);
+
+    int idx = atomic_get(&handler_count);
+    if (idx >= CONFIG_APP_BACKEND_DOWNLINK_HANDLERS)
+    {
+        k_mutex_unlock(&lock);
+        return -ENOMEM;
+    }
+
+    handlers[idx].topic = topic;
+    handlers[idx].cb = cb;
+    handlers[idx].p_user = p_user;
+    atomic_inc(&handler_count);
+
+    k_mutex_unlock(&lock);
+
+    /* Not connected yet is fine. Subscribed on connect. */
+    int err = app_backend_subscribe(topic);
+    if (err)
+        LOG_WRN("Unable to subscribe to %s. Err: %i", topic, err);
+
+    return 0;
+}
+
+int app_backend_downlink_dispatch(const char *topic, size_t topic_len, const uint8_t *p_data,
+                                  size_t len)
+{
+    struct app_backend_downlink downlink = {
+        .topic = topic,
+        .topic_len = topic_len,
+        .p_data = p_data,
+        .len = len,
+    };
+
+    for (int i = 0; i < atomic_get(&handler_count); i++)
+    {
+        if (strlen(handlers[i].topic) != topic_len ||
+            memcmp(handlers[i].topic, topic, topic_len) != 0)
+            continue;
+
+#ifdef CONFIG_APP_BACKEND_SESSION
+        /* The server is talking to us. Keep the session. */
+        app_backend_session_touch();
+#endif
+
+        /* Straight from the receive buffer */
+        handlers[i].cb(&downlink, handlers[i].p_user);
+
+        return 0;
+    }
+
+    LOG_WRN("No handler for %.*s", (int)topic_len, topic);
+
+    return -ENOENT;
+}
+
+int app_backend_downlink_subscribe_all(void)
+{
+    int ret = 0;
+
+    for (int i = 0; i < atomic_get(&handler_count); i++)
+    {
+        int err = app_backend_subscribe(handlers[i].topic);
+        if (err)
+        {
+            LOG_WRN("Unable to subscribe to %s. Err: %i", handlers[i].topic, err);
+            ret = err;
+        }
+    }
+
+    return ret;
+}
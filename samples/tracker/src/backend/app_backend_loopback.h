@@ -0,0 +1,119 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_BACKEND_LOOPBACK_H
+#define _APP_BACKEND_LOOPBACK_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Which backend call a record came from
+ *
+ */
+enum app_backend_loopback_kind
+{
+    APP_BACKEND_LOOPBACK_PUBLISH,
+    APP_BACKEND_LOOPBACK_STREAM,
+    APP_BACKEND_LOOPBACK_MERGED,
+    APP_BACKEND_LOOPBACK_KINDS,
+};
+
+/**
+ * @brief Faults injected into the data path
+ *
+ */
+struct app_backend_loopback_config
+{
+    /* Time each transmit blocks the caller (ms) */
+    uint32_t latency_ms;
+
+    /* Every Nth transmit fails with -EIO. 0 never. */
+    uint32_t fail_every;
+
+    /* Drop the connection after every Nth transmit. 0 never. */
+    uint32_t disconnect_every;
+
+    /* Time until the connection comes back (ms) */
+    uint32_t reconnect_ms;
+};
+
+/**
+ * @brief Totals since the last reset
+ *
+ */
+struct app_backend_loopback_stats
+{
+    uint32_t messages[APP_BACKEND_LOOPBACK_KINDS];
+    uint32_t bytes[APP_BACKEND_LOOPBACK_KINDS];
+    uint32_t failures;
+    uint32_t rejected;
+    uint32_t disconnects;
+};
+
+/**
+ * @brief One transmit as it was received
+ *
+ */
+struct app_backend_loopback_record
+{
+    int64_t ts;
+    enum app_backend_loopback_kind kind;
+    char topic[16];
+    uint16_t len;
+    uint8_t data[CONFIG_APP_BACKEND_LOOPBACK_RECORD_SIZE];
+};
+
+/**
+ * @brief Replaces the injected faults
+ *
+ * @param p_config the new config
+ */
+void app_backend_loopback_config_set(const struct app_backend_loopback_config *p_config);
+
+/**
+ * @brief Gets the totals
+ *
+ * @param p_stats destination
+ */
+void app_backend_loopback_stats_get(struct app_backend_loopback_stats *p_stats);
+
+/**
+ * @brief Number of records held (the newest CONFIG_APP_BACKEND_LOOPBACK_RECORDS)
+ *
+ * @return int record count
+ */
+int app_backend_loopback_count(void);
+
+/**
+ * @brief Gets a held record
+ *
+ * @param idx 0 is the oldest held
+ * @param p_rec destination. Data beyond CONFIG_APP_BACKEND_LOOPBACK_RECORD_SIZE is cut.
+ * @return int 0 on success. -ENOENT if there's no such record.
+ */
+int app_backend_loopback_record_get(int idx, struct app_backend_loopback_record *p_rec);
+
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+/**
+ * @brief Delivers a payload as if the server had sent it. The handler sees
+ * p_data itself.
+ *
+ * @param topic the topic
+ * @param p_data the payload
+ * @param len length of the payload
+ * @return int 0 on success. -ENOTCONN if disconnected. -ENOENT if there's
+ * no handler.
+ */
+int app_backend_loopback_downlink(const char *topic, const uint8_t *p_data, size_t len);
+#endif
+
+/**
+ * @brief Clears the records and totals
+ *
+ */
+void app_backend_loopback_reset(void);
+
+#endif
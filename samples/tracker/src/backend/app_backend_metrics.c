@@ -0,0 +1,120 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include <app_backend.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_metrics);
+
+/* Publish to ack (ms) */
+static const int32_t latency_bounds[] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 60000, 300000,
+};
+
+static struct k_spinlock lock;
+
+/* The last one counts every topic that didn't get its own */
+static struct app_backend_metrics metrics[CONFIG_APP_BACKEND_METRICS_TOPICS];
+static int metrics_count;
+
+static int64_t last_uplink;
+
+static struct app_backend_metrics *app_backend_metrics_find(const char *topic)
+{
+    for (int i = 0; i < metrics_count; i++)
+    {
+        if (strncmp(metrics[i].topic, topic, sizeof(metrics[i].topic)) == 0)
+            return &metrics[i];
+    }
+
+    struct app_backend_metrics *p_metrics = &metrics[metrics_count];
+
+    /* Out of topics and "other" is already in use */
+    if (p_metrics->topic[0] != '\0')
+        return p_metrics;
+
+    if (metrics_count == (int)ARRAY_SIZE(metrics) - 1)
+    {
+        strcpy(p_metrics->topic, "other");
+    }
+    else
+    {
+        strncpy(p_metrics->topic, topic, sizeof(p_metrics->topic) - 1);
+        p_metrics->topic[sizeof(p_metrics->topic) - 1] = '\0';
+        metrics_count++;
+    }
+
+    p_metrics->latency.p_bounds = latency_bounds;
+    p_metrics->latency.bounds_count = ARRAY_SIZE(latency_bounds);
+
+    return p_metrics;
+}
+
+void app_backend_metrics_sent(const char *topic, size_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    struct app_backend_metrics *p_metrics = app_backend_metrics_find(topic);
+
+    p_metrics->messages++;
+    p_metrics->bytes += len;
+
+    /* Headers plus the topic, which goes in every message */
+    p_metrics->overhead += CONFIG_APP_BACKEND_METRICS_OVERHEAD + strlen(topic);
+
+    k_spin_unlock(&lock, key);
+}
+
+void app_backend_metrics_failed(const char *topic)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    app_backend_metrics_find(topic)->failures++;
+    k_spin_unlock(&lock, key);
+}
+
+void app_backend_metrics_acked(const char *topic, uint32_t ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    histogram_add(&app_backend_metrics_find(topic)->latency, MIN(ms, INT32_MAX));
+    k_spin_unlock(&lock, key);
+}
+
+int app_backend_metrics_count(void)
+{
+    /* Including "other" once it's in use */
+    return metrics_count + (metrics[metrics_count].topic[0] != '\0');
+}
+
+int app_backend_metrics_get(int idx, struct app_backend_metrics *p_metrics)
+{
+    if (idx < 0 || idx >= app_backend_metrics_count())
+        return -ENOENT;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *p_metrics = metrics[idx];
+    k_spin_unlock(&lock, key);
+
+    return 0;
+}
+
+bool app_backend_metrics_uplink_due(void)
+{
+    int64_t now = k_uptime_get();
+
+    if (CONFIG_APP_BACKEND_METRICS_UPLINK_INTERVAL == 0)
+        return false;
+
+    if (now - last_uplink < (int64_t)CONFIG_APP_BACKEND_METRICS_UPLINK_INTERVAL * 3600 * MSEC_PER_SEC)
+        return false;
+
+    last_uplink = now;
+
+    return true;
+}
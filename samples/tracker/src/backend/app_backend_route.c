@@ -0,0 +1,77 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include <app_backend.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_route);
+
+static const char *const route_names[APP_BACKEND_ROUTES] = {
+    [APP_BACKEND_ROUTE_LATEST] = "latest",
+    [APP_BACKEND_ROUTE_SERIES] = "series",
+    [APP_BACKEND_ROUTE_MERGED] = "merged",
+};
+
+/* Build time defaults. Changed at runtime with app_backend_route_set(). */
+static struct
+{
+    const char *topic;
+    atomic_t route;
+} routes[] = {
+    {.topic = "gps", .route = ATOMIC_INIT(CONFIG_APP_BACKEND_ROUTE_GPS)},
+    {.topic = "motion", .route = ATOMIC_INIT(CONFIG_APP_BACKEND_ROUTE_MOTION)},
+};
+
+int app_backend_route_set(const char *topic, enum app_backend_route route)
+{
+    if (route >= APP_BACKEND_ROUTES)
+        return -EINVAL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(routes); i++)
+    {
+        if (strcmp(routes[i].topic, topic) == 0)
+        {
+            atomic_set(&routes[i].route, route);
+            return 0;
+        }
+    }
+
+    return -ENOENT;
+}
+
+enum app_backend_route app_backend_route_get(const char *topic)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(routes); i++)
+    {
+        if (strcmp(routes[i].topic, topic) == 0)
+            return atomic_get(&routes[i].route);
+    }
+
+    return APP_BACKEND_ROUTE_MERGED;
+}
+
+const char *app_backend_route_name(enum app_backend_route route)
+{
+    return route < APP_BACKEND_ROUTES ? route_names[route] : "unknown";
+}
+
+int app_backend_send(char *topic, uint8_t *p_data, size_t len)
+{
+    switch (app_backend_route_get(topic))
+    {
+    case APP_BACKEND_ROUTE_LATEST:
+        return app_backend_publish(topic, p_data, len);
+    case APP_BACKEND_ROUTE_SERIES:
+        return app_backend_stream(topic, p_data, len);
+    case APP_BACKEND_ROUTE_MERGED:
+    default:
+        return app_backend_merged(topic, p_data, len);
+    }
+}
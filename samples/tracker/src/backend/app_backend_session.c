@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include <app_backend.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_session);
+
+static struct k_spinlock lock;
+
+static bool connected = false;
+static bool connecting = false;
+static int64_t connected_since = 0;
+static int64_t requested_at = 0;
+
+static struct app_backend_session_stats stats;
+
+static void app_backend_session_idle_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(idle_work, app_backend_session_idle_fn);
+
+static void app_backend_session_idle_fn(struct k_work *work)
+{
+    int err = app_backend_disconnect();
+
+    /* Requests are still waiting for their result */
+    if (err == -EBUSY)
+    {
+        app_backend_session_touch();
+        return;
+    }
+
+    if (err)
+    {
+        LOG_WRN("Unable to disconnect. Err: %i", err);
+        return;
+    }
+
+    LOG_INF("Idle. Disconnected.");
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    stats.idle_teardowns++;
+    k_spin_unlock(&lock, key);
+}
+
+int app_backend_session_request(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    bool start = !connected && !connecting;
+
+    if (start)
+    {
+        connecting = true;
+        requested_at = k_uptime_get();
+    }
+
+    k_spin_unlock(&lock, key);
+
+    if (!start)
+        return 0;
+
+    LOG_INF("Connecting on demand");
+
+    int err = app_backend_connect();
+    if (err)
+    {
+        /* Next request tries again */
+        key = k_spin_lock(&lock);
+        connecting = false;
+        k_spin_unlock(&lock, key);
+    }
+
+    return err;
+}
+
+void app_backend_session_touch(void)
+{
+    k_work_reschedule(&idle_work, K_SECONDS(CONFIG_APP_BACKEND_SESSION_IDLE));
+}
+
+void app_backend_session_update(bool is_connected)
+{
+    int64_t now = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (is_connected && !connected)
+    {
+        stats.sessions++;
+        connected_since = now;
+
+        /* What a (re)connect costs */
+        if (connecting)
+        {
+            uint32_t ms = now - requested_at;
+
+            stats.connects_measured++;
+            stats.connect_ms_total += ms;
+            stats.connect_ms_max = MAX(stats.connect_ms_max, ms);
+        }
+    }
+    else if (!is_connected && connected)
+    {
+        stats.connected_ms += now - connected_since;
+    }
+
+    connected = is_connected;
+    connecting = false;
+
+    k_spin_unlock(&lock, key);
+
+    /* Closed after CONFIG_APP_BACKEND_SESSION_IDLE without a transmit */
+    if (is_connected)
+        app_backend_session_touch();
+    else
+        k_work_cancel_delayable(&idle_work);
+}
+
+void app_backend_session_stats_get(struct app_backend_session_stats *p_stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *p_stats = stats;
+
+    /* Include the current session */
+    if (connected)
+        p_stats->connected_ms += k_uptime_get() - connected_since;
+
+    k_spin_unlock(&lock, key);
+}
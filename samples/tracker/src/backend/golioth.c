@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/kernel.h>
 
 #include <net/golioth/system_client.h>
@@ -12,6 +13,15 @@
 #include <app_event_manager.h>
 #include <app_backend.h>
 
+#ifdef CONFIG_APP_FIFO
+#include <app_fifo.h>
+#include <app_storage.h>
+#endif
+
+#ifdef CONFIG_APP_COUNTERS
+#include <app_counters.h>
+#endif
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(backend_golioth);
 
@@ -19,10 +29,21 @@ static struct golioth_client *client = GOLIOTH_SYSTEM_CLIENT_GET();
 
 static bool is_connected = false;
 
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+static uint8_t inflight_mem[CONFIG_INFLIGHT_WINDOW * CONFIG_APP_BACKEND_INFLIGHT_SIZE];
+static struct inflight inflight;
+#endif
+
 void golioth_on_connect(struct golioth_client *client)
 {
     is_connected = true;
 
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+    /* Observations end with the session. The current values come right
+     * back, so config changes apply in this window. */
+    app_backend_downlink_subscribe_all();
+#endif
+
     APP_EVENT_MANAGER_PUSH(APP_EVENT_BACKEND_CONNECTED);
 }
 
@@ -36,8 +57,21 @@ int app_backend_connect()
 
 int app_backend_disconnect()
 {
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+    /* Wait for the results first */
+    if (inflight_count(&inflight))
+        return -EBUSY;
+#endif
+
     golioth_system_client_stop();
 
+    if (is_connected)
+    {
+        is_connected = false;
+
+        APP_EVENT_MANAGER_PUSH(APP_EVENT_BACKEND_DISCONNECTED);
+    }
+
     return 0;
 }
 
@@ -46,6 +80,197 @@ bool app_backend_is_connected()
     return is_connected;
 }
 
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+/* What a request does once it's sent */
+enum golioth_kind
+{
+    GOLIOTH_KIND_PUBLISH,
+    GOLIOTH_KIND_STREAM,
+};
+
+static void inflight_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(inflight_work, inflight_work_fn);
+
+/* Wake up for the next timeout or retry */
+static void inflight_arm(void)
+{
+    int64_t deadline = inflight_deadline(&inflight);
+
+    if (deadline == INT64_MAX)
+        return;
+
+    k_work_reschedule(&inflight_work, K_MSEC(MAX(deadline - k_uptime_get(), 0)));
+}
+
+static void inflight_work_fn(struct k_work *work)
+{
+    inflight_poll(&inflight, k_uptime_get());
+    inflight_arm();
+}
+
+static int async_handler(struct golioth_req_rsp *rsp)
+{
+    uint32_t id = (uint32_t)(uintptr_t)rsp->user_data;
+
+    if (rsp->err)
+        LOG_WRN("Golioth async operation failed: %d", rsp->err);
+    else
+        LOG_DBG("Golioth async operation successful");
+
+    inflight_complete(&inflight, id, rsp->err, k_uptime_get());
+    inflight_arm();
+
+#ifdef CONFIG_APP_BACKEND_SESSION
+    /* Still in use */
+    app_backend_session_touch();
+#endif
+
+    return rsp->err;
+}
+
+static int inflight_send(uint32_t id, const char *p_topic, uint8_t kind, const uint8_t *p_data,
+                         size_t len, void *p_user)
+{
+    void *p_id = (void *)(uintptr_t)id;
+
+    if (!is_connected)
+    {
+#ifdef CONFIG_APP_BACKEND_SESSION
+        /* Retried once we're back */
+        app_backend_session_request();
+#endif
+        return -ENOTCONN;
+    }
+
+    int err;
+
+    if (kind == GOLIOTH_KIND_PUBLISH)
+        err = golioth_lightdb_set_cb(client, p_topic, GOLIOTH_CONTENT_FORMAT_APP_CBOR,
+                                     (uint8_t *)p_data, len, async_handler, p_id);
+    else
+        err = golioth_stream_push_cb(client, p_topic, GOLIOTH_CONTENT_FORMAT_APP_CBOR,
+                                     (uint8_t *)p_data, len, async_handler, p_id);
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+    /* Every attempt is paid for */
+    if (err)
+        app_backend_metrics_failed(p_topic);
+    else
+        app_backend_metrics_sent(p_topic, len);
+#endif
+
+    return err;
+}
+
+static void inflight_result(const char *p_topic, uint8_t kind, int err, uint32_t ms, void *p_user)
+{
+#ifdef CONFIG_APP_BACKEND_METRICS
+    if (err)
+        app_backend_metrics_failed(p_topic);
+    else
+        app_backend_metrics_acked(p_topic, ms);
+#endif
+}
+
+static void inflight_dropped(const char *p_topic, int err)
+{
+    LOG_ERR("Dropped a %s request. Err: %i", p_topic, err);
+
+#ifdef CONFIG_APP_COUNTERS
+    app_counters_inc(APP_COUNTER_DROPPED);
+#endif
+}
+
+#ifdef CONFIG_APP_FIFO
+/* A request that ran out of attempts, on its way to the queue */
+struct inflight_requeue
+{
+    char topic[CONFIG_INFLIGHT_TOPIC_LEN];
+    uint16_t len;
+    uint8_t data[CONFIG_APP_BACKEND_INFLIGHT_SIZE];
+};
+
+BUILD_ASSERT(CONFIG_APP_BACKEND_INFLIGHT_SIZE <= CONFIG_APP_FIFO_RECORD_SIZE,
+             "Raise CONFIG_APP_FIFO_RECORD_SIZE to fit a request");
+
+K_MSGQ_DEFINE(requeue_msgq, sizeof(struct inflight_requeue), CONFIG_INFLIGHT_WINDOW, 4);
+
+static void inflight_requeue_work_fn(struct k_work *work);
+static K_WORK_DEFINE(requeue_work, inflight_requeue_work_fn);
+
+/* Flash writes happen here, not under the table's lock on the Golioth thread */
+static void inflight_requeue_work_fn(struct k_work *work)
+{
+    static struct inflight_requeue item;
+
+    while (k_msgq_get(&requeue_msgq, &item, K_NO_WAIT) == 0)
+    {
+        /* Work queue thread. Don't wait for the mount. */
+        int err = app_storage_wait_ready(K_NO_WAIT);
+        if (err == 0)
+            err = app_fifo_put(item.topic, item.data, item.len);
+
+        if (err)
+            inflight_dropped(item.topic, err);
+    }
+}
+#endif
+
+/* Out of retries. Keep it until the store and forward queue drains. */
+static void inflight_fail(const char *p_topic, uint8_t kind, const uint8_t *p_data, size_t len,
+                          int err, void *p_user)
+{
+    LOG_ERR("Giving up on %s. Err: %i", p_topic, err);
+
+#ifdef CONFIG_APP_FIFO
+    /* Only ever called with the table locked */
+    static struct inflight_requeue item;
+
+    strcpy(item.topic, p_topic);
+    item.len = len;
+    memcpy(item.data, p_data, len);
+
+    err = k_msgq_put(&requeue_msgq, &item, K_NO_WAIT);
+    if (err == 0)
+    {
+        k_work_submit(&requeue_work);
+        return;
+    }
+#endif
+
+    inflight_dropped(p_topic, err);
+}
+
+static int golioth_submit(enum golioth_kind kind, char *p_topic, uint8_t *p_data, size_t len)
+{
+    int err = inflight_submit(&inflight, p_topic, kind, p_data, len, k_uptime_get());
+
+    if (err)
+    {
+        LOG_WRN("Unable to queue %s. Err: %i", p_topic, err);
+        return err;
+    }
+
+    inflight_arm();
+
+    return 0;
+}
+
+int app_backend_stream(char *p_topic, uint8_t *p_data, size_t len)
+{
+    return golioth_submit(GOLIOTH_KIND_STREAM, p_topic, p_data, len);
+}
+
+int app_backend_publish(char *p_topic, uint8_t *p_data, size_t len)
+{
+    return golioth_submit(GOLIOTH_KIND_PUBLISH, p_topic, p_data, len);
+}
+
+void app_backend_inflight_stats_get(struct inflight_stats *p_stats)
+{
+    inflight_stats_get(&inflight, p_stats);
+}
+#else
 static int async_handler(struct golioth_req_rsp *rsp)
 {
     if (rsp->err)
@@ -73,6 +298,13 @@ int app_backend_stream(char *p_topic, uint8_t *p_data, size_t len)
         LOG_WRN("Failed to stream data: %i", err);
     }
 
+#ifdef CONFIG_APP_BACKEND_METRICS
+    if (err)
+        app_backend_metrics_failed(p_topic);
+    else
+        app_backend_metrics_sent(p_topic, len);
+#endif
+
     return err;
 }
 
@@ -90,17 +322,81 @@ int app_backend_publish(char *p_topic, uint8_t *p_data, size_t len)
         LOG_WRN("Failed to publish data: %i", err);
     }
 
+#ifdef CONFIG_APP_BACKEND_METRICS
+    if (err)
+        app_backend_metrics_failed(p_topic);
+    else
+        app_backend_metrics_sent(p_topic, len);
+#endif
+
     return err;
 }
+#endif
+
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+static int downlink_handler(struct golioth_req_rsp *rsp)
+{
+    const char *p_path = rsp->user_data;
+
+    if (rsp->err)
+    {
+        LOG_WRN("Unable to observe %s. Err: %d", p_path, rsp->err);
+        return rsp->err;
+    }
+
+    /* Points into the received packet */
+    app_backend_downlink_dispatch(p_path, strlen(p_path), rsp->data, rsp->len);
+
+    return 0;
+}
+
+int app_backend_subscribe(const char *topic)
+{
+    /* Observed on connect */
+    if (!is_connected)
+        return 0;
+
+    return golioth_lightdb_observe_cb(client, topic, GOLIOTH_CONTENT_FORMAT_APP_CBOR,
+                                      downlink_handler, (void *)topic);
+}
+#endif
+
+int app_backend_stream_add(char *p_topic, uint8_t *p_data, size_t len)
+{
+    /* Nothing to pack */
+    return app_backend_stream(p_topic, p_data, len);
+}
+
+int app_backend_stream_flush(void)
+{
+    return 0;
+}
+
+int app_backend_merged(char *p_topic, uint8_t *p_data, size_t len)
+{
+    /* The newest stream entry is the latest state */
+    return app_backend_stream(p_topic, p_data, len);
+}
 
 int app_backend_init(char *client_id, size_t client_id_len)
 {
     ARG_UNUSED(client_id);
     ARG_UNUSED(client_id_len);
 
-    /*Setup and connect to Golioth*/
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+    static const struct inflight_config config = {
+        .timeout_ms = CONFIG_APP_BACKEND_INFLIGHT_TIMEOUT * MSEC_PER_SEC,
+        .backoff_min_ms = CONFIG_APP_BACKEND_INFLIGHT_BACKOFF_MIN * MSEC_PER_SEC,
+        .backoff_max_ms = CONFIG_APP_BACKEND_INFLIGHT_BACKOFF_MAX * MSEC_PER_SEC,
+        .max_attempts = CONFIG_APP_BACKEND_INFLIGHT_ATTEMPTS,
+    };
+
+    inflight_init(&inflight, inflight_mem, sizeof(inflight_mem), &config, inflight_send,
+                  inflight_result, inflight_fail, NULL);
+#endif
+
+    /* Connected by app_backend_connect() once there's something to send */
     client->on_connect = golioth_on_connect;
-    golioth_system_client_start();
 
     return 0;
 }
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Stand-in backend. Every transmit is kept in memory (and optionally
+ * written to a file on the host) instead of going to a server. Latency,
+ * failures and disconnects can be injected to exercise the data path.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include <app_event_manager.h>
+#include <app_backend.h>
+#include <app_backend_loopback.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(backend_loopback);
+
+static K_MUTEX_DEFINE(lock);
+
+static struct app_backend_loopback_config config = {
+    .latency_ms = CONFIG_APP_BACKEND_LOOPBACK_LATENCY_MS,
+    .fail_every = CONFIG_APP_BACKEND_LOOPBACK_FAIL_EVERY,
+    .disconnect_every = CONFIG_APP_BACKEND_LOOPBACK_DISCONNECT_EVERY,
+    .reconnect_ms = CONFIG_APP_BACKEND_LOOPBACK_RECONNECT_MS,
+};
+
+static struct app_backend_loopback_stats stats;
+static uint32_t transmits;
+
+#define LOOPBACK_RECORDS CONFIG_APP_BACKEND_LOOPBACK_RECORDS
+
+/* Newest records */
+static struct app_backend_loopback_record records[LOOPBACK_RECORDS];
+static int record_next;
+static int record_count;
+
+static atomic_t is_connected;
+
+#ifdef CONFIG_APP_BACKEND_LOOPBACK_FILE
+static FILE *p_file;
+#endif
+
+static void loopback_connect_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(connect_work, loopback_connect_fn);
+
+static void loopback_connect_fn(struct k_work *work)
+{
+    if (atomic_set(&is_connected, true))
+        return;
+
+    APP_EVENT_MANAGER_PUSH(APP_EVENT_BACKEND_CONNECTED);
+}
+
+static void loopback_disconnect(void)
+{
+    if (!atomic_set(&is_connected, false))
+        return;
+
+    APP_EVENT_MANAGER_PUSH(APP_EVENT_BACKEND_DISCONNECTED);
+}
+
+#ifdef CONFIG_APP_BACKEND_LOOPBACK_FILE
+static void loopback_file_write(const struct app_backend_loopback_record *p_rec, const uint8_t *p_data,
+                                size_t len)
+{
+    static const char *const kinds[] = {"publish", "stream", "merged"};
+
+    if (p_file == NULL)
+        return;
+
+    /* One line per transmit: time, kind, topic, length, hex payload */
+    fprintf(p_file, "%lld %s %s %u ", p_rec->ts, kinds[p_rec->kind], p_rec->topic, len);
+
+    for (size_t i = 0; i < len; i++)
+        fprintf(p_file, "%02x", p_data[i]);
+
+    fprintf(p_file, "\n");
+    fflush(p_file);
+}
+#endif
+
+static int loopback_transmit(enum app_backend_loopback_kind kind, const char *p_topic,
+                             const uint8_t *p_data, size_t len)
+{
+    int err = 0;
+    bool drop = false;
+
+    if (!atomic_get(&is_connected))
+    {
+        k_mutex_lock(&lock, K_FOREVER);
+        stats.rejected++;
+        k_mutex_unlock(&lock);
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+        app_backend_metrics_failed(p_topic);
+#endif
+        return -ENOTCONN;
+    }
+
+    /* On the air */
+    if (config.latency_ms)
+        k_sleep(K_MSEC(config.latency_ms));
+
+    k_mutex_lock(&lock, K_FOREVER);
+
+    transmits++;
+
+    if (config.fail_every && transmits % config.fail_every == 0)
+    {
+        stats.failures++;
+        err = -EIO;
+    }
+    else
+    {
+        struct app_backend_loopback_record *p_rec = &records[record_next];
+
+        p_rec->ts = k_uptime_get();
+        p_rec->kind = kind;
+        strncpy(p_rec->topic, p_topic, sizeof(p_rec->topic) - 1);
+        p_rec->topic[sizeof(p_rec->topic) - 1] = '\0';
+        p_rec->len = MIN(len, sizeof(p_rec->data));
+        memcpy(p_rec->data, p_data, p_rec->len);
+
+        record_next = (record_next + 1) % LOOPBACK_RECORDS;
+        record_count = MIN(record_count + 1, LOOPBACK_RECORDS);
+
+        stats.messages[kind]++;
+        stats.bytes[kind] += len;
+
+#ifdef CONFIG_APP_BACKEND_LOOPBACK_FILE
+        loopback_file_write(p_rec, p_data, len);
+#endif
+    }
+
+    if (config.disconnect_every && transmits % config.disconnect_every == 0)
+    {
+        stats.disconnects++;
+        drop = true;
+    }
+
+    k_mutex_unlock(&lock);
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+    /* Acked once the latency is over */
+    if (err)
+    {
+        app_backend_metrics_failed(p_topic);
+    }
+    else
+    {
+        app_backend_metrics_sent(p_topic, len);
+        app_backend_metrics_acked(p_topic, config.latency_ms);
+    }
+#endif
+
+    if (drop)
+    {
+        loopback_disconnect();
+        k_work_reschedule(&connect_work, K_MSEC(config.reconnect_ms));
+    }
+
+    return err;
+}
+
+/* Public functions*/
+int app_backend_publish(char *p_topic, uint8_t *p_data, size_t len)
+{
+    return loopback_transmit(APP_BACKEND_LOOPBACK_PUBLISH, p_topic, p_data, len);
+}
+
+int app_backend_stream(char *p_topic, uint8_t *p_data, size_t len)
+{
+    return loopback_transmit(APP_BACKEND_LOOPBACK_STREAM, p_topic, p_data, len);
+}
+
+int app_backend_stream_add(char *p_topic, uint8_t *p_data, size_t len)
+{
+    /* Nothing to pack */
+    return app_backend_stream(p_topic, p_data, len);
+}
+
+int app_backend_stream_flush(void)
+{
+    return 0;
+}
+
+int app_backend_merged(char *p_topic, uint8_t *p_data, size_t len)
+{
+    return loopback_transmit(APP_BACKEND_LOOPBACK_MERGED, p_topic, p_data, len);
+}
+
+int app_backend_connect(void)
+{
+    k_work_reschedule(&connect_work, K_MSEC(config.reconnect_ms));
+
+    return 0;
+}
+
+int app_backend_disconnect(void)
+{
+    k_work_cancel_delayable(&connect_work);
+    loopback_disconnect();
+
+    return 0;
+}
+
+bool app_backend_is_connected(void)
+{
+    return atomic_get(&is_connected);
+}
+
+int app_backend_init(char *client_id, size_t client_id_len)
+{
+    ARG_UNUSED(client_id);
+    ARG_UNUSED(client_id_len);
+
+#ifdef CONFIG_APP_BACKEND_LOOPBACK_FILE
+    p_file = fopen(CONFIG_APP_BACKEND_LOOPBACK_FILE_PATH, "a");
+    if (p_file == NULL)
+        LOG_WRN("Unable to open %s", CONFIG_APP_BACKEND_LOOPBACK_FILE_PATH);
+#endif
+
+    return app_backend_connect();
+}
+
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+int app_backend_subscribe(const char *topic)
+{
+    ARG_UNUSED(topic);
+
+    /* Downlinks come from app_backend_loopback_downlink() */
+    return 0;
+}
+
+int app_backend_loopback_downlink(const char *topic, const uint8_t *p_data, size_t len)
+{
+    if (!atomic_get(&is_connected))
+        return -ENOTCONN;
+
+    return app_backend_downlink_dispatch(topic, strlen(topic), p_data, len);
+}
+#endif
+
+void app_backend_loopback_config_set(const struct app_backend_loopback_config *p_config)
+{
+    k_mutex_lock(&lock, K_FOREVER);
+    config = *p_config;
+    k_mutex_unlock(&lock);
+}
+
+void app_backend_loopback_stats_get(struct app_backend_loopback_stats *p_stats)
+{
+    k_mutex_lock(&lock, K_FOREVER);
+    *p_stats = stats;
+    k_mutex_unlock(&lock);
+}
+
+int app_backend_loopback_count(void)
+{
+    return record_count;
+}
+
+int app_backend_loopback_record_get(int idx, struct app_backend_loopback_record *p_rec)
+{
+    int err = 0;
+
+    k_mutex_lock(&lock, K_FOREVER);
+
+    if (idx < 0 || idx >= record_count)
+        err = -ENOENT;
+    else
+        *p_rec = records[(record_next - record_count + idx + LOOPBACK_RECORDS) % LOOPBACK_RECORDS];
+
+    k_mutex_unlock(&lock);
+
+    return err;
+}
+
+void app_backend_loopback_reset(void)
+{
+    k_mutex_lock(&lock, K_FOREVER);
+
+    memset(&stats, 0, sizeof(stats));
+    transmits = 0;
+    record_next = 0;
+    record_count = 0;
+
+    k_mutex_unlock(&lock);
+}
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
+#include <string.h>
+
 #include <zephyr/kernel.h>
 #include <power/reboot.h>
 
@@ -12,9 +15,22 @@
 #include <app_event_manager.h>
 #include <app_backend.h>
 
+#ifdef CONFIG_FILE_SYSTEM_LITTLEFS
+#include <app_storage.h>
+#endif
+
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+#include <lib/uplink_frame/uplink_frame.h>
+#endif
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(backend_pyrinas);
 
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+/* Frames go to <topic>/ts */
+#define PYRINAS_STREAM_SUFFIX "/ts"
+#endif
+
 void pyrinas_cloud_evt_handler(const struct pyrinas_cloud_evt *const p_evt)
 {
 
@@ -35,6 +51,11 @@ void pyrinas_cloud_evt_handler(const struct pyrinas_cloud_evt *const p_evt)
     break;
     case PYRINAS_CLOUD_EVT_READY:
     {
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+        /* Clean session. Retained config arrives in this window. */
+        app_backend_downlink_subscribe_all();
+#endif
+
         APP_EVENT_MANAGER_PUSH(APP_EVENT_BACKEND_CONNECTED);
     }
 
@@ -45,6 +66,14 @@ void pyrinas_cloud_evt_handler(const struct pyrinas_cloud_evt *const p_evt)
     }
     break;
     case PYRINAS_CLOUD_EVT_FOTA_DONE:
+#ifdef CONFIG_APP_BACKEND_BATCH
+        /* Send what's queued while we're still connected */
+        app_backend_batch_flush();
+#endif
+#ifdef CONFIG_FILE_SYSTEM_LITTLEFS
+        /* Don't lose buffered records */
+        app_storage_flush();
+#endif
         sys_reboot(0);
         break;
     default:
@@ -52,10 +81,184 @@ void pyrinas_cloud_evt_handler(const struct pyrinas_cloud_evt *const p_evt)
     }
 }
 
+static int pyrinas_publish(char *p_topic, uint8_t *p_data, size_t len)
+{
+    int err = pyrinas_cloud_publish(p_topic, p_data, len);
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+    if (err)
+        app_backend_metrics_failed(p_topic);
+    else
+        app_backend_metrics_sent(p_topic, len);
+#endif
+
+    return err;
+}
+
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+static uint8_t stream_buf[CONFIG_APP_BACKEND_PYRINAS_STREAM_SIZE];
+static struct uplink_frame stream_frame;
+static char stream_topic[CONFIG_APP_BACKEND_PYRINAS_STREAM_TOPIC_LEN];
+static K_MUTEX_DEFINE(stream_lock);
+
+/* First failure since the last app_backend_stream_flush() */
+static int stream_err;
+
+/* Single records don't touch a frame that's being filled */
+static uint8_t single_buf[CONFIG_APP_BACKEND_PYRINAS_STREAM_SIZE];
+static struct uplink_frame single_frame;
+
+static int pyrinas_stream_publish(const char *p_topic, struct uplink_frame *p_frame)
+{
+    char topic[CONFIG_APP_BACKEND_PYRINAS_STREAM_TOPIC_LEN + sizeof(PYRINAS_STREAM_SUFFIX)];
+
+    snprintf(topic, sizeof(topic), "%s" PYRINAS_STREAM_SUFFIX, p_topic);
+
+    /* Dropped either way. The caller still has the records. */
+    int err = pyrinas_publish(topic, p_frame->p_buf, p_frame->used);
+    if (err)
+        LOG_WRN("Unable to publish %u %s records. Err: %i", p_frame->count, p_topic, err);
+    else
+        LOG_DBG("Published %u %s records in %u bytes", p_frame->count, p_topic, p_frame->used);
+
+    uplink_frame_reset(p_frame);
+
+    return err;
+}
+
+static void pyrinas_stream_flush_locked(void)
+{
+    if (stream_frame.count == 0)
+        return;
+
+    int err = pyrinas_stream_publish(stream_topic, &stream_frame);
+    if (err && stream_err == 0)
+        stream_err = err;
+}
+
+static bool pyrinas_stream_fits(char *p_topic, size_t len)
+{
+    return UPLINK_FRAME_BOUND(len) <= sizeof(stream_buf) && strlen(p_topic) < sizeof(stream_topic);
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+static void pyrinas_downlink_handler(const uint8_t *p_topic, size_t topic_len,
+                                     const uint8_t *p_data, size_t len)
+{
+    /* Points into the MQTT receive buffer */
+    app_backend_downlink_dispatch((const char *)p_topic, topic_len, p_data, len);
+}
+
+int app_backend_subscribe(const char *topic)
+{
+    /* Subscribed on connect */
+    if (!pyrinas_cloud_is_connected())
+        return 0;
+
+    return pyrinas_cloud_subscribe((char *)topic, pyrinas_downlink_handler);
+}
+#endif
+
 /* Public functions*/
 int app_backend_publish(char *p_topic, uint8_t *p_data, size_t len)
 {
-    return pyrinas_cloud_publish(p_topic, p_data, len);
+    return pyrinas_publish(p_topic, p_data, len);
+}
+
+int app_backend_stream(char *p_topic, uint8_t *p_data, size_t len)
+{
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+    /* Doesn't fit a frame. The server keeps every publish anyway. */
+    if (!pyrinas_stream_fits(p_topic, len))
+        return pyrinas_publish(p_topic, p_data, len);
+
+    k_mutex_lock(&stream_lock, K_FOREVER);
+
+    /* Same format as a drain, so the server takes one kind on <topic>/ts */
+    int err = uplink_frame_add(&single_frame, p_data, len);
+    if (err == 0)
+        err = pyrinas_stream_publish(p_topic, &single_frame);
+
+    k_mutex_unlock(&stream_lock);
+
+    return err;
+#else
+    /* The server keeps every publish */
+    return pyrinas_publish(p_topic, p_data, len);
+#endif
+}
+
+int app_backend_stream_add(char *p_topic, uint8_t *p_data, size_t len)
+{
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+    int err;
+
+    /* Stop before the caller hands over records that can't go out */
+    if (!pyrinas_cloud_is_connected())
+        return -ENOTCONN;
+
+    if (!pyrinas_stream_fits(p_topic, len))
+    {
+        err = pyrinas_publish(p_topic, p_data, len);
+        if (err)
+        {
+            k_mutex_lock(&stream_lock, K_FOREVER);
+            if (stream_err == 0)
+                stream_err = err;
+            k_mutex_unlock(&stream_lock);
+        }
+
+        return err;
+    }
+
+    k_mutex_lock(&stream_lock, K_FOREVER);
+
+    /* A frame is for one topic */
+    if (stream_frame.count && strcmp(stream_topic, p_topic) != 0)
+        pyrinas_stream_flush_locked();
+
+    err = uplink_frame_add(&stream_frame, p_data, len);
+    if (err == -ENOSPC)
+    {
+        pyrinas_stream_flush_locked();
+        err = uplink_frame_add(&stream_frame, p_data, len);
+    }
+
+    if (err == 0 && stream_frame.count == 1)
+        strcpy(stream_topic, p_topic);
+
+    /* A failed publish of earlier records is reported by the flush */
+    k_mutex_unlock(&stream_lock);
+
+    return err;
+#else
+    return pyrinas_publish(p_topic, p_data, len);
+#endif
+}
+
+int app_backend_stream_flush(void)
+{
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+    k_mutex_lock(&stream_lock, K_FOREVER);
+
+    pyrinas_stream_flush_locked();
+
+    int err = stream_err;
+    stream_err = 0;
+
+    k_mutex_unlock(&stream_lock);
+
+    return err;
+#else
+    return 0;
+#endif
+}
+
+int app_backend_merged(char *p_topic, uint8_t *p_data, size_t len)
+{
+    /* The server keeps every publish and tracks the newest */
+    return pyrinas_publish(p_topic, p_data, len);
 }
 
 int app_backend_connect(void)
@@ -80,6 +283,11 @@ int app_backend_init(char *client_id, size_t len)
         },
     };
 
+#ifdef CONFIG_APP_BACKEND_PYRINAS_STREAM
+    uplink_frame_init(&stream_frame, stream_buf, sizeof(stream_buf));
+    uplink_frame_init(&single_frame, single_buf, sizeof(single_buf));
+#endif
+
     pyrinas_cloud_init(&config);
 
     return 0;
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <limits.h>
+#include <string.h>
+
 #include <app_codec.h>
 
 #include <zcbor_decode.h>
@@ -58,6 +61,38 @@ int app_codec_motion_encode(struct app_motion_data *p_payload, uint8_t *p_buf, s
     return 0;
 }
 
+int app_codec_motion_config_decode(const uint8_t *p_buf, size_t len, struct app_motion_config *p_config)
+{
+    struct zcbor_string key;
+    uint32_t val;
+
+    ZCBOR_STATE_D(ds, 1, p_buf, len, 1);
+
+    if (!zcbor_map_start_decode(ds))
+        return -EBADMSG;
+
+    /* Stops at the end of the map */
+    while (zcbor_tstr_decode(ds, &key))
+    {
+        if (key.len == sizeof("interval") - 1 && memcmp(key.value, "interval", key.len) == 0)
+        {
+            if (!zcbor_uint32_decode(ds, &val))
+                return -EBADMSG;
+
+            if (val == 0 || val > INT_MAX)
+                return -EINVAL;
+
+            p_config->trigger_interval = val;
+        }
+        else if (!zcbor_any_skip(ds, NULL))
+        {
+            return -EBADMSG;
+        }
+    }
+
+    return 0;
+}
+
 int app_codec_gps_encode(struct app_gps_data *p_payload, uint8_t *p_buf, size_t buf_len, size_t *p_size)
 {
     // Setup of the goods
@@ -182,3 +217,211 @@ int app_codec_device_info_encode(struct app_modem_info *p_payload, uint8_t *p_bu
     /* Finish things up */
     return 0;
 }
+
+#if defined(CONFIG_APP_GPS_STATS) || defined(CONFIG_APP_FLASH_STATS) || defined(CONFIG_APP_BACKEND_METRICS)
+static bool app_codec_histogram_encode(zcbor_state_t *es, struct histogram *p_hist)
+{
+    size_t buckets = histogram_buckets(p_hist);
+    bool ok = zcbor_list_start_encode(es, buckets);
+
+    for (size_t i = 0; i < buckets; i++)
+        ok = ok && zcbor_uint32_put(es, p_hist->counts[i]);
+
+    return ok && zcbor_list_end_encode(es, buckets);
+}
+#endif
+
+#ifdef CONFIG_APP_GPS_STATS
+int app_codec_gnss_stats_encode(struct app_gps_stats *p_payload, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size)
+{
+    // Setup of the goods
+    ZCBOR_STATE_E(es, 0, p_buf, buf_len, 0);
+
+    /* No timestamp entry without a time */
+    size_t entries = ts > 0 ? 9 : 8;
+
+    /* Create over-arching map */
+    bool ok = zcbor_map_start_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not start CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    /* Session counts */
+    zcbor_tstr_put_lit(es, "n");
+    zcbor_uint32_put(es, p_payload->sessions);
+    zcbor_tstr_put_lit(es, "fix");
+    zcbor_uint32_put(es, p_payload->fixes);
+    zcbor_tstr_put_lit(es, "to");
+    zcbor_uint32_put(es, p_payload->timeouts);
+
+    /* Histograms */
+    zcbor_tstr_put_lit(es, "ttff");
+    app_codec_histogram_encode(es, &p_payload->ttff);
+    zcbor_tstr_put_lit(es, "blk");
+    app_codec_histogram_encode(es, &p_payload->blocked);
+    zcbor_tstr_put_lit(es, "trk");
+    app_codec_histogram_encode(es, &p_payload->sats_tracked);
+    zcbor_tstr_put_lit(es, "used");
+    app_codec_histogram_encode(es, &p_payload->sats_used);
+    zcbor_tstr_put_lit(es, "acc");
+    app_codec_histogram_encode(es, &p_payload->accuracy);
+
+    /* Timestamp */
+    if (ts > 0)
+    {
+        zcbor_tstr_put_lit(es, "ts");
+        zcbor_uint64_put(es, ts);
+    }
+
+    /* Close map */
+    ok = zcbor_map_end_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not encode CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    *p_size = es->payload - p_buf;
+    LOG_INF("Size: %i", *p_size);
+
+    /* Finish things up */
+    return 0;
+}
+#endif
+
+
+#ifdef CONFIG_APP_FLASH_STATS
+int app_codec_flash_stats_encode(struct app_flash_stats *p_payload, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size)
+{
+    struct flash_wear *p_wear = p_payload->p_wear;
+
+    // Setup of the goods
+    ZCBOR_STATE_E(es, 0, p_buf, buf_len, 0);
+
+    /* No timestamp entry without a time */
+    size_t entries = ts > 0 ? 13 : 12;
+
+    /* Create over-arching map */
+    bool ok = zcbor_map_start_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not start CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    /* Partition */
+    zcbor_tstr_put_lit(es, "p");
+    zcbor_tstr_put_term(es, p_payload->name);
+
+    /* Traffic since boot */
+    zcbor_tstr_put_lit(es, "rb");
+    zcbor_uint64_put(es, p_wear->bytes[FLASH_WEAR_READ]);
+    zcbor_tstr_put_lit(es, "pb");
+    zcbor_uint64_put(es, p_wear->bytes[FLASH_WEAR_PROGRAM]);
+    zcbor_tstr_put_lit(es, "ec");
+    zcbor_uint32_put(es, p_wear->calls[FLASH_WEAR_ERASE]);
+    zcbor_tstr_put_lit(es, "err");
+    zcbor_uint32_put(es, p_wear->errors[FLASH_WEAR_READ] +
+                             p_wear->errors[FLASH_WEAR_PROGRAM] +
+                             p_wear->errors[FLASH_WEAR_ERASE]);
+
+    /* Wear */
+    zcbor_tstr_put_lit(es, "min");
+    zcbor_uint32_put(es, p_payload->summary.min);
+    zcbor_tstr_put_lit(es, "max");
+    zcbor_uint32_put(es, p_payload->summary.max);
+    zcbor_tstr_put_lit(es, "avg");
+    zcbor_uint32_put(es, p_payload->summary.avg_x100);
+    zcbor_tstr_put_lit(es, "days");
+    zcbor_uint32_put(es, p_payload->endurance_days);
+
+    /* Latency histograms */
+    zcbor_tstr_put_lit(es, "lr");
+    app_codec_histogram_encode(es, &p_wear->latency[FLASH_WEAR_READ]);
+    zcbor_tstr_put_lit(es, "lp");
+    app_codec_histogram_encode(es, &p_wear->latency[FLASH_WEAR_PROGRAM]);
+    zcbor_tstr_put_lit(es, "le");
+    app_codec_histogram_encode(es, &p_wear->latency[FLASH_WEAR_ERASE]);
+
+    /* Timestamp */
+    if (ts > 0)
+    {
+        zcbor_tstr_put_lit(es, "ts");
+        zcbor_uint64_put(es, ts);
+    }
+
+    /* Close map */
+    ok = zcbor_map_end_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not encode CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    *p_size = es->payload - p_buf;
+    LOG_INF("Size: %i", *p_size);
+
+    /* Finish things up */
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+int app_codec_backend_metrics_encode(struct app_backend_metrics *p_metrics, size_t count, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size)
+{
+    // Setup of the goods
+    ZCBOR_STATE_E(es, 0, p_buf, buf_len, 0);
+
+    /* No timestamp entry without a time */
+    size_t entries = ts > 0 ? 2 : 1;
+
+    /* Create over-arching map */
+    bool ok = zcbor_map_start_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not start CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    /* One array per topic */
+    zcbor_tstr_put_lit(es, "t");
+    zcbor_list_start_encode(es, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        zcbor_list_start_encode(es, 6);
+        zcbor_tstr_put_term(es, p_metrics[i].topic);
+        zcbor_uint32_put(es, p_metrics[i].messages);
+        zcbor_uint32_put(es, p_metrics[i].bytes);
+        zcbor_uint32_put(es, p_metrics[i].overhead);
+        zcbor_uint32_put(es, p_metrics[i].failures);
+        app_codec_histogram_encode(es, &p_metrics[i].latency);
+        zcbor_list_end_encode(es, 6);
+    }
+
+    zcbor_list_end_encode(es, count);
+
+    /* Timestamp */
+    if (ts > 0)
+    {
+        zcbor_tstr_put_lit(es, "ts");
+        zcbor_uint64_put(es, ts);
+    }
+
+    /* Close map */
+    ok = zcbor_map_end_encode(es, entries);
+    if (!ok)
+    {
+        LOG_ERR("Did not encode CBOR map correctly. Err: %i", zcbor_peek_error(es));
+        return -ENOMEM;
+    }
+
+    *p_size = es->payload - p_buf;
+    LOG_INF("Size: %i", *p_size);
+
+    /* Finish things up */
+    return 0;
+}
+#endif
\ No newline at end of file
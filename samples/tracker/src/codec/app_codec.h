@@ -12,8 +12,17 @@
 #include <modem/modem_info.h>
 
 #include <app_gps.h>
+#include <app_gps_stats.h>
 #include <app_motion.h>
 
+#ifdef CONFIG_APP_FLASH_STATS
+#include <app_flash_stats.h>
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+#include <app_backend.h>
+#endif
+
 struct app_modem_info
 {
     struct modem_param_info data;
@@ -54,4 +63,60 @@ int app_codec_device_info_encode(struct app_modem_info *p_payload, uint8_t *p_bu
  */
 int app_codec_motion_encode(struct app_motion_data *p_payload, uint8_t *p_buf, size_t buf_len, size_t *p_size);
 
+/**
+ * @brief Decodes a motion config update ({"interval": seconds}). Keys that
+ * aren't there keep their value in p_config.
+ *
+ * @param p_buf the encoded config
+ * @param len length of the encoded config
+ * @param p_config updated in place
+ * @return int 0 on success. -EBADMSG if it's not a map. -EINVAL if a value
+ * is out of range.
+ */
+int app_codec_motion_config_decode(const uint8_t *p_buf, size_t len, struct app_motion_config *p_config);
+
+/**
+ * @brief Encodes the GNSS diagnostics record. Histograms are sent as arrays
+ * of bucket counts.
+ *
+ * @param p_payload the data structure we're working with
+ * @param ts timestamp (0 to leave out)
+ * @param p_buf where the encoded data will be stored (destination buffer)
+ * @param buf_len size of the destination buffer
+ * @param p_size actual written size
+ * @return int 0 on success
+ */
+int app_codec_gnss_stats_encode(struct app_gps_stats *p_payload, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size);
+
+#ifdef CONFIG_APP_FLASH_STATS
+/**
+ * @brief Encodes the flash diagnostics record for one partition. Latency
+ * histograms are sent as arrays of bucket counts.
+ *
+ * @param p_payload the data structure we're working with
+ * @param ts timestamp (0 to leave out)
+ * @param p_buf where the encoded data will be stored (destination buffer)
+ * @param buf_len size of the destination buffer
+ * @param p_size actual written size
+ * @return int 0 on success
+ */
+int app_codec_flash_stats_encode(struct app_flash_stats *p_payload, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size);
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+/**
+ * @brief Encodes the uplink metrics record. Each topic is an array of
+ * [topic, messages, bytes, overhead, failures, latency histogram].
+ *
+ * @param p_metrics the topics
+ * @param count number of topics
+ * @param ts timestamp (0 to leave out)
+ * @param p_buf where the encoded data will be stored (destination buffer)
+ * @param buf_len size of the destination buffer
+ * @param p_size actual written size
+ * @return int 0 on success
+ */
+int app_codec_backend_metrics_encode(struct app_backend_metrics *p_metrics, size_t count, uint64_t ts, uint8_t *p_buf, size_t buf_len, size_t *p_size);
+#endif
+
 #endif /*_APP_CODEC_H*/
\ No newline at end of file
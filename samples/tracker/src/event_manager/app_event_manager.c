@@ -5,6 +5,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -18,9 +19,50 @@ LOG_MODULE_REGISTER(app_event_manager);
 #include <app_battery.h>
 #include <app_codec.h>
 #include <app_event_manager.h>
+#include <app_fifo.h>
+#include <app_radio.h>
+#include <app_track.h>
+
+#ifdef CONFIG_FILE_SYSTEM_LITTLEFS
+#include <app_storage.h>
+#endif
+
+#ifdef CONFIG_APP_COUNTERS
+#include <app_counters.h>
+#endif
+
+#ifdef CONFIG_APP_HISTORY
+#include <app_history.h>
+#endif
+
+#ifdef CONFIG_APP_STATE
+#include <app_state.h>
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+#include <app_flash_stats.h>
+#endif
+
+#ifdef CONFIG_APP_BACKEND_BATCH
+#define EVENT_MANAGER_DEADLINE_GPS CONFIG_APP_BACKEND_BATCH_DEADLINE_GPS
+#else
+/* Sent right away or queued */
+#define EVENT_MANAGER_DEADLINE_GPS 0
+#endif
 
 /* Static flags */
 static bool m_boot_message = false;
+static bool m_gnss_requested = false;
+
+/* Uplink held back while a GNSS search is running */
+static struct
+{
+    char *topic;
+    uint8_t buf[256];
+    size_t size;
+    enum app_backend_prio prio;
+    bool valid;
+} m_deferred;
 
 /* Define message queue */
 K_MSGQ_DEFINE(app_event_msq, sizeof(struct app_event), APP_EVENT_QUEUE_SIZE, 4);
@@ -39,6 +81,7 @@ static char *event_manager_events[] = {
     "APP_EVENT_GPS_STARTED",
     "APP_EVENT_MOTION_EVENT",
     "APP_EVENT_ACTIVITY_TIMEOUT",
+    "APP_EVENT_RADIO_TX_WINDOW",
     "APP_EVENT_UNKNOWN"};
 
 int app_event_manager_push(struct app_event *p_evt)
@@ -59,8 +102,406 @@ char *app_event_type_to_string(enum app_event_type type)
     }
 }
 
+#if defined(CONFIG_APP_FIFO) || defined(CONFIG_APP_HISTORY)
+/* How long a record waits for the mount before it's kept in RAM */
+#define EVENT_MANAGER_STORAGE_WAIT K_MSEC(100)
+
+/* Records kept until storage is up. The oldest goes first when full. */
+#define EVENT_MANAGER_STASH_SIZE 4
+
+enum event_manager_store
+{
+    EVENT_MANAGER_STORE_FIFO,
+    EVENT_MANAGER_STORE_HISTORY,
+};
+
+static struct
+{
+    enum event_manager_store store;
+    char *topic;
+    int64_t ts;
+    size_t size;
+    uint8_t buf[256];
+} m_stash[EVENT_MANAGER_STASH_SIZE];
+static size_t m_stash_count;
+
+static int event_manager_store_now(enum event_manager_store store, char *topic, int64_t ts,
+                                   uint8_t *buf, size_t size)
+{
+    switch (store)
+    {
+#ifdef CONFIG_APP_FIFO
+    case EVENT_MANAGER_STORE_FIFO:
+        return app_fifo_put(topic, buf, size);
+#endif
+#ifdef CONFIG_APP_HISTORY
+    case EVENT_MANAGER_STORE_HISTORY:
+        return app_history_put(ts, buf, size);
+#endif
+    default:
+        return -ENOTSUP;
+    }
+}
+
+/* What came in while storage was mounting goes first */
+static void event_manager_stash_replay(void)
+{
+    if (m_stash_count == 0 || app_storage_wait_ready(K_NO_WAIT) != 0)
+        return;
+
+    for (size_t i = 0; i < m_stash_count; i++)
+    {
+        int err = event_manager_store_now(m_stash[i].store, m_stash[i].topic, m_stash[i].ts,
+                                          m_stash[i].buf, m_stash[i].size);
+        if (err)
+            LOG_WRN("Unable to store kept %s record. Err: %i", m_stash[i].topic, err);
+    }
+
+    LOG_INF("Stored %u records kept while storage was mounting", m_stash_count);
+
+    m_stash_count = 0;
+}
+
+/* Never blocks the event loop on the first time erase */
+static int event_manager_store(enum event_manager_store store, char *topic, int64_t ts,
+                               uint8_t *buf, size_t size)
+{
+    if (app_storage_wait_ready(EVENT_MANAGER_STORAGE_WAIT) == 0)
+    {
+        event_manager_stash_replay();
+        return event_manager_store_now(store, topic, ts, buf, size);
+    }
+
+    if (size > sizeof(m_stash[0].buf))
+        return -EMSGSIZE;
+
+    if (m_stash_count == EVENT_MANAGER_STASH_SIZE)
+    {
+        LOG_WRN("Storage not ready. Dropping kept %s record.", m_stash[0].topic);
+
+#ifdef CONFIG_APP_COUNTERS
+        app_counters_inc(APP_COUNTER_DROPPED);
+#endif
+
+        memmove(&m_stash[0], &m_stash[1], sizeof(m_stash[0]) * (EVENT_MANAGER_STASH_SIZE - 1));
+        m_stash_count--;
+    }
+
+    m_stash[m_stash_count].store = store;
+    m_stash[m_stash_count].topic = topic;
+    m_stash[m_stash_count].ts = ts;
+    m_stash[m_stash_count].size = size;
+    memcpy(m_stash[m_stash_count].buf, buf, size);
+    m_stash_count++;
+
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_FIFO
+static int event_manager_drain_cb(char *topic, uint8_t *p_data, size_t len)
+{
+#ifdef CONFIG_APP_BACKEND_SESSION
+    app_backend_session_touch();
+#endif
+
+    /* Queued records are history. Don't overwrite the latest state with them.
+     * Sent together on commit. */
+    return app_backend_stream_add(topic, p_data, len);
+}
+
+static void event_manager_drain(void)
+{
+    event_manager_stash_replay();
+
+    if (!app_backend_is_connected() || app_fifo_count() == 0)
+        return;
+
+    int sent = app_fifo_drain(event_manager_drain_cb, app_backend_stream_flush,
+                              CONFIG_APP_FIFO_DRAIN_BATCH);
+    if (sent > 0)
+        LOG_INF("Sent %i queued records. %i left.", sent, app_fifo_count());
+}
+#endif
+
+static void event_manager_connect(void)
+{
+#ifdef CONFIG_APP_BACKEND_SESSION
+    app_backend_session_request();
+#else
+    app_backend_connect();
+#endif
+}
+
+/* Something is waiting for the backend */
+static bool event_manager_connect_needed(void)
+{
+#ifdef CONFIG_APP_FIFO
+    if (app_fifo_count() > 0)
+        return true;
+#endif
+
+    return !m_boot_message;
+}
+
+static void event_manager_send(char *topic, uint8_t *buf, size_t size, enum app_backend_prio prio,
+                               uint32_t deadline_s)
+{
+    int err;
+
+    /* Latest state only. Rides along in a window that's open anyway. Never
+     * queued, it's stale by the next one. Callers check the connection
+     * before they take the interval, so nothing due is skipped here. */
+    if (prio == APP_BACKEND_PRIO_DIAG)
+    {
+        if (!app_backend_is_connected())
+            return;
+
+        err = app_backend_publish(topic, buf, size);
+        if (err)
+            LOG_ERR("Unable to publish. Err: %i", err);
+
+        return;
+    }
+
+#ifdef CONFIG_APP_BACKEND_BATCH
+    /* Goes out with the rest of the topic's records */
+    err = app_backend_batch_put(topic, buf, size, prio, deadline_s);
+    if (err == 0)
+    {
+#ifdef CONFIG_APP_FIFO
+        event_manager_drain();
+#endif
+        return;
+    }
+
+    /* Too big or no free topic. Sent on its own. */
+    LOG_WRN("Unable to queue %s. Err: %i", topic, err);
+#else
+    ARG_UNUSED(deadline_s);
+#endif
+
+    /* Connect for it. Queued below until then. */
+#ifdef CONFIG_APP_BACKEND_SESSION
+    if (app_backend_is_connected())
+        app_backend_session_touch();
+    else
+        app_backend_session_request();
+#else
+    if (!app_backend_is_connected())
+        app_backend_connect();
+#endif
+
+    /* Sent once, following the topic's route */
+    err = app_backend_is_connected() ? app_backend_send(topic, buf, size) : -ENOTCONN;
+    if (err)
+    {
+        LOG_ERR("Unable to send. Err: %i", err);
+
+#ifdef CONFIG_APP_COUNTERS
+        app_counters_inc(APP_COUNTER_PUBLISH_ERRORS);
+#endif
+
+#ifdef CONFIG_APP_FIFO
+        /* Keep it until we're back online. Storage may still be coming up. */
+        err = event_manager_store(EVENT_MANAGER_STORE_FIFO, topic, 0, buf, size);
+        if (err)
+            LOG_WRN("Unable to queue %s. Err: %i", topic, err);
+#endif
+        return;
+    }
+
+#ifdef CONFIG_APP_COUNTERS
+    app_counters_inc(APP_COUNTER_UPLINKS);
+#endif
+
+#ifdef CONFIG_APP_FIFO
+    /* We're online. Work through the backlog a batch at a time. */
+    event_manager_drain();
+#endif
+}
+
+static void event_manager_send_deferred(void)
+{
+    if (!m_deferred.valid)
+        return;
+
+    LOG_INF("Sending deferred %s uplink", m_deferred.topic);
+
+    event_manager_send(m_deferred.topic, m_deferred.buf, m_deferred.size, m_deferred.prio, 0);
+    m_deferred.valid = false;
+}
+
+static void event_manager_send_gps(struct app_gps_data *p_gps_data)
+{
+    int err;
+    uint8_t buf[256];
+    size_t size = 0;
+
+    /* Encode CBOR data */
+    err = app_codec_gps_encode(p_gps_data, buf, sizeof(buf), &size);
+    if (err < 0)
+    {
+        LOG_ERR("Unable to encode data. Err: %i", err);
+        return;
+    }
+
+    LOG_INF("Data size: %i", size);
+
+#ifdef CONFIG_APP_HISTORY
+    /* Kept for range queries and re-uploads */
+    err = event_manager_store(EVENT_MANAGER_STORE_HISTORY, "gps", p_gps_data->ts, buf, size);
+    if (err)
+        LOG_WRN("Unable to store fix. Err: %i", err);
+#endif
+
+    event_manager_send("gps", buf, size, APP_BACKEND_PRIO_STATE, EVENT_MANAGER_DEADLINE_GPS);
+}
+
+#ifdef CONFIG_APP_GPS_STATS
+static void event_manager_send_gnss_diag(void)
+{
+    int err;
+    uint8_t buf[256];
+    size_t size = 0;
+    int64_t ts = 0;
+    struct app_gps_stats stats;
+
+    /* Only takes the interval once it can go out */
+    if (!app_backend_is_connected() || !app_gps_stats_uplink_due())
+        return;
+
+    app_gps_stats_get(&stats);
+
+    err = date_time_now(&ts);
+    if (err)
+        LOG_WRN("Unable to get timestamp!");
+
+    err = app_codec_gnss_stats_encode(&stats, ts, buf, sizeof(buf), &size);
+    if (err < 0)
+    {
+        LOG_ERR("Unable to encode GNSS stats. Err: %i", err);
+        return;
+    }
+
+    event_manager_send("gnss_diag", buf, size, APP_BACKEND_PRIO_DIAG, 0);
+}
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+static void event_manager_send_flash_diag(void)
+{
+    int err;
+    uint8_t buf[384];
+    size_t size = 0;
+    int64_t ts = 0;
+    struct app_flash_stats stats;
+
+    /* Only takes the interval once it can go out */
+    if (!app_backend_is_connected() || !app_flash_stats_uplink_due())
+        return;
+
+    err = date_time_now(&ts);
+    if (err)
+        LOG_WRN("Unable to get timestamp!");
+
+    for (int i = 0; i < app_flash_stats_count(); i++)
+    {
+        if (app_flash_stats_get(i, &stats))
+            continue;
+
+        err = app_codec_flash_stats_encode(&stats, ts, buf, sizeof(buf), &size);
+        if (err < 0)
+        {
+            LOG_ERR("Unable to encode flash stats. Err: %i", err);
+            continue;
+        }
+
+        event_manager_send("flash_diag", buf, size, APP_BACKEND_PRIO_DIAG, 0);
+    }
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+static void event_manager_send_uplink_diag(void)
+{
+    int err;
+    uint8_t buf[512];
+    size_t size = 0;
+    int64_t ts = 0;
+    struct app_backend_metrics metrics[CONFIG_APP_BACKEND_METRICS_TOPICS];
+    int count = 0;
+
+    /* Only takes the interval once it can go out */
+    if (!app_backend_is_connected() || !app_backend_metrics_uplink_due())
+        return;
+
+    while (count < app_backend_metrics_count() &&
+           app_backend_metrics_get(count, &metrics[count]) == 0)
+        count++;
+
+    err = date_time_now(&ts);
+    if (err)
+        LOG_WRN("Unable to get timestamp!");
+
+    err = app_codec_backend_metrics_encode(metrics, count, ts, buf, sizeof(buf), &size);
+    if (err < 0)
+    {
+        LOG_ERR("Unable to encode uplink metrics. Err: %i", err);
+        return;
+    }
+
+    event_manager_send("uplink_diag", buf, size, APP_BACKEND_PRIO_DIAG, 0);
+}
+#endif
+
+/* Diagnostics that are due, while connected */
+static void event_manager_send_diag(void)
+{
+#ifdef CONFIG_APP_GPS_STATS
+    event_manager_send_gnss_diag();
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+    event_manager_send_flash_diag();
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+    event_manager_send_uplink_diag();
+#endif
+}
+
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+/* Backend receive thread. Nothing here blocks for long. */
+static void event_manager_motion_config_cb(const struct app_backend_downlink *p_downlink,
+                                           void *p_user)
+{
+    struct app_motion_config config;
+
+    app_motion_config_get(&config);
+
+    int err = app_codec_motion_config_decode(p_downlink->p_data, p_downlink->len, &config);
+    if (err)
+    {
+        LOG_WRN("Ignoring motion config. Err: %i", err);
+        return;
+    }
+
+    /* Takes effect right away. Persisted with CONFIG_APP_STATE. */
+    app_motion_config_set(&config);
+
+    LOG_INF("Motion interval: %i s", config.trigger_interval);
+}
+#endif
+
 void event_manager_thread(void *, void *, void *)
 {
+#ifdef CONFIG_APP_BACKEND_DOWNLINK
+    int ret = app_backend_downlink_register(CONFIG_APP_BACKEND_DOWNLINK_MOTION,
+                                            event_manager_motion_config_cb, NULL);
+    if (ret)
+        LOG_ERR("Unable to register motion config. Err: %i", ret);
+#endif
 
     for (;;)
     {
@@ -76,10 +517,23 @@ void event_manager_thread(void *, void *, void *)
             break;
         case APP_EVENT_CELLULAR_CONNECTED:
 
-            /* Connect */
-            app_backend_connect();
+            /* Only for something that's waiting. Otherwise the first uplink connects. */
+            if (event_manager_connect_needed())
+                event_manager_connect();
+
+            /* Searches reschedule themselves from here on. Motion brings one forward. */
+            if (!m_gnss_requested)
+            {
+                m_gnss_requested = true;
+                app_radio_gnss_request();
+            }
 
             break;
+#ifdef CONFIG_APP_BACKEND_SESSION
+        case APP_EVENT_BACKEND_DISCONNECTED:
+            app_backend_session_update(false);
+            break;
+#endif
         case APP_EVENT_BACKEND_CONNECTED:
         {
 
@@ -87,6 +541,20 @@ void event_manager_thread(void *, void *, void *)
             size_t size = 0;
             struct app_modem_info modem_info;
 
+#ifdef CONFIG_APP_BACKEND_SESSION
+            /* Starts the idle timer */
+            app_backend_session_update(true);
+#endif
+
+#ifdef CONFIG_APP_STATE
+            /* Reported before a warm reset on the same firmware */
+            if (!m_boot_message && !app_state_boot_report_needed())
+            {
+                LOG_INF("Warm boot. Skipping boot report.");
+                m_boot_message = true;
+            }
+#endif
+
             if (!m_boot_message)
             {
 
@@ -144,22 +612,38 @@ void event_manager_thread(void *, void *, void *)
                     break;
                 }
 
+                /* Boot to first uplink */
+                LOG_INF("Boot message sent %lld ms after boot", k_uptime_get());
+
                 /* Set flag */
                 m_boot_message = true;
+
+#ifdef CONFIG_APP_STATE
+                app_state_boot_reported();
+#endif
             }
 
-            /* Start GPS operations */
-            err = app_gps_start();
-            if (err)
-                LOG_ERR("Unable to start GPS. Err: %i", err);
+#if defined(CONFIG_APP_BACKEND_BATCH) && defined(CONFIG_APP_BACKEND_SESSION)
+            /* Connected for these. Send them all, most important first. */
+            app_backend_batch_flush();
+#elif defined(CONFIG_APP_BACKEND_BATCH)
+            /* Anything that came due while offline */
+            app_backend_batch_poll();
+#endif
+
+            /* Whatever came due while offline */
+            event_manager_send_diag();
+
+#ifdef CONFIG_APP_FIFO
+            /* History last. The window may close before it's done. */
+            event_manager_drain();
+#endif
 
             break;
         }
         case APP_EVENT_GPS_DATA:
         {
             struct app_gps_data gps_data = {0};
-            uint8_t buf[256];
-            size_t size = 0;
 
 #ifdef CONFIG_USE_LED_INDICATION
             /* Solid LED */
@@ -169,6 +653,11 @@ void event_manager_thread(void *, void *, void *)
             /* Set motion time to now -- avoids motion trigger */
             app_motion_set_trigger_time(k_uptime_get());
 
+            /* Search is over */
+            event_manager_send_deferred();
+
+            event_manager_send_diag();
+
             /* Get last available */
             err = app_gps_get_last_fix(&gps_data);
             if (err < 0)
@@ -177,29 +666,39 @@ void event_manager_thread(void *, void *, void *)
                 break;
             }
 
-            /* Encode CBOR data */
-            err = app_codec_gps_encode(&gps_data, buf, sizeof(buf), &size);
-            if (err < 0)
+#ifdef CONFIG_APP_GPS_FILTER
+            /* Send the smoothed position */
+            if (gps_data.filtered.valid)
             {
-                LOG_ERR("Unable to encode data. Err: %i", err);
-                break;
+                gps_data.data.latitude = gps_data.filtered.latitude;
+                gps_data.data.longitude = gps_data.filtered.longitude;
+                gps_data.data.accuracy = gps_data.filtered.accuracy;
             }
+#endif
 
-            LOG_INF("Data size: %i", size);
+#ifdef CONFIG_APP_STATE
+            /* Seeds the first search after a reset */
+            struct app_state_gnss gnss = {
+                .ts = gps_data.ts,
+                .latitude = gps_data.data.latitude,
+                .longitude = gps_data.data.longitude,
+                .altitude = gps_data.data.altitude,
+                .accuracy = gps_data.data.accuracy,
+            };
+            app_state_gnss_set(&gnss);
+#endif
 
-            /* Publish gps data */
-            err = app_backend_publish("gps", buf, size);
-            if (err)
+#ifdef CONFIG_APP_TRACK_SIMPLIFY
+            /* Only send fixes that change the track */
+            err = app_track_simplify(&gps_data);
+            if (err == -EAGAIN)
             {
-                LOG_ERR("Unable to publish. Err: %i", err);
+                LOG_DBG("Fix held by track simplification");
+                break;
             }
+#endif
 
-            /* Stream gps data */
-            err = app_backend_stream("gps", buf, size);
-            if (err)
-            {
-                LOG_ERR("Unable to stream. Err: %i", err);
-            }
+            event_manager_send_gps(&gps_data);
 
             break;
         }
@@ -235,28 +734,42 @@ void event_manager_thread(void *, void *, void *)
 
             LOG_INF("Data size: %i", size);
 
-            /* Publish gps data */
-            err = app_backend_publish("motion", buf, size);
-            if (err)
+            /* Don't block a running GNSS search. Only the latest is kept. */
+            if (app_radio_uplink_defer())
             {
-                LOG_ERR("Unable to publish. Err: %i", err);
+                memcpy(m_deferred.buf, buf, size);
+                m_deferred.size = size;
+                m_deferred.topic = "motion";
+                m_deferred.prio = APP_BACKEND_PRIO_ALARM;
+                m_deferred.valid = true;
             }
-
-            /* Also stream it */
-            err = app_backend_stream("motion", buf, size);
-            if (err)
+            else
             {
-                LOG_ERR("Unable to publish. Err: %i", err);
+                event_manager_send_deferred();
+                event_manager_send("motion", buf, size, APP_BACKEND_PRIO_ALARM, 0);
             }
 
             /* (Re)start GPS operations */
-            err = app_gps_start();
-            if (err)
-                LOG_ERR("Unable to start GPS. Err: %i", err);
+            app_radio_gnss_request();
 
             break;
         }
         case APP_EVENT_GPS_TIMEOUT:
+        {
+#ifdef CONFIG_APP_TRACK_SIMPLIFY
+            struct app_gps_data gps_data;
+
+            /* Send the end of the track */
+            if (app_track_flush(&gps_data) == 0)
+                event_manager_send_gps(&gps_data);
+#endif
+
+            /* Search is over */
+            event_manager_send_deferred();
+
+#ifdef CONFIG_APP_GPS_STATS
+            event_manager_send_gnss_diag();
+#endif
 
             /* Stop GPS */
             // app_gps_stop();
@@ -265,6 +778,21 @@ void event_manager_thread(void *, void *, void *)
             app_motion_reset_trigger_time();
 
             break;
+        }
+#ifdef CONFIG_APP_RADIO_TX_SCHED
+        case APP_EVENT_RADIO_TX_WINDOW:
+
+            /* The radio is up anyway. Everything that's held goes along. */
+            if (app_backend_is_connected())
+                app_backend_batch_flush();
+#ifdef CONFIG_APP_BACKEND_SESSION
+            /* Flushed once the session is up */
+            else if (app_backend_batch_pending())
+                app_backend_session_request();
+#endif
+
+            break;
+#endif
 
         default:
             break;
@@ -43,6 +43,7 @@ enum app_event_type
     APP_EVENT_GPS_STARTED,
     APP_EVENT_MOTION_EVENT,
     APP_EVENT_ACTIVITY_TIMEOUT,
+    APP_EVENT_RADIO_TX_WINDOW,
     APP_EVENT_END
 };
 
@@ -20,9 +20,19 @@ LOG_MODULE_REGISTER(app_gps);
 #include <nrf_modem_gnss.h>
 #include <date_time.h>
 
+/* Library deps */
+#include <lib/gnss/gnss_filter.h>
+
 /* Local deps */
 #include <app_gps.h>
+#include <app_gps_nmea.h>
+#include <app_gps_stats.h>
 #include <app_event_manager.h>
+#include <app_radio.h>
+
+#ifdef CONFIG_APP_STATE
+#include <app_state.h>
+#endif
 
 /* Tracking state */
 static enum app_gps_state state = APP_GPS_STATE_STOPPED;
@@ -34,26 +44,111 @@ static struct app_gps_data last_pvt;
 /* AGPS */
 static struct nrf_modem_gnss_agps_data_frame last_agps;
 
+uint8_t app_gps_sats_used(const struct nrf_modem_gnss_pvt_data_frame *p_pvt)
+{
+    uint8_t count = 0;
+
+    for (int i = 0; i < NRF_MODEM_GNSS_MAX_SATELLITES; i++)
+    {
+        if (p_pvt->sv[i].flags & NRF_MODEM_GNSS_SV_FLAG_USED_IN_FIX)
+            count++;
+    }
+
+    return count;
+}
+
+uint8_t app_gps_sats_tracked(const struct nrf_modem_gnss_pvt_data_frame *p_pvt)
+{
+    uint8_t count = 0;
+
+    for (int i = 0; i < NRF_MODEM_GNSS_MAX_SATELLITES; i++)
+    {
+        if (p_pvt->sv[i].sv != 0)
+            count++;
+    }
+
+    return count;
+}
+
+#ifdef CONFIG_APP_GPS_FILTER
+static struct gnss_filter filter;
+
+static const struct gnss_filter_config filter_config = {
+    .max_speed_cm_s = CONFIG_APP_GPS_FILTER_MAX_SPEED * 100,
+    .accel_sigma_cm_s2 = CONFIG_APP_GPS_FILTER_ACCEL_SIGMA,
+    .max_gap_ms = CONFIG_APP_GPS_FILTER_MAX_GAP_SEC * MSEC_PER_SEC,
+    .max_rejects = CONFIG_APP_GPS_FILTER_MAX_REJECTS,
+};
+
+/* Runs in the GNSS callback. The filter itself is integer only. */
+static enum gnss_filter_result app_gps_filter(struct app_gps_data *p_data)
+{
+    struct gnss_filter_fix fix;
+    struct gnss_filter_meas meas = {
+        .ts = k_uptime_get(),
+        .lat_e7 = (int32_t)(p_data->data.latitude * 1e7),
+        .lng_e7 = (int32_t)(p_data->data.longitude * 1e7),
+        .accuracy_cm = (uint32_t)(p_data->data.accuracy * 100),
+        .sats_used = app_gps_sats_used(&p_data->data),
+    };
+
+    enum gnss_filter_result res = gnss_filter_update(&filter, &meas);
+
+    if (gnss_filter_get(&filter, &fix) == 0)
+    {
+        p_data->filtered.valid = true;
+        p_data->filtered.latitude = fix.lat_e7 / 1e7;
+        p_data->filtered.longitude = fix.lng_e7 / 1e7;
+        p_data->filtered.accuracy = fix.accuracy_cm / 100.0f;
+    }
+
+    return res;
+}
+#endif
+
 /* Handlers */
 static void gnss_event_handler(int event)
 {
     int retval;
-    struct nrf_modem_gnss_nmea_data_frame nmea_data;
 
     switch (event)
     {
     case NRF_MODEM_GNSS_EVT_PVT:
         break;
     case NRF_MODEM_GNSS_EVT_FIX:
-        retval = nrf_modem_gnss_read(&last_pvt.data, sizeof(last_pvt.data), NRF_MODEM_GNSS_DATA_PVT);
+    {
+        /* Only replaces the last fix once it's accepted */
+        static struct app_gps_data pvt;
+
+        retval = nrf_modem_gnss_read(&pvt.data, sizeof(pvt.data), NRF_MODEM_GNSS_DATA_PVT);
         if (retval == 0)
         {
 
             /* Get timestamp */
-            int err = date_time_now(&last_pvt.ts);
+            int err = date_time_now(&pvt.ts);
             if (err < 0)
                 LOG_WRN("date_time_now, error: %d", err);
 
+#ifdef CONFIG_APP_GPS_FILTER
+            /* Outliers don't count as a fix. The search goes on. */
+            pvt.filtered.valid = false;
+
+            if (app_gps_filter(&pvt) == GNSS_FILTER_REJECTED)
+            {
+                LOG_DBG("Fix rejected by filter");
+                break;
+            }
+#endif
+
+            /* Single fix search is over */
+            app_radio_gnss_search_done(true);
+
+#ifdef CONFIG_APP_GPS_STATS
+            app_gps_stats_fix(&pvt.data);
+#endif
+
+            last_pvt = pvt;
+
             /* Set flag */
             atomic_set(&has_data, 1);
 
@@ -61,14 +156,32 @@ static void gnss_event_handler(int event)
             APP_EVENT_MANAGER_PUSH(APP_EVENT_GPS_DATA)
         }
         break;
+    }
+    case NRF_MODEM_GNSS_EVT_SLEEP_AFTER_TIMEOUT:
+    {
+        app_radio_gnss_search_done(false);
+
+#ifdef CONFIG_APP_GPS_STATS
+        /* Satellites seen right before giving up */
+        static struct nrf_modem_gnss_pvt_data_frame pvt;
+
+        retval = nrf_modem_gnss_read(&pvt, sizeof(pvt), NRF_MODEM_GNSS_DATA_PVT);
+        app_gps_stats_timeout(retval == 0 ? &pvt : NULL);
+#endif
+
+        APP_EVENT_MANAGER_PUSH(APP_EVENT_GPS_TIMEOUT);
+        break;
+    }
+    case NRF_MODEM_GNSS_EVT_BLOCKED:
+        app_radio_gnss_blocked(true);
+        break;
+    case NRF_MODEM_GNSS_EVT_UNBLOCKED:
+        app_radio_gnss_blocked(false);
+        break;
     case NRF_MODEM_GNSS_EVT_NMEA:
-        retval = nrf_modem_gnss_read(&nmea_data,
-                                     sizeof(struct nrf_modem_gnss_nmea_data_frame),
-                                     NRF_MODEM_GNSS_DATA_NMEA);
-        if (retval == 0)
-        {
-            LOG_DBG("Got NMEA data");
-        }
+#ifdef CONFIG_APP_GPS_NMEA
+        app_gps_nmea_read();
+#endif
         break;
 
     case NRF_MODEM_GNSS_EVT_AGPS_REQ:
@@ -91,25 +204,33 @@ int app_gps_stop(void)
 {
     int err;
 
+    /* A single fix search is over once it's fixed or timed out, even if the
+     * stop fails. Otherwise the next start would be refused. */
     err = nrf_modem_gnss_stop();
     if (err)
-    {
         LOG_WRN("Failed to stop GPS, error: %d", err);
+
+    if (state == APP_GPS_STATE_STOPPED)
         return err;
-    }
+
+    state = APP_GPS_STATE_STOPPED;
 
     struct app_event event = {
         .type = APP_EVENT_GPS_INACTIVE,
     };
     app_event_manager_push(&event);
 
-    return 0;
+    return err;
 }
 
 int app_gps_setup(void)
 {
     int err;
 
+#ifdef CONFIG_APP_GPS_FILTER
+    gnss_filter_init(&filter, &filter_config);
+#endif
+
     /* Configure GNSS. */
     err = nrf_modem_gnss_event_handler_set(gnss_event_handler);
     if (err != 0)
@@ -118,6 +239,14 @@ int app_gps_setup(void)
         return err;
     }
 
+    /* Only ask for NMEA if something consumes it */
+    err = nrf_modem_gnss_nmea_mask_set(APP_GPS_NMEA_MASK);
+    if (err != 0)
+    {
+        LOG_ERR("Failed to set GNSS NMEA mask");
+        return err;
+    }
+
     /* Configure use case for GNSS */
     uint8_t use_case = NRF_MODEM_GNSS_USE_CASE_MULTIPLE_HOT_START;
     err = nrf_modem_gnss_use_case_set(use_case);
@@ -142,7 +271,8 @@ int app_gps_setup(void)
         return -1;
     }
 
-    if (nrf_modem_gnss_fix_interval_set(CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL) != 0)
+    /* Single fix searches. app_radio schedules them into LTE idle gaps. */
+    if (nrf_modem_gnss_fix_interval_set(0) != 0)
     {
         LOG_ERR("Failed to set GNSS fix interval");
         return -1;
@@ -151,6 +281,53 @@ int app_gps_setup(void)
     return 0;
 }
 
+#ifdef CONFIG_APP_STATE
+/* Uncertainty codes (3GPP TS 23.032). About 2 km and 100 m. */
+#define APP_GPS_SEED_UNC 56
+#define APP_GPS_SEED_UNC_ALT 47
+#define APP_GPS_SEED_CONFIDENCE 68
+
+/* Hands the position from before a reset to GNSS so the first search isn't a cold start */
+static void app_gps_seed(void)
+{
+    static bool seeded;
+    struct app_state_gnss gnss;
+    int64_t now;
+
+    /* Once per boot */
+    if (seeded)
+        return;
+
+    seeded = true;
+
+    if (app_state_gnss_get(&gnss) || date_time_now(&now))
+        return;
+
+    if (now - gnss.ts > (int64_t)CONFIG_APP_STATE_GNSS_MAX_AGE * MSEC_PER_SEC)
+    {
+        LOG_DBG("Last position too old to seed GNSS");
+        return;
+    }
+
+    struct nrf_modem_gnss_agps_data_location location = {
+        .latitude = (int32_t)(gnss.latitude / 90.0 * (1 << 23)),
+        .longitude = (int32_t)(gnss.longitude / 360.0 * (1 << 24)),
+        .altitude = (int16_t)gnss.altitude,
+        .unc_semimajor = APP_GPS_SEED_UNC,
+        .unc_semiminor = APP_GPS_SEED_UNC,
+        .orientation_major = 0,
+        .unc_altitude = APP_GPS_SEED_UNC_ALT,
+        .confidence = APP_GPS_SEED_CONFIDENCE,
+    };
+
+    int err = nrf_modem_gnss_agps_write(&location, sizeof(location), NRF_MODEM_GNSS_AGPS_LOCATION);
+    if (err)
+        LOG_WRN("Unable to seed GNSS position. Err: %i", err);
+    else
+        LOG_INF("GNSS seeded with position from %lld s ago", (now - gnss.ts) / MSEC_PER_SEC);
+}
+#endif
+
 int app_gps_start(void)
 {
     int err;
@@ -161,6 +338,10 @@ int app_gps_start(void)
         return -EALREADY;
     }
 
+#ifdef CONFIG_APP_STATE
+    app_gps_seed();
+#endif
+
     /* Start GPS work */
     err = nrf_modem_gnss_start();
     if (err)
@@ -169,6 +350,12 @@ int app_gps_start(void)
         return err;
     }
 
+    state = APP_GPS_STATE_ACTIVE;
+
+#ifdef CONFIG_APP_GPS_STATS
+    app_gps_stats_session_start();
+#endif
+
     /* Send status update to main */
     struct app_event event = {
         .type = APP_EVENT_GPS_ACTIVE,
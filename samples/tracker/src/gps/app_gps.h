@@ -9,11 +9,25 @@
 
 #include <nrf_modem_gnss.h>
 
+/* Smoothed position */
+struct app_gps_filtered
+{
+    bool valid;
+    double latitude;
+    double longitude;
+
+    /* Estimated accuracy in meters */
+    float accuracy;
+};
+
 /* GPS Event */
 struct app_gps_data
 {
     int64_t ts;
     struct nrf_modem_gnss_pvt_data_frame data;
+
+    /* Filtered position alongside the raw one (CONFIG_APP_GPS_FILTER) */
+    struct app_gps_filtered filtered;
 };
 
 enum app_gps_state
@@ -53,4 +67,20 @@ int app_gps_set_period(int seconds);
 
 int app_gps_get_last_fix(struct app_gps_data *data);
 
+/**
+ * @brief Number of satellites used in the fix
+ *
+ * @param p_pvt PVT frame
+ * @return uint8_t satellite count
+ */
+uint8_t app_gps_sats_used(const struct nrf_modem_gnss_pvt_data_frame *p_pvt);
+
+/**
+ * @brief Number of satellites being tracked
+ *
+ * @param p_pvt PVT frame
+ * @return uint8_t satellite count
+ */
+uint8_t app_gps_sats_tracked(const struct nrf_modem_gnss_pvt_data_frame *p_pvt);
+
 #endif
\ No newline at end of file
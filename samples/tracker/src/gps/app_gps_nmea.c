@@ -0,0 +1,205 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_gps_nmea);
+
+#include <app_gps_nmea.h>
+
+#ifdef CONFIG_APP_GPS_NMEA_SINK_LFS
+#include <app_storage.h>
+#endif
+
+/* Sync the log file every this many sentences */
+#define APP_GPS_NMEA_SYNC_COUNT 16
+
+#define APP_GPS_NMEA_STACK_SIZE 2048
+
+/* A log that can't be opened is tried again this often */
+#define APP_GPS_NMEA_RETRY_MS 30000
+
+/* Frames are read directly into these buffers. Only the pointer is queued. */
+K_MEM_SLAB_DEFINE(nmea_slab, sizeof(struct nrf_modem_gnss_nmea_data_frame),
+                  CONFIG_APP_GPS_NMEA_BUFFER_COUNT, 4);
+K_MSGQ_DEFINE(nmea_msgq, sizeof(struct nrf_modem_gnss_nmea_data_frame *),
+              CONFIG_APP_GPS_NMEA_BUFFER_COUNT, 4);
+
+static atomic_t dropped = ATOMIC_INIT(0);
+
+void app_gps_nmea_read(void)
+{
+    struct nrf_modem_gnss_nmea_data_frame *p_frame;
+
+    if (k_mem_slab_alloc(&nmea_slab, (void **)&p_frame, K_NO_WAIT) != 0)
+    {
+        atomic_inc(&dropped);
+        return;
+    }
+
+    if (nrf_modem_gnss_read(p_frame, sizeof(struct nrf_modem_gnss_nmea_data_frame),
+                            NRF_MODEM_GNSS_DATA_NMEA) != 0 ||
+        k_msgq_put(&nmea_msgq, &p_frame, K_NO_WAIT) != 0)
+    {
+        k_mem_slab_free(&nmea_slab, (void **)&p_frame);
+        atomic_inc(&dropped);
+    }
+}
+
+static void app_gps_nmea_print(const char *p_str, size_t len)
+{
+    printk("%.*s", (int)len, p_str);
+}
+
+#ifdef CONFIG_APP_GPS_NMEA_SINK_LFS
+
+static struct fs_file_t log_file;
+static bool log_open = false;
+static int64_t log_retry_at = 0;
+static size_t log_size = 0;
+static int log_unsynced = 0;
+
+static int app_gps_nmea_log_open(void)
+{
+    struct fs_dirent dirent;
+
+    fs_file_t_init(&log_file);
+
+    int err = fs_open(&log_file, CONFIG_APP_GPS_NMEA_LOG_PATH,
+                      FS_O_CREATE | FS_O_WRITE | FS_O_APPEND);
+    if (err < 0)
+    {
+        LOG_ERR("Unable to open %s. Err: %i", CONFIG_APP_GPS_NMEA_LOG_PATH, err);
+        return err;
+    }
+
+    /* Pick up where we left off */
+    err = fs_stat(CONFIG_APP_GPS_NMEA_LOG_PATH, &dirent);
+    log_size = err == 0 ? dirent.size : 0;
+    log_open = true;
+
+    return 0;
+}
+
+static void app_gps_nmea_log_close(void)
+{
+    fs_close(&log_file);
+    log_open = false;
+}
+
+/* Opens the log once storage is up. Failures are retried later. */
+static bool app_gps_nmea_log_ready(void)
+{
+    if (log_open)
+        return true;
+
+    /* Still mounting */
+    if (app_storage_wait_ready(K_NO_WAIT) != 0)
+        return false;
+
+    int64_t now = k_uptime_get();
+    if (now < log_retry_at)
+        return false;
+
+    if (app_gps_nmea_log_open() == 0)
+        return true;
+
+    log_retry_at = now + APP_GPS_NMEA_RETRY_MS;
+
+    return false;
+}
+
+/* Keeps the current and the previous log around */
+static int app_gps_nmea_log_rotate(void)
+{
+    char old_path[sizeof(CONFIG_APP_GPS_NMEA_LOG_PATH) + 4];
+
+    snprintf(old_path, sizeof(old_path), "%s.old", CONFIG_APP_GPS_NMEA_LOG_PATH);
+
+    app_gps_nmea_log_close();
+    fs_unlink(old_path);
+
+    int err = fs_rename(CONFIG_APP_GPS_NMEA_LOG_PATH, old_path);
+    if (err < 0)
+        LOG_WRN("Unable to rotate NMEA log. Err: %i", err);
+
+    return app_gps_nmea_log_open();
+}
+
+static int app_gps_nmea_write(const char *p_str, size_t len)
+{
+    /* Not kept, but frames keep flowing back to the slab */
+    if (!app_gps_nmea_log_ready())
+    {
+        app_gps_nmea_print(p_str, len);
+        return 0;
+    }
+
+    if (log_size + len > CONFIG_APP_GPS_NMEA_LOG_MAX_SIZE)
+    {
+        int err = app_gps_nmea_log_rotate();
+        if (err < 0)
+            return err;
+    }
+
+    ssize_t written = fs_write(&log_file, p_str, len);
+    if (written < 0)
+    {
+        /* Opened again on a later sentence */
+        app_gps_nmea_log_close();
+        return written;
+    }
+
+    log_size += written;
+
+    if (++log_unsynced >= APP_GPS_NMEA_SYNC_COUNT)
+    {
+        log_unsynced = 0;
+        return fs_sync(&log_file);
+    }
+
+    return 0;
+}
+
+#else
+
+static int app_gps_nmea_write(const char *p_str, size_t len)
+{
+    app_gps_nmea_print(p_str, len);
+
+    return 0;
+}
+
+#endif
+
+static void app_gps_nmea_thread(void *, void *, void *)
+{
+    struct nrf_modem_gnss_nmea_data_frame *p_frame;
+
+    for (;;)
+    {
+        k_msgq_get(&nmea_msgq, &p_frame, K_FOREVER);
+
+        int err = app_gps_nmea_write(p_frame->nmea_str,
+                                     strnlen(p_frame->nmea_str, sizeof(p_frame->nmea_str)));
+        if (err < 0)
+            LOG_WRN("Unable to write NMEA. Err: %i", err);
+
+        k_mem_slab_free(&nmea_slab, (void **)&p_frame);
+
+        int count = atomic_clear(&dropped);
+        if (count > 0)
+            LOG_WRN("Dropped %i NMEA frames", count);
+    }
+}
+
+K_THREAD_DEFINE(app_gps_nmea_tid, APP_GPS_NMEA_STACK_SIZE,
+                app_gps_nmea_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
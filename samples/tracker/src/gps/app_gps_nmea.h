@@ -0,0 +1,28 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_GPS_NMEA_H
+#define _APP_GPS_NMEA_H
+
+#include <nrf_modem_gnss.h>
+
+/* NMEA sentences requested from the modem. Zero if NMEA logging is disabled. */
+#define APP_GPS_NMEA_MASK                                                     \
+    ((IS_ENABLED(CONFIG_APP_GPS_NMEA_GGA) ? NRF_MODEM_GNSS_NMEA_GGA_MASK : 0) | \
+     (IS_ENABLED(CONFIG_APP_GPS_NMEA_GLL) ? NRF_MODEM_GNSS_NMEA_GLL_MASK : 0) | \
+     (IS_ENABLED(CONFIG_APP_GPS_NMEA_GSA) ? NRF_MODEM_GNSS_NMEA_GSA_MASK : 0) | \
+     (IS_ENABLED(CONFIG_APP_GPS_NMEA_GSV) ? NRF_MODEM_GNSS_NMEA_GSV_MASK : 0) | \
+     (IS_ENABLED(CONFIG_APP_GPS_NMEA_RMC) ? NRF_MODEM_GNSS_NMEA_RMC_MASK : 0))
+
+/**
+ * @brief Reads the pending NMEA frame straight into a free buffer and queues it
+ *
+ * Called from the GNSS event handler. Never blocks. If no buffer is free the
+ * frame is dropped and counted.
+ */
+void app_gps_nmea_read(void);
+
+#endif
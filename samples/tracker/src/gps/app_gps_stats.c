@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_gps_stats);
+
+#include <app_gps.h>
+#include <app_gps_stats.h>
+#include <app_radio.h>
+
+/* Bucket bounds. Changing these changes the diagnostics record layout. */
+static const int32_t ttff_bounds[] = {5, 10, 20, 30, 45, 60, 90, 120};
+static const int32_t blocked_bounds[] = {0, 1, 2, 5, 10, 20, 30, 60};
+static const int32_t tracked_bounds[] = {3, 4, 6, 8, 10, 12};
+static const int32_t used_bounds[] = {3, 4, 5, 6, 7, 8, 10};
+static const int32_t accuracy_bounds[] = {2, 5, 10, 20, 50, 100};
+
+static struct app_gps_stats stats = {
+    .ttff = HISTOGRAM_INITIALIZER(ttff_bounds),
+    .blocked = HISTOGRAM_INITIALIZER(blocked_bounds),
+    .sats_tracked = HISTOGRAM_INITIALIZER(tracked_bounds),
+    .sats_used = HISTOGRAM_INITIALIZER(used_bounds),
+    .accuracy = HISTOGRAM_INITIALIZER(accuracy_bounds),
+};
+
+static struct k_spinlock lock;
+
+/* Current session */
+static bool active;
+static int64_t session_start;
+static uint32_t sessions_since_uplink;
+
+void app_gps_stats_session_start(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    active = true;
+    session_start = k_uptime_get();
+
+    k_spin_unlock(&lock, key);
+}
+
+/* Called with the lock held. Blocked time is app_radio's, measured per search. */
+static void app_gps_stats_session_end(const struct nrf_modem_gnss_pvt_data_frame *p_pvt,
+                                      int64_t blocked_ms)
+{
+    histogram_add(&stats.blocked, blocked_ms / MSEC_PER_SEC);
+
+    if (p_pvt != NULL)
+    {
+        histogram_add(&stats.sats_tracked, app_gps_sats_tracked(p_pvt));
+        histogram_add(&stats.sats_used, app_gps_sats_used(p_pvt));
+    }
+
+    stats.sessions++;
+    sessions_since_uplink++;
+    active = false;
+}
+
+void app_gps_stats_fix(const struct nrf_modem_gnss_pvt_data_frame *p_pvt)
+{
+    int64_t blocked_ms = app_radio_gnss_search_blocked_ms();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    /* Only the first fix of a session counts */
+    if (active)
+    {
+        histogram_add(&stats.ttff, (k_uptime_get() - session_start) / MSEC_PER_SEC);
+        histogram_add(&stats.accuracy, (int32_t)p_pvt->accuracy);
+        stats.fixes++;
+
+        app_gps_stats_session_end(p_pvt, blocked_ms);
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+void app_gps_stats_timeout(const struct nrf_modem_gnss_pvt_data_frame *p_pvt)
+{
+    int64_t blocked_ms = app_radio_gnss_search_blocked_ms();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (active)
+    {
+        stats.timeouts++;
+
+        app_gps_stats_session_end(p_pvt, blocked_ms);
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+void app_gps_stats_get(struct app_gps_stats *p_stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *p_stats = stats;
+
+    k_spin_unlock(&lock, key);
+}
+
+void app_gps_stats_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    stats.sessions = 0;
+    stats.fixes = 0;
+    stats.timeouts = 0;
+    histogram_reset(&stats.ttff);
+    histogram_reset(&stats.blocked);
+    histogram_reset(&stats.sats_tracked);
+    histogram_reset(&stats.sats_used);
+    histogram_reset(&stats.accuracy);
+    sessions_since_uplink = 0;
+
+    k_spin_unlock(&lock, key);
+}
+
+bool app_gps_stats_uplink_due(void)
+{
+    bool due = false;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (CONFIG_APP_GPS_STATS_UPLINK_SESSIONS > 0 &&
+        sessions_since_uplink >= CONFIG_APP_GPS_STATS_UPLINK_SESSIONS)
+    {
+        sessions_since_uplink = 0;
+        due = true;
+    }
+
+    k_spin_unlock(&lock, key);
+
+    return due;
+}
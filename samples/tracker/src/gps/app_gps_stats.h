@@ -0,0 +1,76 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_GPS_STATS_H
+#define _APP_GPS_STATS_H
+
+#include <nrf_modem_gnss.h>
+
+#include <lib/stats/histogram.h>
+
+/* GNSS performance counters. Histograms are cumulative since boot. */
+struct app_gps_stats
+{
+    uint32_t sessions;
+    uint32_t fixes;
+    uint32_t timeouts;
+
+    /* Time to first fix (in seconds) */
+    struct histogram ttff;
+
+    /* Time blocked by LTE per session (in seconds) */
+    struct histogram blocked;
+
+    /* Satellites tracked and used at the end of a session */
+    struct histogram sats_tracked;
+    struct histogram sats_used;
+
+    /* Reported accuracy of the fix (in meters) */
+    struct histogram accuracy;
+};
+
+/**
+ * @brief Marks the start of a search session
+ *
+ */
+void app_gps_stats_session_start(void);
+
+/**
+ * @brief Ends the session with a fix. Safe to call from the GNSS handler.
+ *
+ * @param p_pvt the fix
+ */
+void app_gps_stats_fix(const struct nrf_modem_gnss_pvt_data_frame *p_pvt);
+
+/**
+ * @brief Ends the session without a fix. Safe to call from the GNSS handler.
+ *
+ * @param p_pvt last PVT frame (for satellite counts). May be NULL.
+ */
+void app_gps_stats_timeout(const struct nrf_modem_gnss_pvt_data_frame *p_pvt);
+
+/**
+ * @brief Copies the current counters
+ *
+ * @param p_stats destination
+ */
+void app_gps_stats_get(struct app_gps_stats *p_stats);
+
+/**
+ * @brief Clears all counters
+ *
+ */
+void app_gps_stats_reset(void);
+
+/**
+ * @brief Whether enough sessions have passed to send a diagnostics record.
+ * Clears the condition when it returns true.
+ *
+ * @return true if a record should be sent
+ */
+bool app_gps_stats_uplink_due(void);
+
+#endif
@@ -16,8 +16,7 @@ LOG_MODULE_REGISTER(modem);
 
 /* Event manager */
 #include <app_event_manager.h>
-
-atomic_t is_tau = ATOMIC_INIT(0);
+#include <app_radio.h>
 
 static void lte_handler(const struct lte_lc_evt *const evt)
 {
@@ -40,6 +39,8 @@ static void lte_handler(const struct lte_lc_evt *const evt)
     case LTE_LC_EVT_RRC_UPDATE:
         LOG_INF("RRC mode: %s",
                 evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ? "Connected" : "Idle");
+
+        app_radio_rrc_update(evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED);
         break;
     case LTE_LC_EVT_PSM_UPDATE:
         LOG_INF("PSM parameter update: TAU: %d, Active time: %d",
@@ -48,8 +49,7 @@ static void lte_handler(const struct lte_lc_evt *const evt)
     case LTE_LC_EVT_TAU_PRE_WARNING:
         LOG_INF("TAU Pre-Warning");
 
-        /* Set current tau*/
-        atomic_set(&is_tau, 1);
+        app_radio_tau_pre_warning();
         break;
     case LTE_LC_EVT_NW_REG_STATUS:
         if ((evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_HOME) &&
@@ -76,9 +76,12 @@ static void lte_handler(const struct lte_lc_evt *const evt)
     case LTE_LC_EVT_MODEM_SLEEP_ENTER:
         LOG_INF("Sleep enter");
 
+        app_radio_sleep_update(true);
         break;
     case LTE_LC_EVT_MODEM_SLEEP_EXIT:
         LOG_INF("Sleep exit");
+
+        app_radio_sleep_update(false);
         break;
     default:
         break;
@@ -12,6 +12,10 @@
 #include <app_motion.h>
 #include <app_event_manager.h>
 
+#ifdef CONFIG_APP_STATE
+#include <app_state.h>
+#endif
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(app_motion);
 
@@ -78,6 +82,20 @@ void app_motion_set_trigger_time(uint64_t val)
     last_trigger = val;
 }
 
+void app_motion_config_get(struct app_motion_config *p_config)
+{
+    *p_config = m_config;
+}
+
+void app_motion_config_set(const struct app_motion_config *p_config)
+{
+    m_config = *p_config;
+
+#ifdef CONFIG_APP_STATE
+    app_state_motion_set(p_config);
+#endif
+}
+
 static int app_motion_init(void)
 {
 
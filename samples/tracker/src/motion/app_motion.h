@@ -41,6 +41,20 @@ void app_motion_reset_trigger_time(void);
 
 void app_motion_set_trigger_time(uint64_t val);
 
+/**
+ * @brief Gets the current config
+ *
+ * @param p_config filled with the config
+ */
+void app_motion_config_get(struct app_motion_config *p_config);
+
+/**
+ * @brief Replaces the config. Persisted with CONFIG_APP_STATE.
+ *
+ * @param p_config the new config
+ */
+void app_motion_config_set(const struct app_motion_config *p_config);
+
 /**
  * @brief Gets a sample from the device
  *
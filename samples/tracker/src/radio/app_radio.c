@@ -0,0 +1,333 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_radio);
+
+#include <app_event_manager.h>
+#include <app_gps.h>
+#include <app_radio.h>
+
+#define APP_RADIO_GNSS_MAX_WAIT_MS (CONFIG_APP_RADIO_GNSS_MAX_WAIT_SEC * MSEC_PER_SEC)
+#define APP_RADIO_UPLINK_DEFER_MAX_MS (CONFIG_APP_RADIO_UPLINK_DEFER_MAX_SEC * MSEC_PER_SEC)
+
+static struct k_spinlock lock;
+
+/* LTE state */
+static bool rrc_connected = false;
+static int64_t rrc_since = 0;
+static int64_t tau_since = 0;
+
+/* GNSS state */
+static enum app_radio_gnss_state gnss_state = APP_RADIO_GNSS_IDLE;
+static bool periodic = false;
+static bool blocked = false;
+static int64_t pending_since = 0;
+static int64_t search_start = 0;
+static int64_t blocked_since = 0;
+static int64_t search_blocked_ms = 0;
+
+static struct app_radio_stats stats;
+
+static void app_radio_gnss_work_fn(struct k_work *work);
+static void app_radio_gnss_stop_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(gnss_work, app_radio_gnss_work_fn);
+static K_WORK_DEFINE(gnss_stop_work, app_radio_gnss_stop_fn);
+
+static void app_radio_gnss_work_fn(struct k_work *work)
+{
+    int64_t now = k_uptime_get();
+    bool forced = false;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    switch (gnss_state)
+    {
+    case APP_RADIO_GNSS_IDLE:
+        if (!periodic)
+        {
+            k_spin_unlock(&lock, key);
+            return;
+        }
+
+        gnss_state = APP_RADIO_GNSS_PENDING;
+        pending_since = now;
+
+        __fallthrough;
+    case APP_RADIO_GNSS_PENDING:
+
+        /* Wait for the idle gap. Start regardless once we've waited long enough. */
+        if (rrc_connected && (now - pending_since) < APP_RADIO_GNSS_MAX_WAIT_MS)
+        {
+            k_spin_unlock(&lock, key);
+            k_work_reschedule(&gnss_work, K_MSEC(pending_since + APP_RADIO_GNSS_MAX_WAIT_MS - now));
+            return;
+        }
+
+        forced = rrc_connected;
+        gnss_state = APP_RADIO_GNSS_SEARCHING;
+        search_start = now;
+        search_blocked_ms = 0;
+        blocked = false;
+        break;
+    default:
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    k_spin_unlock(&lock, key);
+
+    /* -EALREADY means the last search was never stopped, not that this one started */
+    int err = app_gps_start();
+    if (err)
+    {
+        LOG_WRN("Unable to start GNSS search. Err: %i", err);
+
+        if (err == -EALREADY)
+            k_work_submit(&gnss_stop_work);
+
+        /* Try again next period */
+        key = k_spin_lock(&lock);
+        gnss_state = APP_RADIO_GNSS_IDLE;
+        k_spin_unlock(&lock, key);
+
+        k_work_reschedule(&gnss_work, K_SECONDS(CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL));
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    stats.searches++;
+    if (forced)
+        stats.forced_starts++;
+    k_spin_unlock(&lock, key);
+
+    LOG_INF("GNSS search started%s", forced ? " (LTE connected)" : "");
+}
+
+static void app_radio_gnss_stop_fn(struct k_work *work)
+{
+    app_gps_stop();
+}
+
+static void app_radio_rrc_set(bool connected)
+{
+    int64_t now = k_uptime_get();
+
+    if (connected && !rrc_connected)
+    {
+        stats.rrc_connections++;
+        rrc_since = now;
+    }
+    else if (!connected && rrc_connected)
+    {
+        stats.rrc_connected_ms += now - rrc_since;
+    }
+
+    rrc_connected = connected;
+}
+
+void app_radio_rrc_update(bool connected)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    bool opened = connected && !rrc_connected;
+
+    app_radio_rrc_set(connected);
+
+    /* Idle gap. Start the waiting search now. */
+    bool start = !connected && gnss_state == APP_RADIO_GNSS_PENDING;
+
+    k_spin_unlock(&lock, key);
+
+    if (start)
+        k_work_reschedule(&gnss_work, K_NO_WAIT);
+
+#ifdef CONFIG_APP_RADIO_TX_SCHED
+    /* Held uplinks can go along */
+    if (opened)
+    {
+        APP_EVENT_MANAGER_PUSH(APP_EVENT_RADIO_TX_WINDOW);
+    }
+#else
+    ARG_UNUSED(opened);
+#endif
+}
+
+void app_radio_tau_pre_warning(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    tau_since = k_uptime_get();
+    k_spin_unlock(&lock, key);
+
+#ifdef CONFIG_APP_RADIO_TX_SCHED
+    /* Sending now restarts the TAU timer instead of waking up twice */
+    APP_EVENT_MANAGER_PUSH(APP_EVENT_RADIO_TX_WINDOW);
+#endif
+}
+
+bool app_radio_tx_window(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    bool open = rrc_connected;
+
+#ifdef CONFIG_LTE_LC_TAU_PRE_WARNING_NOTIFICATIONS
+    /* Until the TAU itself */
+    if (tau_since && k_uptime_get() - tau_since < CONFIG_LTE_LC_TAU_PRE_WARNING_THRESHOLD_MS)
+        open = true;
+#endif
+
+    k_spin_unlock(&lock, key);
+
+    return open;
+}
+
+void app_radio_tx_count(void)
+{
+    bool open = app_radio_tx_window();
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (open)
+        stats.tx_piggybacked++;
+    else
+        stats.tx_wakeups++;
+
+    k_spin_unlock(&lock, key);
+}
+
+void app_radio_sleep_update(bool sleeping)
+{
+    if (!sleeping)
+        return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    /* A sleeping modem is never RRC connected */
+    app_radio_rrc_set(false);
+
+    k_spin_unlock(&lock, key);
+}
+
+/* Called with the lock held */
+static void app_radio_blocked_add(int64_t now)
+{
+    int64_t ms = now - blocked_since;
+
+    stats.blocked_ms += ms;
+    search_blocked_ms += ms;
+}
+
+int app_radio_gnss_request(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    periodic = true;
+
+    bool start = gnss_state == APP_RADIO_GNSS_IDLE;
+
+    k_spin_unlock(&lock, key);
+
+    if (!start)
+        return -EALREADY;
+
+    k_work_reschedule(&gnss_work, K_NO_WAIT);
+
+    return 0;
+}
+
+void app_radio_gnss_search_done(bool fix)
+{
+    int64_t now = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (gnss_state != APP_RADIO_GNSS_SEARCHING)
+    {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    if (blocked)
+    {
+        app_radio_blocked_add(now);
+        blocked = false;
+    }
+
+    if (fix)
+        stats.fixes++;
+    else
+        stats.timeouts++;
+
+    gnss_state = APP_RADIO_GNSS_IDLE;
+
+    k_spin_unlock(&lock, key);
+
+    /* Single fix searches. Make sure it's stopped before scheduling the next. */
+    k_work_submit(&gnss_stop_work);
+
+    k_work_reschedule(&gnss_work, K_SECONDS(CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL));
+}
+
+void app_radio_gnss_blocked(bool is_blocked)
+{
+    int64_t now = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (gnss_state == APP_RADIO_GNSS_SEARCHING && is_blocked != blocked)
+    {
+        if (is_blocked)
+            blocked_since = now;
+        else
+            app_radio_blocked_add(now);
+
+        blocked = is_blocked;
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+bool app_radio_uplink_defer(void)
+{
+    bool defer;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    defer = gnss_state == APP_RADIO_GNSS_SEARCHING &&
+            (k_uptime_get() - search_start) < APP_RADIO_UPLINK_DEFER_MAX_MS;
+
+    if (defer)
+        stats.uplinks_deferred++;
+
+    k_spin_unlock(&lock, key);
+
+    return defer;
+}
+
+int64_t app_radio_gnss_search_blocked_ms(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    int64_t ms = search_blocked_ms;
+
+    k_spin_unlock(&lock, key);
+
+    return ms;
+}
+
+enum app_radio_gnss_state app_radio_gnss_state_get(void)
+{
+    return gnss_state;
+}
+
+void app_radio_stats_get(struct app_radio_stats *p_stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *p_stats = stats;
+
+    k_spin_unlock(&lock, key);
+}
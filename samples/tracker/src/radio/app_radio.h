@@ -0,0 +1,143 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_RADIO_H
+#define _APP_RADIO_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief GNSS search state as seen by the coordinator
+ *
+ */
+enum app_radio_gnss_state
+{
+    APP_RADIO_GNSS_IDLE,
+    APP_RADIO_GNSS_PENDING,
+    APP_RADIO_GNSS_SEARCHING,
+};
+
+/**
+ * @brief LTE/GNSS coordination statistics
+ *
+ */
+struct app_radio_stats
+{
+    /* GNSS searches started */
+    uint32_t searches;
+
+    /* Searches that had to start while RRC was connected */
+    uint32_t forced_starts;
+
+    /* Searches that ended with/without a fix */
+    uint32_t fixes;
+    uint32_t timeouts;
+
+    /* Uplinks held back because of a search */
+    uint32_t uplinks_deferred;
+
+    /* Total time GNSS was blocked by LTE (ms) */
+    int64_t blocked_ms;
+
+    /* RRC connections and the time spent connected (ms) */
+    uint32_t rrc_connections;
+    int64_t rrc_connected_ms;
+
+    /* Uplinks sent while the radio was up anyway (RRC connected or TAU due)
+     * and the ones that had to wake it */
+    uint32_t tx_piggybacked;
+    uint32_t tx_wakeups;
+};
+
+/**
+ * @brief Updates the RRC state (from the LTE handler)
+ *
+ * @param connected true if RRC connected
+ */
+void app_radio_rrc_update(bool connected);
+
+/**
+ * @brief Updates the modem sleep state (from the LTE handler)
+ *
+ * @param sleeping true if the modem entered sleep (i.e. PSM)
+ */
+void app_radio_sleep_update(bool sleeping);
+
+/**
+ * @brief Indicates a TAU is coming up (from the LTE handler). Data sent
+ * before it goes with the TAU wake.
+ *
+ */
+void app_radio_tau_pre_warning(void);
+
+/**
+ * @brief Checks if the radio is up anyway: RRC connected or a TAU is due
+ *
+ * @return true if sending now doesn't cost a dedicated wake-up
+ */
+bool app_radio_tx_window(void);
+
+/**
+ * @brief Counts an uplink as piggybacked or as a wake-up
+ *
+ */
+void app_radio_tx_count(void);
+
+/**
+ * @brief Requests a GNSS search in the next LTE idle gap
+ *
+ * Also starts periodic searches every CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL.
+ *
+ * @return int 0 on success
+ */
+int app_radio_gnss_request(void);
+
+/**
+ * @brief Indicates the current GNSS search finished (from the GNSS handler)
+ *
+ * @param fix true if the search ended with a fix
+ */
+void app_radio_gnss_search_done(bool fix);
+
+/**
+ * @brief Indicates GNSS is blocked or unblocked by LTE (from the GNSS handler)
+ *
+ * @param blocked true if blocked
+ */
+void app_radio_gnss_blocked(bool blocked);
+
+/**
+ * @brief Checks if an uplink should be held back for a running search
+ *
+ * Counts the deferral if so.
+ *
+ * @return true if the uplink should be deferred
+ */
+bool app_radio_uplink_defer(void);
+
+/**
+ * @brief Time the current (or last) search was blocked by LTE. The only
+ * measure of blocked time, app_gps_stats reads it too.
+ *
+ * @return int64_t blocked time in ms
+ */
+int64_t app_radio_gnss_search_blocked_ms(void);
+
+/**
+ * @brief Get the current GNSS state
+ *
+ * @return enum app_radio_gnss_state
+ */
+enum app_radio_gnss_state app_radio_gnss_state_get(void);
+
+/**
+ * @brief Get the coordination statistics
+ *
+ * @param p_stats where the stats are copied to
+ */
+void app_radio_stats_get(struct app_radio_stats *p_stats);
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <app_backend.h>
+#include <app_radio.h>
+
+static int backend_shell_route(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const topics[] = {"gps", "motion"};
+
+    if (argc == 1)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(topics); i++)
+            shell_print(shell, "%s: %s", topics[i],
+                        app_backend_route_name(app_backend_route_get(topics[i])));
+
+        return 0;
+    }
+
+    if (argc != 3)
+    {
+        shell_error(shell, "Usage: backend route [<topic> <latest|series|merged>]");
+        return -EINVAL;
+    }
+
+    for (int route = 0; route < APP_BACKEND_ROUTES; route++)
+    {
+        if (strcmp(argv[2], app_backend_route_name(route)) != 0)
+            continue;
+
+        int err = app_backend_route_set(argv[1], route);
+        if (err)
+            shell_error(shell, "Unknown topic %s", argv[1]);
+
+        return err;
+    }
+
+    shell_error(shell, "Unknown route %s", argv[2]);
+
+    return -EINVAL;
+}
+
+#ifdef CONFIG_APP_BACKEND_BATCH
+static int backend_shell_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct app_backend_batch_stats stats;
+
+    app_backend_batch_stats_get(&stats);
+
+    shell_print(shell, "records: %u uplinks: %u bytes: %u errors: %u expired: %u",
+                stats.batch.records, stats.batch.uplinks, stats.batch.bytes,
+                stats.batch.send_errors, stats.batch.expired);
+    shell_print(shell, "records/uplink: %u.%02u radio s saved: %u",
+                stats.records_per_uplink_x100 / 100, stats.records_per_uplink_x100 % 100,
+                stats.radio_seconds_saved);
+    shell_print(shell, "size: %u age: %u urgent: %u manual: %u",
+                stats.batch.reasons[UPLINK_BATCH_FLUSH_SIZE],
+                stats.batch.reasons[UPLINK_BATCH_FLUSH_AGE],
+                stats.batch.reasons[UPLINK_BATCH_FLUSH_URGENT],
+                stats.batch.reasons[UPLINK_BATCH_FLUSH_MANUAL]);
+
+    struct app_radio_stats radio;
+    int64_t uptime = k_uptime_get();
+
+    app_radio_stats_get(&radio);
+
+    /* Per day of uptime so far */
+    shell_print(shell, "radio up anyway: %u wake-ups: %u (%llu/day)", radio.tx_piggybacked,
+                radio.tx_wakeups,
+                uptime ? (uint64_t)radio.tx_wakeups * 24 * 3600 * MSEC_PER_SEC / uptime : 0);
+
+    return 0;
+}
+
+static int backend_shell_flush(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = app_backend_batch_flush();
+
+    shell_print(shell, err ? "Err: %i" : "OK", err);
+
+    return err;
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_METRICS
+static int backend_shell_metrics(const struct shell *shell, size_t argc, char **argv)
+{
+    struct app_backend_metrics metrics;
+
+    shell_print(shell, "%-16s %8s %10s %10s %6s %8s", "topic", "messages", "bytes", "overhead",
+                "fails", "ack p50");
+
+    for (int i = 0; i < app_backend_metrics_count(); i++)
+    {
+        if (app_backend_metrics_get(i, &metrics))
+            continue;
+
+        shell_print(shell, "%-16s %8u %10u %10u %6u %5i ms", metrics.topic, metrics.messages,
+                    metrics.bytes, metrics.overhead, metrics.failures,
+                    histogram_percentile(&metrics.latency, 50));
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_SESSION
+static int backend_shell_session(const struct shell *shell, size_t argc, char **argv)
+{
+    struct app_backend_session_stats stats;
+
+    app_backend_session_stats_get(&stats);
+
+    shell_print(shell, "connected: %s sessions: %u idle teardowns: %u",
+                app_backend_is_connected() ? "yes" : "no", stats.sessions, stats.idle_teardowns);
+    shell_print(shell, "connected s: %lld of %lld", stats.connected_ms / MSEC_PER_SEC,
+                k_uptime_get() / MSEC_PER_SEC);
+    shell_print(shell, "connect ms avg: %lld max: %u",
+                stats.connects_measured ? stats.connect_ms_total / stats.connects_measured : 0,
+                stats.connect_ms_max);
+
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+static int backend_shell_inflight(const struct shell *shell, size_t argc, char **argv)
+{
+    struct inflight_stats stats;
+
+    app_backend_inflight_stats_get(&stats);
+
+    shell_print(shell, "submitted: %u acked: %u failed: %u window full: %u",
+                stats.submitted, stats.acked, stats.failed, stats.window_full);
+    shell_print(shell, "retries: %u timeouts: %u late: %u", stats.retries, stats.timeouts,
+                stats.late);
+    shell_print(shell, "ack ms p50: %i p90: %i p99: %i",
+                histogram_percentile(&stats.latency, 50),
+                histogram_percentile(&stats.latency, 90),
+                histogram_percentile(&stats.latency, 99));
+
+    return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(backend_cmds,
+                               SHELL_CMD_ARG(route, NULL, "Show or set topic routes.", backend_shell_route, 1, 2),
+#ifdef CONFIG_APP_BACKEND_BATCH
+                               SHELL_CMD(stats, NULL, "Show uplink batching statistics.", backend_shell_stats),
+                               SHELL_CMD(flush, NULL, "Send everything that's queued.", backend_shell_flush),
+#endif
+#ifdef CONFIG_APP_BACKEND_METRICS
+                               SHELL_CMD(metrics, NULL, "Show traffic per topic.", backend_shell_metrics),
+#endif
+#ifdef CONFIG_APP_BACKEND_SESSION
+                               SHELL_CMD(session, NULL, "Show session time and reconnect cost.", backend_shell_session),
+#endif
+#ifdef CONFIG_APP_BACKEND_INFLIGHT
+                               SHELL_CMD(inflight, NULL, "Show request ack and retry statistics.", backend_shell_inflight),
+#endif
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(backend, &backend_cmds, "Backend uplinks.", NULL);
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/shell/shell.h>
+
+#include <app_gps_stats.h>
+
+/* Percentile as "<=bound". Anything in the overflow bucket is "> last bound". */
+static char *gnss_shell_bound(const struct histogram *p_hist, uint8_t pct, char *p_buf, size_t len)
+{
+    int32_t bound = histogram_percentile(p_hist, pct);
+
+    if (bound == INT32_MAX)
+        snprintf(p_buf, len, ">%d", p_hist->p_bounds[p_hist->bounds_count - 1]);
+    else
+        snprintf(p_buf, len, "<=%d", bound);
+
+    return p_buf;
+}
+
+static void gnss_shell_histogram(const struct shell *shell, const char *name,
+                                 const struct histogram *p_hist)
+{
+    char p50[16];
+    char p90[16];
+
+    shell_fprintf(shell, SHELL_NORMAL, "%-8s", name);
+
+    for (size_t i = 0; i < p_hist->bounds_count; i++)
+        shell_fprintf(shell, SHELL_NORMAL, " <=%d:%u", p_hist->p_bounds[i], p_hist->counts[i]);
+
+    shell_fprintf(shell, SHELL_NORMAL, " >%d:%u\n", p_hist->p_bounds[p_hist->bounds_count - 1],
+                  p_hist->counts[p_hist->bounds_count]);
+
+    if (histogram_total(p_hist) > 0)
+        shell_print(shell, "         p50 %s p90 %s",
+                    gnss_shell_bound(p_hist, 50, p50, sizeof(p50)),
+                    gnss_shell_bound(p_hist, 90, p90, sizeof(p90)));
+}
+
+static int gnss_shell_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct app_gps_stats stats;
+
+    app_gps_stats_get(&stats);
+
+    shell_print(shell, "sessions: %u fixes: %u timeouts: %u",
+                stats.sessions, stats.fixes, stats.timeouts);
+
+    gnss_shell_histogram(shell, "ttff s", &stats.ttff);
+    gnss_shell_histogram(shell, "block s", &stats.blocked);
+    gnss_shell_histogram(shell, "tracked", &stats.sats_tracked);
+    gnss_shell_histogram(shell, "used", &stats.sats_used);
+    gnss_shell_histogram(shell, "acc m", &stats.accuracy);
+
+    return 0;
+}
+
+static int gnss_shell_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    app_gps_stats_reset();
+
+    shell_print(shell, "OK");
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(gnss_cmds,
+                               SHELL_CMD(stats, NULL, "Show search statistics.", gnss_shell_stats),
+                               SHELL_CMD(reset, NULL, "Clear search statistics.", gnss_shell_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(gnss, &gnss_cmds, "GNSS performance telemetry.", NULL);
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/shell/shell.h>
+
+#include <app_backend.h>
+#include <app_history.h>
+
+static const char history_usage_str[] =
+    "Usage: history <count|resend> <from> <to>\n"
+    "\n"
+    "Times are UNIX timestamps in seconds.\n";
+
+static int history_shell_range(const struct shell *shell, size_t argc, char **argv,
+                               int64_t *p_from, int64_t *p_to)
+{
+    if (argc < 3)
+    {
+        shell_print(shell, "%s", history_usage_str);
+        return -EINVAL;
+    }
+
+    /* Records are stored with ms timestamps */
+    *p_from = strtoll(argv[1], NULL, 10) * MSEC_PER_SEC;
+    *p_to = strtoll(argv[2], NULL, 10) * MSEC_PER_SEC + MSEC_PER_SEC - 1;
+
+    return 0;
+}
+
+static int history_shell_count_cb(int64_t ts, const uint8_t *p_data, size_t len, void *p_user)
+{
+    return 0;
+}
+
+static int history_shell_resend_cb(int64_t ts, const uint8_t *p_data, size_t len, void *p_user)
+{
+    /* Stop at the first failure */
+    return app_backend_stream("gps", (uint8_t *)p_data, len);
+}
+
+static int history_shell_count(const struct shell *shell, size_t argc, char **argv)
+{
+    int64_t from, to;
+
+    if (history_shell_range(shell, argc, argv, &from, &to))
+        return -EINVAL;
+
+    int count = app_history_query(from, to, history_shell_count_cb, NULL);
+
+    shell_print(shell, "%i", count);
+
+    return count < 0 ? count : 0;
+}
+
+static int history_shell_resend(const struct shell *shell, size_t argc, char **argv)
+{
+    int64_t from, to;
+
+    if (history_shell_range(shell, argc, argv, &from, &to))
+        return -EINVAL;
+
+    if (!app_backend_is_connected())
+    {
+        shell_print(shell, "Not connected");
+        return -ENOTCONN;
+    }
+
+    int count = app_history_query(from, to, history_shell_resend_cb, NULL);
+
+    shell_print(shell, "Sent %i", count);
+
+    return count < 0 ? count : 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(history_cmds,
+                               SHELL_CMD(count, NULL, "Count records in a time range.", history_shell_count),
+                               SHELL_CMD(resend, NULL, "Stream records in a time range again.", history_shell_resend),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(history, &history_cmds, "Stored GPS records.", NULL);
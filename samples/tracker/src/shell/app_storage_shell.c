@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+#include <app_history.h>
+#endif
+
+#ifdef CONFIG_APP_COUNTERS
+#include <app_counters.h>
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+#include <app_flash_stats.h>
+#endif
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+static int storage_shell_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct write_buffer_stats stats;
+
+    int err = app_history_buffer_stats(&stats);
+    if (err)
+    {
+        shell_print(shell, "Not ready");
+        return err;
+    }
+
+    /* Per hour of uptime */
+    int64_t uptime = MAX(k_uptime_get(), 1);
+    uint32_t per_hour = (uint64_t)stats.flushes * MSEC_PER_SEC * 3600 / uptime;
+
+    shell_print(shell, "records: %u flushes: %u errors: %u",
+                stats.records, stats.flushes, stats.flush_errors);
+    shell_print(shell, "flushes/h: %u bytes/flush: %u", per_hour,
+                stats.flushes ? stats.bytes_flushed / stats.flushes : 0);
+    shell_print(shell, "size: %u age: %u battery: %u reset: %u read: %u",
+                stats.reasons[WRITE_BUFFER_FLUSH_SIZE],
+                stats.reasons[WRITE_BUFFER_FLUSH_AGE],
+                stats.reasons[WRITE_BUFFER_FLUSH_BATTERY],
+                stats.reasons[WRITE_BUFFER_FLUSH_RESET],
+                stats.reasons[WRITE_BUFFER_FLUSH_READ]);
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+    struct app_history_compress_stats cstats;
+
+    app_history_compress_stats(&cstats);
+
+    /* CPU time per KB of raw records */
+    uint32_t raw_kb = MAX(cstats.raw_bytes / 1024, 1);
+
+    shell_print(shell, "chunks: %u raw: %u stored: %u (%u%%)", cstats.chunks,
+                cstats.raw_bytes, cstats.stored_bytes,
+                cstats.raw_bytes ? (uint32_t)((uint64_t)cstats.stored_bytes * 100 / cstats.raw_bytes) : 0);
+    shell_print(shell, "compress: %u us/KB decompress: %u us total",
+                k_cyc_to_us_floor32(cstats.compress_cycles) / raw_kb,
+                k_cyc_to_us_floor32(cstats.decompress_cycles));
+#endif
+
+    return 0;
+}
+
+static int storage_shell_flush(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = app_history_flush(WRITE_BUFFER_FLUSH_RESET);
+
+    shell_print(shell, err ? "Err: %i" : "OK", err);
+
+    return err;
+}
+
+#endif
+
+#ifdef CONFIG_APP_COUNTERS
+static int storage_shell_counters(const struct shell *shell, size_t argc, char **argv)
+{
+    for (int i = 0; i < APP_COUNTER_COUNT; i++)
+        shell_print(shell, "%s: %u", app_counters_name(i), app_counters_get(i));
+
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+static int storage_shell_wear(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const ops[FLASH_WEAR_OPS] = {"read", "program", "erase"};
+    struct app_flash_stats stats;
+
+    for (int i = 0; i < app_flash_stats_count(); i++)
+    {
+        if (app_flash_stats_get(i, &stats))
+            continue;
+
+        struct flash_wear *p_wear = stats.p_wear;
+
+        shell_print(shell, "%s", stats.name);
+
+        for (int op = 0; op < FLASH_WEAR_OPS; op++)
+            shell_print(shell, "  %-7s calls: %u bytes: %llu errors: %u p50: %i us p99: %i us",
+                        ops[op], p_wear->calls[op], p_wear->bytes[op], p_wear->errors[op],
+                        histogram_percentile(&p_wear->latency[op], 50),
+                        histogram_percentile(&p_wear->latency[op], 99));
+
+        shell_print(shell, "  sector erases min: %u max: %u avg: %u.%02u used: %u",
+                    stats.summary.min, stats.summary.max,
+                    stats.summary.avg_x100 / 100, stats.summary.avg_x100 % 100,
+                    stats.summary.used_sectors);
+
+        if (stats.endurance_days == UINT32_MAX)
+            shell_print(shell, "  endurance: no erases yet");
+        else
+            shell_print(shell, "  endurance: %u days at this rate", stats.endurance_days);
+    }
+
+    return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(storage_cmds,
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+                               SHELL_CMD(stats, NULL, "Show write buffer statistics.", storage_shell_stats),
+                               SHELL_CMD(flush, NULL, "Write buffered records to flash.", storage_shell_flush),
+#endif
+#ifdef CONFIG_APP_COUNTERS
+                               SHELL_CMD(counters, NULL, "Show persistent counters.", storage_shell_counters),
+#endif
+#ifdef CONFIG_APP_FLASH_STATS
+                               SHELL_CMD(wear, NULL, "Show flash wear and latency.", storage_shell_wear),
+#endif
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(storage, &storage_cmds, "External flash storage.", NULL);
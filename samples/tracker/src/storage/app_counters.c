@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_counters);
+
+#include <lib/kv_store/kv_store.h>
+
+#include <app_counters.h>
+
+BUILD_ASSERT(APP_COUNTER_COUNT <= CONFIG_KV_STORE_COUNTERS, "Raise CONFIG_KV_STORE_COUNTERS");
+
+static struct kv_store kv;
+static bool ready;
+
+static const char *const names[APP_COUNTER_COUNT] = {
+    [APP_COUNTER_BOOTS] = "boots",
+    [APP_COUNTER_UPLINKS] = "uplinks",
+    [APP_COUNTER_PUBLISH_ERRORS] = "publish_errors",
+    [APP_COUNTER_DROPPED] = "dropped",
+};
+
+int app_counters_inc(enum app_counter counter)
+{
+    if (!ready)
+        return -ENODEV;
+
+    return kv_store_counter_add(&kv, counter, 1);
+}
+
+uint32_t app_counters_get(enum app_counter counter)
+{
+    if (!ready)
+        return 0;
+
+    return kv_store_counter_get(&kv, counter);
+}
+
+ssize_t app_counters_value_read(uint16_t id, void *p_data, size_t len)
+{
+    if (!ready)
+        return -ENODEV;
+
+    return kv_store_read(&kv, id, p_data, len);
+}
+
+int app_counters_value_write(uint16_t id, const void *p_data, size_t len)
+{
+    if (!ready)
+        return -ENODEV;
+
+    return kv_store_write(&kv, id, p_data, len);
+}
+
+const char *app_counters_name(enum app_counter counter)
+{
+    return counter < APP_COUNTER_COUNT ? names[counter] : "unknown";
+}
+
+static int app_counters_init_fn(void)
+{
+    /* Internal flash. Doesn't wait for /lfs. */
+    int err = kv_store_init(&kv, FLASH_AREA_ID(nvs_storage));
+    if (err)
+    {
+        LOG_ERR("Unable to init counters. Err: %i", err);
+        return 0;
+    }
+
+    ready = true;
+
+    err = app_counters_inc(APP_COUNTER_BOOTS);
+    if (err)
+        LOG_WRN("Unable to count boot. Err: %i", err);
+
+    LOG_INF("Boot %u", app_counters_get(APP_COUNTER_BOOTS));
+
+    return 0;
+}
+
+SYS_INIT(app_counters_init_fn, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_COUNTERS_H
+#define _APP_COUNTERS_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Persistent counters
+ *
+ */
+enum app_counter
+{
+    APP_COUNTER_BOOTS,
+    APP_COUNTER_UPLINKS,
+    APP_COUNTER_PUBLISH_ERRORS,
+
+    /* Uplink records given up on: not sent and not queued */
+    APP_COUNTER_DROPPED,
+
+    APP_COUNTER_COUNT,
+};
+
+/**
+ * @brief Plain values kept with the counters. Each one owns the ids up to
+ * the next.
+ *
+ */
+enum app_value
+{
+    /* Time the flash wear counts cover (in ms) */
+    APP_VALUE_FLASH_ELAPSED = 0x100,
+
+    /* Per sector erase counts of the littlefs partition, a chunk per id */
+    APP_VALUE_FLASH_ERASES = 0x101,
+};
+
+/**
+ * @brief Adds one to a counter
+ *
+ * @param counter which one
+ * @return int 0 on success
+ */
+int app_counters_inc(enum app_counter counter);
+
+/**
+ * @brief Current value of a counter
+ *
+ * @param counter which one
+ * @return uint32_t the value
+ */
+uint32_t app_counters_get(enum app_counter counter);
+
+/**
+ * @brief Name of a counter
+ *
+ * @param counter which one
+ * @return const char* the name
+ */
+const char *app_counters_name(enum app_counter counter);
+
+/**
+ * @brief Reads a value
+ *
+ * @param id from enum app_value (plus the chunk)
+ * @param p_data destination
+ * @param len size of the destination
+ * @return ssize_t length of the value. -ENOENT if it was never written.
+ */
+ssize_t app_counters_value_read(uint16_t id, void *p_data, size_t len);
+
+/**
+ * @brief Writes a value. Unchanged values aren't written again.
+ *
+ * @param id from enum app_value (plus the chunk)
+ * @param p_data value
+ * @param len length of the value
+ * @return int 0 on success
+ */
+int app_counters_value_write(uint16_t id, const void *p_data, size_t len);
+
+#endif
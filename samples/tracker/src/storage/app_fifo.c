@@ -0,0 +1,568 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_fifo);
+
+#include <app_fifo.h>
+
+#ifdef CONFIG_APP_FIFO_COMPRESS
+#include <lib/lz/lz.h>
+#endif
+
+/*
+ * Records are appended to segment files of CONFIG_APP_FIFO_SEGMENT_RECORDS
+ * records each, named after their index (seq / segment records). Nothing is
+ * written in place: littlefs copies everything behind a write in the middle
+ * of a file, but only the last block on an append. A segment is deleted as
+ * a whole once it's drained or evicted.
+ *
+ * A small meta file holds the head and tail sequence numbers and where they
+ * are in their segment. littlefs commits a file update atomically on close,
+ * so the meta file is always either old or new. A record appended before a
+ * reset but never counted in the meta is cut off by the next put.
+ *
+ * With CONFIG_APP_FIFO_COMPRESS a record is stored LZ compressed when that
+ * makes it smaller, flagged in the top bit of its length. Drains hand the
+ * callback the original record either way.
+ */
+
+#define APP_FIFO_DIR "/lfs/fifo"
+#define APP_FIFO_META_NAME "meta"
+#define APP_FIFO_META APP_FIFO_DIR "/" APP_FIFO_META_NAME
+
+/* Directory, separator and a 32 bit index */
+#define APP_FIFO_PATH_MAX (sizeof(APP_FIFO_DIR) + 1 + 10)
+
+#define APP_FIFO_SEGMENT_RECORDS CONFIG_APP_FIFO_SEGMENT_RECORDS
+
+#define APP_FIFO_MAGIC 0x46494631 /* FIF1 */
+
+/* Stored length and format of a record */
+#define APP_FIFO_LEN_LZ 0x8000
+#define APP_FIFO_LEN(p_hdr) ((p_hdr)->len & ~APP_FIFO_LEN_LZ)
+
+BUILD_ASSERT(CONFIG_APP_FIFO_RECORD_SIZE < APP_FIFO_LEN_LZ, "Record length collides with the LZ flag");
+
+BUILD_ASSERT(CONFIG_APP_FIFO_CAPACITY >= APP_FIFO_SEGMENT_RECORDS,
+             "An evicted segment can't be the one being written");
+
+struct app_fifo_meta
+{
+    uint32_t magic;
+    uint32_t head;
+    uint32_t head_off;
+    uint32_t tail;
+    uint32_t tail_off;
+    uint32_t crc;
+};
+
+struct app_fifo_hdr
+{
+    uint32_t seq;
+    uint16_t len;
+    char topic[APP_FIFO_TOPIC_MAX];
+    uint32_t crc;
+};
+
+static K_MUTEX_DEFINE(fifo_lock);
+
+static struct app_fifo_meta meta;
+static struct app_fifo_stats stats;
+static bool ready;
+
+/* Scratch for the record being drained */
+static struct app_fifo_hdr rec_hdr;
+static uint8_t rec_buf[CONFIG_APP_FIFO_RECORD_SIZE];
+
+#ifdef CONFIG_APP_FIFO_COMPRESS
+static struct lz_ctx lz;
+
+/* Record being put, then the record being drained */
+static uint8_t packed[CONFIG_APP_FIFO_RECORD_SIZE];
+#endif
+
+static uint32_t app_fifo_hdr_crc(struct app_fifo_hdr *p_hdr, uint8_t *p_data)
+{
+    uint32_t crc = crc32_ieee((uint8_t *)p_hdr, offsetof(struct app_fifo_hdr, crc));
+
+    return crc32_ieee_update(crc, p_data, APP_FIFO_LEN(p_hdr));
+}
+
+static int app_fifo_meta_write(void)
+{
+    int err;
+    struct fs_file_t file;
+
+    meta.magic = APP_FIFO_MAGIC;
+    meta.crc = crc32_ieee((uint8_t *)&meta, offsetof(struct app_fifo_meta, crc));
+
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, APP_FIFO_META, FS_O_CREATE | FS_O_WRITE);
+    if (err)
+        return err;
+
+    err = fs_write(&file, &meta, sizeof(meta));
+
+    /* Commits the update */
+    int close_err = fs_close(&file);
+
+    if (err < 0)
+        return err;
+
+    return close_err;
+}
+
+static int app_fifo_meta_read(void)
+{
+    int err;
+    struct fs_file_t file;
+
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, APP_FIFO_META, FS_O_READ);
+    if (err)
+        return err;
+
+    err = fs_read(&file, &meta, sizeof(meta));
+    fs_close(&file);
+
+    if (err != sizeof(meta))
+        return -EIO;
+
+    if (meta.magic != APP_FIFO_MAGIC ||
+        meta.crc != crc32_ieee((uint8_t *)&meta, offsetof(struct app_fifo_meta, crc)) ||
+        meta.tail - meta.head > CONFIG_APP_FIFO_CAPACITY)
+        return -EBADMSG;
+
+    return 0;
+}
+
+static uint32_t app_fifo_segment(uint32_t seq)
+{
+    return seq / APP_FIFO_SEGMENT_RECORDS;
+}
+
+/* First sequence number of the next segment */
+static uint32_t app_fifo_segment_end(uint32_t seq)
+{
+    return (app_fifo_segment(seq) + 1) * APP_FIFO_SEGMENT_RECORDS;
+}
+
+static void app_fifo_segment_path(char *p_path, uint32_t seq)
+{
+    snprintf(p_path, APP_FIFO_PATH_MAX, APP_FIFO_DIR "/%u", app_fifo_segment(seq));
+}
+
+static void app_fifo_segment_delete(uint32_t seq)
+{
+    char path[APP_FIFO_PATH_MAX];
+
+    app_fifo_segment_path(path, seq);
+
+    int err = fs_unlink(path);
+    if (err && err != -ENOENT)
+        LOG_WRN("Unable to delete %s. Err: %i", path, err);
+}
+
+/* Anything that's not the meta or a segment between head and tail. Left
+ * over from an interrupted eviction, a reset queue or the single file
+ * layout. */
+static bool app_fifo_is_stale(const char *p_name)
+{
+    char *p_end;
+    unsigned long segment = strtoul(p_name, &p_end, 10);
+
+    if (strcmp(p_name, APP_FIFO_META_NAME) == 0)
+        return false;
+
+    return p_end == p_name || *p_end != '\0' || segment < app_fifo_segment(meta.head) ||
+           segment > app_fifo_segment(meta.tail);
+}
+
+static void app_fifo_cleanup(void)
+{
+    static struct fs_dirent entry;
+    struct fs_dir_t dir;
+    char path[sizeof(APP_FIFO_DIR) + 1 + sizeof(entry.name)];
+
+    /* One at a time. The directory isn't changed while it's open. */
+    while (true)
+    {
+        bool found = false;
+
+        fs_dir_t_init(&dir);
+
+        if (fs_opendir(&dir, APP_FIFO_DIR))
+            return;
+
+        while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0')
+        {
+            if (app_fifo_is_stale(entry.name))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        fs_closedir(&dir);
+
+        if (!found)
+            return;
+
+        snprintf(path, sizeof(path), APP_FIFO_DIR "/%s", entry.name);
+
+        int err = fs_unlink(path);
+        if (err)
+        {
+            LOG_WRN("Unable to delete %s. Err: %i", path, err);
+            return;
+        }
+
+        LOG_INF("Deleted stale %s", path);
+    }
+}
+
+int app_fifo_init(void)
+{
+    int err;
+
+    err = fs_mkdir(APP_FIFO_DIR);
+    if (err && err != -EEXIST)
+    {
+        LOG_ERR("Unable to create %s. Err: %i", APP_FIFO_DIR, err);
+        return err;
+    }
+
+    k_mutex_lock(&fifo_lock, K_FOREVER);
+
+    err = app_fifo_meta_read();
+    if (err)
+    {
+        /* Start over. Segments past the first are deleted below and the
+         * first is cut off by the next put. */
+        if (err != -ENOENT)
+            LOG_WRN("Queue metadata invalid. Err: %i", err);
+
+        memset(&meta, 0, sizeof(meta));
+
+        err = app_fifo_meta_write();
+    }
+
+    if (err == 0)
+        app_fifo_cleanup();
+
+    stats.count = meta.tail - meta.head;
+    ready = (err == 0);
+
+    k_mutex_unlock(&fifo_lock);
+
+    LOG_INF("%u queued records", stats.count);
+
+    return err;
+}
+
+int app_fifo_put(char *topic, uint8_t *p_data, size_t len)
+{
+    int err;
+    struct fs_file_t file;
+    struct app_fifo_hdr hdr = {0};
+    char path[APP_FIFO_PATH_MAX];
+
+    if (len > CONFIG_APP_FIFO_RECORD_SIZE)
+        return -EMSGSIZE;
+
+    if (strlen(topic) >= APP_FIFO_TOPIC_MAX)
+        return -EINVAL;
+
+    k_mutex_lock(&fifo_lock, K_FOREVER);
+
+    if (!ready)
+    {
+        err = -ENODEV;
+        goto unlock;
+    }
+
+    hdr.seq = meta.tail;
+    hdr.len = len;
+    strcpy(hdr.topic, topic);
+
+#ifdef CONFIG_APP_FIFO_COMPRESS
+    /* Only kept if it's smaller. -ENOSPC otherwise. */
+    int packed_len = lz_compress(&lz, p_data, len, packed, len ? len - 1 : 0);
+    if (packed_len > 0)
+    {
+        hdr.len = packed_len | APP_FIFO_LEN_LZ;
+        p_data = packed;
+    }
+#endif
+
+    hdr.crc = app_fifo_hdr_crc(&hdr, p_data);
+
+    app_fifo_segment_path(path, meta.tail);
+    fs_file_t_init(&file);
+
+    err = fs_open(&file, path, FS_O_CREATE | FS_O_RDWR);
+    if (err)
+        goto unlock;
+
+    /* Cut off whatever was appended but never made it into the meta. A no-op
+     * otherwise. */
+    err = fs_truncate(&file, meta.tail_off);
+    if (err == 0)
+        err = fs_seek(&file, meta.tail_off, FS_SEEK_SET);
+
+    if (err == 0)
+    {
+        err = fs_write(&file, &hdr, sizeof(hdr));
+        if (err == sizeof(hdr))
+            err = fs_write(&file, p_data, APP_FIFO_LEN(&hdr));
+
+        err = (err < 0) ? err : 0;
+    }
+
+    /* Record has to be on flash before the tail moves */
+    int close_err = fs_close(&file);
+    if (err || close_err)
+    {
+        err = err ? err : close_err;
+        goto unlock;
+    }
+
+    struct app_fifo_meta prev = meta;
+    uint32_t evicted = 0;
+
+    /* Oldest segment goes when full */
+    if (meta.tail - meta.head == CONFIG_APP_FIFO_CAPACITY)
+    {
+        evicted = app_fifo_segment_end(meta.head) - meta.head;
+        meta.head += evicted;
+        meta.head_off = 0;
+    }
+
+    meta.tail++;
+    meta.tail_off += sizeof(hdr) + APP_FIFO_LEN(&hdr);
+
+    if (meta.tail % APP_FIFO_SEGMENT_RECORDS == 0)
+        meta.tail_off = 0;
+
+    err = app_fifo_meta_write();
+    if (err)
+    {
+        /* The record is cut off next time */
+        meta = prev;
+        goto unlock;
+    }
+
+    if (evicted)
+    {
+        app_fifo_segment_delete(prev.head);
+        stats.evicted += evicted;
+    }
+
+    stats.count = meta.tail - meta.head;
+    stats.stored++;
+
+unlock:
+    k_mutex_unlock(&fifo_lock);
+
+    if (err)
+        LOG_ERR("Unable to queue %s record. Err: %i", topic, err);
+
+    return err;
+}
+
+/* Gives up on the rest of the head's segment */
+static void app_fifo_skip_segment(uint32_t *p_head, uint32_t *p_off)
+{
+    uint32_t end = MIN(app_fifo_segment_end(*p_head), meta.tail);
+
+    stats.corrupt += end - *p_head;
+    *p_head = end;
+
+    /* The tail's segment is still being written */
+    *p_off = (end % APP_FIFO_SEGMENT_RECORDS) ? meta.tail_off : 0;
+}
+
+int app_fifo_drain(app_fifo_drain_cb_t cb, app_fifo_commit_cb_t commit, size_t max)
+{
+    int err = 0;
+    int sent = 0;
+    bool open = false;
+    struct fs_file_t file;
+    char path[APP_FIFO_PATH_MAX];
+
+    k_mutex_lock(&fifo_lock, K_FOREVER);
+
+    if (!ready || meta.tail == meta.head)
+    {
+        err = ready ? 0 : -ENODEV;
+        goto unlock;
+    }
+
+    uint32_t head = meta.head;
+    uint32_t off = meta.head_off;
+
+    while (head != meta.tail && sent < max)
+    {
+        if (!open)
+        {
+            app_fifo_segment_path(path, head);
+            fs_file_t_init(&file);
+
+            err = fs_open(&file, path, FS_O_READ);
+            if (err == -ENOENT)
+            {
+                LOG_WRN("Segment of record %u is missing", head);
+                app_fifo_skip_segment(&head, &off);
+                err = 0;
+                continue;
+            }
+
+            if (err)
+                break;
+
+            open = true;
+
+            err = fs_seek(&file, off, FS_SEEK_SET);
+            if (err)
+                break;
+        }
+
+        /* Lengths can't be trusted past a bad record */
+        if (fs_read(&file, &rec_hdr, sizeof(rec_hdr)) != sizeof(rec_hdr) ||
+            rec_hdr.seq != head || APP_FIFO_LEN(&rec_hdr) > sizeof(rec_buf) ||
+            fs_read(&file, rec_buf, APP_FIFO_LEN(&rec_hdr)) != APP_FIFO_LEN(&rec_hdr) ||
+            rec_hdr.crc != app_fifo_hdr_crc(&rec_hdr, rec_buf))
+        {
+            LOG_WRN("Skipping the rest of the segment at corrupt record %u", head);
+            app_fifo_skip_segment(&head, &off);
+            fs_close(&file);
+            open = false;
+            continue;
+        }
+
+        rec_hdr.topic[APP_FIFO_TOPIC_MAX - 1] = '\0';
+
+        int rec_len = APP_FIFO_LEN(&rec_hdr);
+
+        if (rec_hdr.len & APP_FIFO_LEN_LZ)
+        {
+#ifdef CONFIG_APP_FIFO_COMPRESS
+            /* Can't decompress in place */
+            memcpy(packed, rec_buf, rec_len);
+            rec_len = lz_decompress(packed, rec_len, rec_buf, sizeof(rec_buf));
+#else
+            rec_len = -ENOTSUP;
+#endif
+        }
+
+        if (rec_len < 0)
+        {
+            /* Its length is fine, only this one goes */
+            LOG_WRN("Dropping record %u. Err: %i", head, rec_len);
+            stats.corrupt++;
+        }
+        else
+        {
+            err = cb(rec_hdr.topic, rec_buf, rec_len);
+            if (err)
+                break;
+
+            sent++;
+        }
+
+        head++;
+        off += sizeof(rec_hdr) + APP_FIFO_LEN(&rec_hdr);
+
+        if (head % APP_FIFO_SEGMENT_RECORDS == 0)
+        {
+            fs_close(&file);
+            open = false;
+            off = 0;
+        }
+    }
+
+    if (open)
+        fs_close(&file);
+
+    /* Whatever the callback held back has to go out before the records are dropped */
+    if (commit && sent > 0)
+    {
+        int commit_err = commit();
+        if (commit_err)
+        {
+            /* All of them go again */
+            head = meta.head;
+            off = meta.head_off;
+            sent = 0;
+            err = commit_err;
+        }
+    }
+
+    /* One metadata update for the batch */
+    if (head != meta.head)
+    {
+        struct app_fifo_meta prev = meta;
+
+        meta.head = head;
+        meta.head_off = off;
+
+        int meta_err = app_fifo_meta_write();
+        if (meta_err)
+        {
+            /* Records will be sent again */
+            meta = prev;
+            err = meta_err;
+        }
+        else
+        {
+            /* Segments that are done */
+            for (uint32_t seq = prev.head; app_fifo_segment(seq) < app_fifo_segment(head);
+                 seq = app_fifo_segment_end(seq))
+                app_fifo_segment_delete(seq);
+        }
+    }
+
+    stats.sent += sent;
+    stats.count = meta.tail - meta.head;
+
+unlock:
+    k_mutex_unlock(&fifo_lock);
+
+    if (err)
+        LOG_WRN("Drain stopped after %i records. Err: %i", sent, err);
+
+    return sent > 0 ? sent : err;
+}
+
+size_t app_fifo_count(void)
+{
+    k_mutex_lock(&fifo_lock, K_FOREVER);
+
+    size_t count = meta.tail - meta.head;
+
+    k_mutex_unlock(&fifo_lock);
+
+    return count;
+}
+
+void app_fifo_stats_get(struct app_fifo_stats *p_stats)
+{
+    k_mutex_lock(&fifo_lock, K_FOREVER);
+
+    *p_stats = stats;
+
+    k_mutex_unlock(&fifo_lock);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_FIFO_H
+#define _APP_FIFO_H
+
+#include <zephyr/kernel.h>
+
+/* Longest topic that can be stored (including terminator) */
+#define APP_FIFO_TOPIC_MAX 16
+
+/**
+ * @brief Called for every record while draining
+ *
+ * @param topic topic the record was published to
+ * @param p_data encoded record
+ * @param len length of the record
+ * @return int 0 if the record was sent. Anything else stops the drain and
+ * leaves the record in the queue.
+ */
+typedef int (*app_fifo_drain_cb_t)(char *topic, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Called once the callback has taken the records, before they're removed
+ *
+ * @return int 0 if everything the callback took was sent. Anything else leaves
+ * all of them in the queue.
+ */
+typedef int (*app_fifo_commit_cb_t)(void);
+
+struct app_fifo_stats
+{
+    uint32_t count;
+    uint32_t stored;
+    uint32_t sent;
+    uint32_t evicted;
+    uint32_t corrupt;
+};
+
+/**
+ * @brief Opens the queue and recovers head/tail. Requires /lfs to be mounted.
+ *
+ * @return int 0 on success
+ */
+int app_fifo_init(void);
+
+/**
+ * @brief Appends a record. Evicts the oldest segment when full.
+ *
+ * @param topic topic string used
+ * @param p_data encoded record
+ * @param len length of the record
+ * @return int 0 on success
+ */
+int app_fifo_put(char *topic, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Hands up to max records to the callback, oldest first.
+ * Sent records are removed in one metadata update at the end, once commit
+ * succeeds.
+ *
+ * @param cb called for every record
+ * @param commit called before sent records are removed (optional)
+ * @param max maximum number of records
+ * @return int number of records sent or negative error
+ */
+int app_fifo_drain(app_fifo_drain_cb_t cb, app_fifo_commit_cb_t commit, size_t max);
+
+/**
+ * @brief Number of queued records
+ *
+ * @return size_t record count
+ */
+size_t app_fifo_count(void);
+
+/**
+ * @brief Queue counters
+ *
+ * @param p_stats destination
+ */
+void app_fifo_stats_get(struct app_fifo_stats *p_stats);
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Counts every flash_area read, write and erase. The calls are redirected
+ * here at link time (see CMakeLists.txt) so littlefs and app_storage.c are
+ * counted without changes to either. NVS goes to the flash driver directly
+ * and isn't counted, which is why erase counts can be saved there.
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_flash_stats);
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+#include <zephyr/timing/timing.h>
+#endif
+
+#include <app_flash_stats.h>
+
+#ifdef CONFIG_APP_COUNTERS
+#include <app_counters.h>
+#endif
+
+int __real_flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len);
+int __real_flash_area_write(const struct flash_area *fa, off_t off, const void *src, size_t len);
+int __real_flash_area_erase(const struct flash_area *fa, off_t off, size_t len);
+
+#define APP_FLASH_STATS_SECTORS(label) \
+    (FLASH_AREA_SIZE(label) / CONFIG_APP_FLASH_STATS_SECTOR_SIZE)
+
+static uint16_t littlefs_erase_counts[APP_FLASH_STATS_SECTORS(littlefs_storage)];
+static struct flash_wear littlefs_wear;
+
+static struct
+{
+    const char *name;
+    uint8_t id;
+    uint16_t *p_erase_counts;
+    size_t sectors;
+    struct flash_wear *p_wear;
+} partitions[] = {
+    {
+        .name = "littlefs_storage",
+        .id = FLASH_AREA_ID(littlefs_storage),
+        .p_erase_counts = littlefs_erase_counts,
+        .sectors = ARRAY_SIZE(littlefs_erase_counts),
+        .p_wear = &littlefs_wear,
+    },
+};
+
+static int64_t last_uplink;
+
+/* Erases that aren't wear from use (the first boot format) */
+static atomic_t paused;
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+typedef timing_t app_flash_stats_ts_t;
+
+static inline timing_t app_flash_stats_now(void)
+{
+    return timing_counter_get();
+}
+
+static uint32_t app_flash_stats_us(timing_t start)
+{
+    timing_t end = timing_counter_get();
+
+    return timing_cycles_to_ns(timing_cycles_get(&start, &end)) / NSEC_PER_USEC;
+}
+#else
+/* The system timer. About 30 us steps on the 32 kHz RTC. */
+typedef uint32_t app_flash_stats_ts_t;
+
+static inline uint32_t app_flash_stats_now(void)
+{
+    return k_cycle_get_32();
+}
+
+static uint32_t app_flash_stats_us(uint32_t start)
+{
+    return k_cyc_to_us_floor32(k_cycle_get_32() - start);
+}
+#endif
+
+#ifdef CONFIG_APP_COUNTERS
+/* Sectors per saved value */
+#define APP_FLASH_STATS_CHUNK 128
+
+/* Time covered by the saved counts. Added to the uptime. */
+static int64_t elapsed_base;
+static bool loaded;
+
+static void app_flash_stats_save_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(save_work, app_flash_stats_save_fn);
+
+static uint16_t app_flash_stats_chunk_id(size_t first)
+{
+    return APP_VALUE_FLASH_ERASES + first / APP_FLASH_STATS_CHUNK;
+}
+
+static int app_flash_stats_load(void)
+{
+    static uint16_t counts[APP_FLASH_STATS_CHUNK];
+
+    ssize_t len = app_counters_value_read(APP_VALUE_FLASH_ELAPSED, &elapsed_base,
+                                          sizeof(elapsed_base));
+    if (len == -ENOENT)
+    {
+        /* First boot with saving. Counting starts now. */
+        elapsed_base = 0;
+        return 0;
+    }
+
+    if (len != sizeof(elapsed_base))
+        return len < 0 ? len : -EINVAL;
+
+    for (size_t first = 0; first < littlefs_wear.sectors; first += APP_FLASH_STATS_CHUNK)
+    {
+        len = app_counters_value_read(app_flash_stats_chunk_id(first), counts, sizeof(counts));
+        if (len == -ENOENT)
+            continue;
+
+        if (len < 0)
+            return len;
+
+        flash_wear_erase_counts_add(&littlefs_wear, first, counts, len / sizeof(counts[0]));
+    }
+
+    LOG_INF("Restored erase counts covering %lld h", elapsed_base / (3600 * MSEC_PER_SEC));
+
+    return 0;
+}
+
+static int app_flash_stats_save(void)
+{
+    static uint16_t counts[APP_FLASH_STATS_CHUNK];
+    int err;
+
+    for (size_t first = 0; first < littlefs_wear.sectors; first += APP_FLASH_STATS_CHUNK)
+    {
+        size_t count = flash_wear_erase_counts_get(&littlefs_wear, first, counts,
+                                                   ARRAY_SIZE(counts));
+
+        /* Unchanged chunks aren't written */
+        err = app_counters_value_write(app_flash_stats_chunk_id(first), counts,
+                                       count * sizeof(counts[0]));
+        if (err)
+            return err;
+    }
+
+    int64_t elapsed = elapsed_base + k_uptime_get();
+
+    return app_counters_value_write(APP_VALUE_FLASH_ELAPSED, &elapsed, sizeof(elapsed));
+}
+
+static void app_flash_stats_save_fn(struct k_work *work)
+{
+    int err;
+
+    /* Counters are up by now. Saved counts add to the ones since boot. */
+    if (!loaded)
+    {
+        err = app_flash_stats_load();
+        if (err)
+            LOG_WRN("Unable to restore erase counts. Err: %i", err);
+        else
+            loaded = true;
+    }
+    else
+    {
+        err = app_flash_stats_save();
+        if (err)
+            LOG_WRN("Unable to save erase counts. Err: %i", err);
+    }
+
+    k_work_reschedule(&save_work, K_MINUTES(CONFIG_APP_FLASH_STATS_SAVE_INTERVAL));
+}
+#endif
+
+static struct flash_wear *app_flash_stats_find(const struct flash_area *fa)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(partitions); i++)
+    {
+        if (partitions[i].id == fa->fa_id)
+            return partitions[i].p_wear;
+    }
+
+    return NULL;
+}
+
+static void app_flash_stats_record(const struct flash_area *fa, enum flash_wear_op op, off_t off,
+                                   size_t len, app_flash_stats_ts_t start, int err)
+{
+    struct flash_wear *p_wear = app_flash_stats_find(fa);
+
+    if (p_wear && !atomic_get(&paused))
+        flash_wear_record(p_wear, op, off, len, app_flash_stats_us(start), err);
+}
+
+int __wrap_flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len)
+{
+    app_flash_stats_ts_t start = app_flash_stats_now();
+    int err = __real_flash_area_read(fa, off, dst, len);
+
+    app_flash_stats_record(fa, FLASH_WEAR_READ, off, len, start, err);
+
+    return err;
+}
+
+int __wrap_flash_area_write(const struct flash_area *fa, off_t off, const void *src, size_t len)
+{
+    app_flash_stats_ts_t start = app_flash_stats_now();
+    int err = __real_flash_area_write(fa, off, src, len);
+
+    app_flash_stats_record(fa, FLASH_WEAR_PROGRAM, off, len, start, err);
+
+    return err;
+}
+
+int __wrap_flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+    app_flash_stats_ts_t start = app_flash_stats_now();
+    int err = __real_flash_area_erase(fa, off, len);
+
+    app_flash_stats_record(fa, FLASH_WEAR_ERASE, off, len, start, err);
+
+    return err;
+}
+
+int app_flash_stats_count(void)
+{
+    return ARRAY_SIZE(partitions);
+}
+
+int app_flash_stats_get(int idx, struct app_flash_stats *p_stats)
+{
+    if (idx < 0 || idx >= (int)ARRAY_SIZE(partitions))
+        return -EINVAL;
+
+    p_stats->name = partitions[idx].name;
+    p_stats->p_wear = partitions[idx].p_wear;
+
+    flash_wear_summary_get(p_stats->p_wear, &p_stats->summary);
+
+    int64_t elapsed = k_uptime_get();
+
+#ifdef CONFIG_APP_COUNTERS
+    /* Including the saved counts */
+    if (loaded)
+        elapsed += elapsed_base;
+#endif
+
+    p_stats->endurance_days = flash_wear_endurance_days(&p_stats->summary,
+                                                        CONFIG_APP_FLASH_STATS_RATED_CYCLES,
+                                                        elapsed);
+
+    return 0;
+}
+
+void app_flash_stats_pause(bool pause)
+{
+    atomic_set(&paused, pause);
+}
+
+bool app_flash_stats_uplink_due(void)
+{
+    int64_t now = k_uptime_get();
+
+    if (CONFIG_APP_FLASH_STATS_UPLINK_INTERVAL == 0)
+        return false;
+
+    if (now - last_uplink < (int64_t)CONFIG_APP_FLASH_STATS_UPLINK_INTERVAL * 3600 * MSEC_PER_SEC)
+        return false;
+
+    last_uplink = now;
+
+    return true;
+}
+
+static int app_flash_stats_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(partitions); i++)
+        flash_wear_init(partitions[i].p_wear, partitions[i].p_erase_counts,
+                        partitions[i].sectors, CONFIG_APP_FLASH_STATS_SECTOR_SIZE);
+
+#ifdef CONFIG_TIMING_FUNCTIONS
+    timing_init();
+    timing_start();
+#endif
+
+    return 0;
+}
+
+/* Before anything touches flash */
+SYS_INIT(app_flash_stats_init, PRE_KERNEL_1, 0);
+
+#ifdef CONFIG_APP_COUNTERS
+/* After app_counters_init_fn(). The work queue would otherwise run the restore
+ * right away, before the counters are loaded. SYS_INIT() needs a literal. */
+#define APP_FLASH_STATS_RESTORE_PRIORITY 91
+
+BUILD_ASSERT(APP_FLASH_STATS_RESTORE_PRIORITY > CONFIG_APPLICATION_INIT_PRIORITY,
+             "Flash stats have to be restored after the counters");
+
+static int app_flash_stats_restore_init(void)
+{
+    /* Restored from the work queue */
+    k_work_schedule(&save_work, K_NO_WAIT);
+
+    return 0;
+}
+
+SYS_INIT(app_flash_stats_restore_init, APPLICATION, APP_FLASH_STATS_RESTORE_PRIORITY);
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_FLASH_STATS_H
+#define _APP_FLASH_STATS_H
+
+#include <lib/flash_wear/flash_wear.h>
+
+/**
+ * @brief Counters of one partition
+ *
+ */
+struct app_flash_stats
+{
+    const char *name;
+    struct flash_wear *p_wear;
+    struct flash_wear_summary summary;
+
+    /* Projected days left for the most worn sector */
+    uint32_t endurance_days;
+};
+
+/**
+ * @brief Number of partitions that are counted
+ *
+ * @return int partition count
+ */
+int app_flash_stats_count(void);
+
+/**
+ * @brief Counters and wear summary of a partition
+ *
+ * @param idx partition index
+ * @param p_stats filled on success
+ * @return int 0 on success. -EINVAL if there's no such partition.
+ */
+int app_flash_stats_get(int idx, struct app_flash_stats *p_stats);
+
+/**
+ * @brief Stops counting while the partition is formatted. Those erases
+ * aren't wear from use.
+ *
+ * @param pause true to stop, false to count again
+ */
+void app_flash_stats_pause(bool pause);
+
+/**
+ * @brief Whether CONFIG_APP_FLASH_STATS_UPLINK_INTERVAL has passed since the
+ * last diagnostics record. Clears the condition when it returns true.
+ *
+ * @return true if a record should be sent
+ */
+bool app_flash_stats_uplink_due(void);
+
+#endif
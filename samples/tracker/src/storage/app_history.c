@@ -0,0 +1,408 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_history);
+
+#include <app_history.h>
+
+#define APP_HISTORY_DIR "/lfs/history"
+
+/* Largest encoded record */
+#define APP_HISTORY_RECORD_MAX 256
+
+static struct ts_store store;
+static bool ready;
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+static uint8_t history_page[CONFIG_APP_STORAGE_WRITE_BUFFER_SIZE];
+static struct write_buffer history_wb;
+static atomic_t write_through;
+#endif
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+/* Chunks are a format byte and the buffer's framed records. Anything else
+ * is a single record written before compression was turned on. */
+#define APP_HISTORY_CHUNK_RAW 0x00
+#define APP_HISTORY_CHUNK_LZ 0x01
+
+/* Oldest record in a chunk is at most this much newer than the chunk */
+#define APP_HISTORY_CHUNK_SPAN \
+    ((CONFIG_APP_STORAGE_WRITE_BUFFER_MAX_AGE + CONFIG_APP_STORAGE_WRITE_BUFFER_CHECK_INTERVAL) * MSEC_PER_SEC)
+
+static struct lz_ctx lz;
+static uint8_t chunk[TS_STORE_RECORD_MAX];
+static uint8_t unpacked[CONFIG_APP_STORAGE_WRITE_BUFFER_SIZE];
+static struct app_history_compress_stats compress_stats;
+
+struct app_history_query_ctx
+{
+    int64_t from;
+    int64_t to;
+    ts_store_cb_t cb;
+    void *p_user;
+    int count;
+};
+#endif
+
+static const struct ts_store_config config = {
+    .p_dir = APP_HISTORY_DIR,
+    .segment_blocks = CONFIG_APP_HISTORY_SEGMENT_BLOCKS,
+    .max_segments = CONFIG_APP_HISTORY_MAX_SEGMENTS,
+};
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+/* Writing these again won't help. A timestamp older than the last record or
+ * a record that's too big. */
+static bool app_history_rejected(int err)
+{
+    return err == -EINVAL || err == -EMSGSIZE;
+}
+
+/* Appended records are in the file even if the commit fails. They're not
+ * written again. */
+static int app_history_sync(int count, int err)
+{
+    if (count)
+    {
+        int sync_err = ts_store_sync(&store);
+        if (sync_err)
+        {
+            LOG_ERR("Unable to commit history. Err: %i", sync_err);
+            return err ? err : sync_err;
+        }
+    }
+
+    if (err)
+        LOG_ERR("Unable to store history. Err: %i", err);
+
+    return err;
+}
+#endif
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+/* Last record boundary before end */
+static size_t app_history_boundary(const uint8_t *p_data, size_t pos, size_t end)
+{
+    size_t last = pos;
+    const uint8_t *p_rec;
+    size_t rec_len;
+
+    while (write_buffer_next(p_data, end, &pos, &p_rec, &rec_len) == 0 && pos < end)
+        last = pos;
+
+    return last;
+}
+
+/* Stores records from pos as one chunk. Returns where the chunk ended. */
+static int app_history_put_chunk(const uint8_t *p_data, size_t pos, size_t len, size_t *p_end)
+{
+    int packed;
+    int64_t ts;
+    size_t end = len;
+
+    for (;;)
+    {
+        uint32_t cycles = k_cycle_get_32();
+        packed = lz_compress(&lz, &p_data[pos], end - pos, &chunk[1], sizeof(chunk) - 1);
+        compress_stats.compress_cycles += k_cycle_get_32() - cycles;
+
+        if (packed >= 0 && (size_t)packed < end - pos)
+        {
+            chunk[0] = APP_HISTORY_CHUNK_LZ;
+            break;
+        }
+
+        /* Didn't shrink. Store as is if it fits. */
+        if (end - pos < sizeof(chunk))
+        {
+            chunk[0] = APP_HISTORY_CHUNK_RAW;
+            memcpy(&chunk[1], &p_data[pos], end - pos);
+            packed = end - pos;
+            break;
+        }
+
+        /* Too big either way. One record less. */
+        end = app_history_boundary(p_data, pos, end);
+    }
+
+    /* The chunk goes under its first record's timestamp */
+    memcpy(&ts, &p_data[pos + sizeof(uint16_t)], sizeof(ts));
+
+    /* Set on failure too. The caller decides whether it's tried again. */
+    *p_end = end;
+
+    int err = ts_store_append(&store, ts, chunk, packed + 1);
+    if (err)
+        return err;
+
+    compress_stats.raw_bytes += end - pos;
+    compress_stats.stored_bytes += packed + 1;
+    compress_stats.chunks++;
+
+    return 0;
+}
+
+static int app_history_flush_cb(const uint8_t *p_data, size_t len, size_t *p_done, void *p_user)
+{
+    int err = 0;
+    int count = 0;
+    size_t pos = 0;
+
+    while (pos < len)
+    {
+        size_t end;
+
+        err = app_history_put_chunk(p_data, pos, len, &end);
+        if (app_history_rejected(err))
+        {
+            LOG_WRN("Dropped history chunk. Err: %i", err);
+            err = 0;
+        }
+        else if (err)
+        {
+            break;
+        }
+        else
+        {
+            count++;
+        }
+
+        pos = end;
+        *p_done = pos;
+    }
+
+    /* One commit for the whole page */
+    return app_history_sync(count, err);
+}
+
+static int app_history_query_cb(int64_t ts, const uint8_t *p_data, size_t len, void *p_user)
+{
+    struct app_history_query_ctx *p_ctx = p_user;
+    const uint8_t *p_recs = &p_data[1];
+    int recs_len = len - 1;
+    size_t pos = 0;
+    const uint8_t *p_rec;
+    size_t rec_len;
+
+    /* Written before compression was turned on */
+    if (len == 0 || p_data[0] > APP_HISTORY_CHUNK_LZ)
+    {
+        if (ts < p_ctx->from)
+            return 0;
+
+        p_ctx->count++;
+        return p_ctx->cb(ts, p_data, len, p_ctx->p_user);
+    }
+
+    if (p_data[0] == APP_HISTORY_CHUNK_LZ)
+    {
+        uint32_t cycles = k_cycle_get_32();
+        recs_len = lz_decompress(&p_data[1], len - 1, unpacked, sizeof(unpacked));
+        compress_stats.decompress_cycles += k_cycle_get_32() - cycles;
+
+        if (recs_len < 0)
+        {
+            LOG_WRN("Corrupt history chunk at %lld. Err: %i", ts, recs_len);
+            return 0;
+        }
+
+        p_recs = unpacked;
+    }
+
+    while (write_buffer_next(p_recs, recs_len, &pos, &p_rec, &rec_len) == 0)
+    {
+        memcpy(&ts, p_rec, sizeof(ts));
+
+        if (ts < p_ctx->from)
+            continue;
+
+        /* Past the range */
+        if (ts > p_ctx->to)
+            return 1;
+
+        p_ctx->count++;
+
+        int err = p_ctx->cb(ts, p_rec + sizeof(ts), rec_len - sizeof(ts), p_ctx->p_user);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+#elif defined(CONFIG_APP_STORAGE_WRITE_BUFFER)
+static int app_history_flush_cb(const uint8_t *p_data, size_t len, size_t *p_done, void *p_user)
+{
+    int err = 0;
+    int count = 0;
+    size_t pos = 0;
+    const uint8_t *p_rec;
+    size_t rec_len;
+    int64_t ts;
+
+    /* Records are the timestamp followed by the encoded data */
+    while (write_buffer_next(p_data, len, &pos, &p_rec, &rec_len) == 0)
+    {
+        memcpy(&ts, p_rec, sizeof(ts));
+
+        err = ts_store_append(&store, ts, p_rec + sizeof(ts), rec_len - sizeof(ts));
+        if (app_history_rejected(err))
+        {
+            LOG_WRN("Dropped history record at %lld. Err: %i", ts, err);
+            err = 0;
+        }
+        else if (err)
+        {
+            break;
+        }
+        else
+        {
+            count++;
+        }
+
+        *p_done = pos;
+    }
+
+    /* One commit for the whole page */
+    return app_history_sync(count, err);
+}
+#endif
+
+int app_history_init(void)
+{
+    int err;
+
+    err = fs_mkdir(APP_HISTORY_DIR);
+    if (err && err != -EEXIST)
+    {
+        LOG_ERR("Unable to create %s. Err: %i", APP_HISTORY_DIR, err);
+        return err;
+    }
+
+    err = ts_store_init(&store, &config);
+    if (err)
+        return err;
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+    write_buffer_init(&history_wb, history_page, sizeof(history_page),
+                      CONFIG_APP_STORAGE_WRITE_BUFFER_MAX_AGE * MSEC_PER_SEC,
+                      app_history_flush_cb, NULL);
+#endif
+
+    ready = true;
+
+    return 0;
+}
+
+int app_history_put(int64_t ts, uint8_t *p_data, size_t len)
+{
+    int err;
+
+    if (!ready)
+        return -ENODEV;
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+    uint8_t rec[sizeof(ts) + APP_HISTORY_RECORD_MAX];
+
+    if (len > APP_HISTORY_RECORD_MAX)
+        return -EMSGSIZE;
+
+    memcpy(rec, &ts, sizeof(ts));
+    memcpy(&rec[sizeof(ts)], p_data, len);
+
+    err = write_buffer_put(&history_wb, rec, sizeof(ts) + len, k_uptime_get());
+    if (err || !atomic_get(&write_through))
+        return err;
+
+    /* Low battery. Goes through the buffer so it's serialized with the flush work. */
+    return write_buffer_flush(&history_wb, WRITE_BUFFER_FLUSH_BATTERY);
+#else
+    err = ts_store_append(&store, ts, p_data, len);
+    if (err)
+        return err;
+
+    /* Fixes are minutes apart. Commit each one. */
+    return ts_store_sync(&store);
+#endif
+}
+
+int app_history_query(int64_t from, int64_t to, ts_store_cb_t cb, void *p_user)
+{
+    if (!ready)
+        return -ENODEV;
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+    /* Buffered records are part of the answer */
+    app_history_flush(WRITE_BUFFER_FLUSH_READ);
+#endif
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+    struct app_history_query_ctx ctx = {
+        .from = from,
+        .to = to,
+        .cb = cb,
+        .p_user = p_user,
+    };
+
+    /* A chunk is filed under its first record. Start early enough to catch
+     * chunks that run into the range. */
+    int err = ts_store_query(&store, from - APP_HISTORY_CHUNK_SPAN, to, app_history_query_cb, &ctx);
+
+    return err < 0 ? err : ctx.count;
+#else
+    return ts_store_query(&store, from, to, cb, p_user);
+#endif
+}
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+int app_history_flush(enum write_buffer_reason reason)
+{
+    if (!ready)
+        return -ENODEV;
+
+    return write_buffer_flush(&history_wb, reason);
+}
+
+int app_history_poll(void)
+{
+    if (!ready)
+        return -ENODEV;
+
+    return write_buffer_poll(&history_wb, k_uptime_get());
+}
+
+void app_history_write_through(bool enable)
+{
+    atomic_set(&write_through, enable);
+}
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+int app_history_compress_stats(struct app_history_compress_stats *p_stats)
+{
+    if (!ready)
+        return -ENODEV;
+
+    *p_stats = compress_stats;
+
+    return 0;
+}
+#endif
+
+int app_history_buffer_stats(struct write_buffer_stats *p_stats)
+{
+    if (!ready)
+        return -ENODEV;
+
+    write_buffer_stats_get(&history_wb, p_stats);
+
+    return 0;
+}
+#endif
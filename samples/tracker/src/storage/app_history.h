@@ -0,0 +1,105 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_HISTORY_H
+#define _APP_HISTORY_H
+
+#include <zephyr/kernel.h>
+
+#include <lib/ts_store/ts_store.h>
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+#include <lib/write_buffer/write_buffer.h>
+#endif
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+#include <lib/lz/lz.h>
+
+/**
+ * @brief Compression counters
+ *
+ */
+struct app_history_compress_stats
+{
+    uint32_t chunks;
+    uint32_t raw_bytes;
+    uint32_t stored_bytes;
+    uint64_t compress_cycles;
+    uint64_t decompress_cycles;
+};
+#endif
+
+/**
+ * @brief Opens the history store. Requires /lfs to be mounted.
+ *
+ * @return int 0 on success
+ */
+int app_history_init(void);
+
+/**
+ * @brief Stores an encoded record
+ *
+ * @param ts timestamp in ms
+ * @param p_data encoded record
+ * @param len length of the record
+ * @return int 0 on success
+ */
+int app_history_put(int64_t ts, uint8_t *p_data, size_t len);
+
+/**
+ * @brief Calls cb for every record between from and to (in ms)
+ *
+ * @param from start of the range
+ * @param to end of the range
+ * @param cb called for every record
+ * @param p_user passed to cb
+ * @return int number of records or negative error
+ */
+int app_history_query(int64_t from, int64_t to, ts_store_cb_t cb, void *p_user);
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+/**
+ * @brief Writes buffered records to flash
+ *
+ * @param reason why, for the counters
+ * @return int 0 on success
+ */
+int app_history_flush(enum write_buffer_reason reason);
+
+/**
+ * @brief Flushes if the oldest buffered record is too old
+ *
+ * @return int 0 on success
+ */
+int app_history_poll(void);
+
+/**
+ * @brief Writes every record to flash as it arrives
+ *
+ * @param enable true to flush after every record
+ */
+void app_history_write_through(bool enable);
+
+/**
+ * @brief Buffer counters
+ *
+ * @param p_stats destination
+ * @return int 0 on success
+ */
+int app_history_buffer_stats(struct write_buffer_stats *p_stats);
+#endif
+
+#ifdef CONFIG_APP_HISTORY_COMPRESS
+/**
+ * @brief Compression ratio and CPU time
+ *
+ * @param p_stats destination
+ * @return int 0 on success
+ */
+int app_history_compress_stats(struct app_history_compress_stats *p_stats);
+#endif
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_state);
+
+/* Nordic deps */
+#include <date_time.h>
+#include <modem/modem_info.h>
+
+#include <app_motion.h>
+#include <app_state.h>
+#include <app_storage.h>
+
+/* Parent of CONFIG_SETTINGS_FILE_PATH. The file backend doesn't create it. */
+#define APP_STATE_DIR "/lfs/settings"
+
+/* Resets the device stayed powered through. Power on and brown out aren't. */
+#define APP_STATE_WARM_RESETS (RESET_PIN | RESET_SOFTWARE | RESET_WATCHDOG | RESET_CPU_LOCKUP)
+#define APP_STATE_COLD_RESETS (RESET_POR | RESET_BROWNOUT)
+
+/* Which items are held */
+enum app_state_item
+{
+    APP_STATE_BOOT,
+    APP_STATE_GNSS,
+    APP_STATE_MOTION,
+    APP_STATE_ITEMS,
+};
+
+static const char *const app_state_keys[APP_STATE_ITEMS] = {
+    [APP_STATE_BOOT] = "state/boot",
+    [APP_STATE_GNSS] = "state/gnss",
+    [APP_STATE_MOTION] = "state/motion",
+};
+
+/* Last boot report */
+struct app_state_boot
+{
+    /* Firmware the report described */
+    uint32_t fingerprint;
+
+    /* When it went out (ms since epoch) */
+    int64_t ts;
+};
+
+static struct
+{
+    struct app_state_boot boot;
+    struct app_state_gnss gnss;
+    struct app_motion_config motion;
+} m_state;
+
+/* Bit per item */
+static atomic_t m_valid;
+static atomic_t m_dirty;
+
+/* Set by app_state_init() */
+static bool m_warm_reset;
+
+static K_MUTEX_DEFINE(m_lock);
+
+static void app_state_save_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(app_state_save_work, app_state_save_fn);
+
+static const void *app_state_item(enum app_state_item item, size_t *p_len)
+{
+    switch (item)
+    {
+    case APP_STATE_BOOT:
+        *p_len = sizeof(m_state.boot);
+        return &m_state.boot;
+    case APP_STATE_GNSS:
+        *p_len = sizeof(m_state.gnss);
+        return &m_state.gnss;
+    case APP_STATE_MOTION:
+        *p_len = sizeof(m_state.motion);
+        return &m_state.motion;
+    default:
+        *p_len = 0;
+        return NULL;
+    }
+}
+
+static int app_state_save(enum app_state_item item)
+{
+    size_t len;
+    const void *p_value = app_state_item(item, &len);
+
+    int err = settings_save_one(app_state_keys[item], p_value, len);
+    if (err)
+    {
+        LOG_ERR("Unable to save %s. Err: %i", app_state_keys[item], err);
+        return err;
+    }
+
+    atomic_clear_bit(&m_dirty, item);
+
+    return 0;
+}
+
+int app_state_flush(void)
+{
+    int ret = 0;
+
+    k_mutex_lock(&m_lock, K_FOREVER);
+
+    for (int i = 0; i < APP_STATE_ITEMS; i++)
+    {
+        if (!atomic_test_bit(&m_dirty, i))
+            continue;
+
+        int err = app_state_save(i);
+        if (err)
+            ret = err;
+    }
+
+    k_mutex_unlock(&m_lock);
+
+    return ret;
+}
+
+static void app_state_save_fn(struct k_work *work)
+{
+    app_state_flush();
+}
+
+/* Changes are held in RAM and written together after a delay */
+static void app_state_mark(enum app_state_item item)
+{
+    atomic_set_bit(&m_valid, item);
+    atomic_set_bit(&m_dirty, item);
+
+    app_storage_schedule(&app_state_save_work, K_SECONDS(CONFIG_APP_STATE_SAVE_DELAY));
+}
+
+static uint32_t app_state_fingerprint(void)
+{
+    char fw[MODEM_INFO_MAX_RESPONSE_SIZE] = {0};
+
+    /* A modem firmware update needs a new report too */
+    int err = modem_info_string_get(MODEM_INFO_FW_VERSION, fw, sizeof(fw));
+    if (err < 0)
+        LOG_WRN("Unable to get modem firmware version. Err: %i", err);
+
+    uint32_t crc = crc32_ieee((const uint8_t *)CONFIG_APP_VERSION, strlen(CONFIG_APP_VERSION));
+
+    return crc32_ieee_update(crc, (const uint8_t *)fw, strlen(fw));
+}
+
+bool app_state_boot_report_needed(void)
+{
+    int64_t now;
+
+    /* Storage (and with it the state) may still be coming up. Called from the
+     * event loop, so don't wait out a first time erase. Reporting is the safe side. */
+    if (app_storage_wait_ready(K_MSEC(100)) != 0)
+        return true;
+
+    if (!m_warm_reset)
+        return true;
+
+    if (!atomic_test_bit(&m_valid, APP_STATE_BOOT))
+        return true;
+
+    if (m_state.boot.fingerprint != app_state_fingerprint())
+        return true;
+
+    if (date_time_now(&now) ||
+        now - m_state.boot.ts > (int64_t)CONFIG_APP_STATE_BOOT_REPORT_INTERVAL * 3600 * MSEC_PER_SEC)
+        return true;
+
+    return false;
+}
+
+void app_state_boot_reported(void)
+{
+    k_mutex_lock(&m_lock, K_FOREVER);
+
+    m_state.boot.fingerprint = app_state_fingerprint();
+    if (date_time_now(&m_state.boot.ts))
+        m_state.boot.ts = 0;
+
+    atomic_set_bit(&m_valid, APP_STATE_BOOT);
+    atomic_set_bit(&m_dirty, APP_STATE_BOOT);
+
+    /* Once per boot. Don't leave a window where a reset re-reports. */
+    app_state_save(APP_STATE_BOOT);
+
+    k_mutex_unlock(&m_lock);
+}
+
+int app_state_gnss_get(struct app_state_gnss *p_gnss)
+{
+    if (!atomic_test_bit(&m_valid, APP_STATE_GNSS))
+        return -ENODATA;
+
+    k_mutex_lock(&m_lock, K_FOREVER);
+    *p_gnss = m_state.gnss;
+    k_mutex_unlock(&m_lock);
+
+    return 0;
+}
+
+void app_state_gnss_set(const struct app_state_gnss *p_gnss)
+{
+    k_mutex_lock(&m_lock, K_FOREVER);
+    m_state.gnss = *p_gnss;
+    app_state_mark(APP_STATE_GNSS);
+    k_mutex_unlock(&m_lock);
+}
+
+void app_state_motion_set(const struct app_motion_config *p_config)
+{
+    k_mutex_lock(&m_lock, K_FOREVER);
+
+    /* Restoring writes back the same value */
+    if (!atomic_test_bit(&m_valid, APP_STATE_MOTION) ||
+        memcmp(&m_state.motion, p_config, sizeof(*p_config)) != 0)
+    {
+        m_state.motion = *p_config;
+        app_state_mark(APP_STATE_MOTION);
+    }
+
+    k_mutex_unlock(&m_lock);
+}
+
+static int app_state_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    for (int i = 0; i < APP_STATE_ITEMS; i++)
+    {
+        /* Skip the "state/" prefix */
+        if (strcmp(name, app_state_keys[i] + sizeof("state/") - 1) != 0)
+            continue;
+
+        size_t size;
+        void *p_value = (void *)app_state_item(i, &size);
+
+        /* Layout changed between firmware versions. Start over. */
+        if (len != size)
+        {
+            LOG_WRN("Ignoring %s. Size %u, expected %u", app_state_keys[i], len, size);
+            return 0;
+        }
+
+        int ret = read_cb(cb_arg, p_value, size);
+        if (ret < 0)
+            return ret;
+
+        atomic_set_bit(&m_valid, i);
+
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+static int app_state_commit(void)
+{
+    if (atomic_test_bit(&m_valid, APP_STATE_MOTION))
+        app_motion_config_set(&m_state.motion);
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(app_state, "state", NULL, app_state_set, app_state_commit, NULL);
+
+static void app_state_reset_cause(void)
+{
+    uint32_t cause = 0;
+
+    int err = hwinfo_get_reset_cause(&cause);
+    if (err)
+        LOG_WRN("Unable to get reset cause. Err: %i", err);
+
+    /* Accumulates over resets on some SoCs */
+    hwinfo_clear_reset_cause();
+
+    m_warm_reset = (cause & APP_STATE_WARM_RESETS) && !(cause & APP_STATE_COLD_RESETS);
+
+    LOG_INF("Reset cause: 0x%x (%s)", cause, m_warm_reset ? "warm" : "cold");
+}
+
+int app_state_init(void)
+{
+    int err;
+    struct fs_dirent dirent;
+
+    app_state_reset_cause();
+
+    if (fs_stat(APP_STATE_DIR, &dirent))
+    {
+        err = fs_mkdir(APP_STATE_DIR);
+        if (err)
+            return err;
+    }
+
+    err = settings_subsys_init();
+    if (err)
+        return err;
+
+    int64_t start = k_uptime_get();
+
+    /* Everything in one pass */
+    err = settings_load_subtree("state");
+    if (err)
+        return err;
+
+    LOG_INF("State restored in %lld ms (items: 0x%x)", k_uptime_get() - start,
+            (unsigned int)atomic_get(&m_valid));
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_STATE_H
+#define _APP_STATE_H
+
+#include <zephyr/kernel.h>
+
+#include <app_motion.h>
+
+/**
+ * @brief Last known position. Seeds the first GNSS search after a reset.
+ *
+ */
+struct app_state_gnss
+{
+    /* Time of the fix (ms since epoch) */
+    int64_t ts;
+    double latitude;
+    double longitude;
+    float altitude;
+
+    /* Accuracy in meters */
+    float accuracy;
+};
+
+/**
+ * @brief Loads everything under "state/" in one pass. Called by storage once
+ * /lfs is mounted.
+ *
+ * @return int 0 on success
+ */
+int app_state_init(void);
+
+/**
+ * @brief Whether a boot report is needed. Not after a warm reset (pin,
+ * software, watchdog or lockup) on the same firmware, unless the last one is
+ * older than CONFIG_APP_STATE_BOOT_REPORT_INTERVAL. Power on and brown out
+ * resets always report.
+ *
+ * @return true send the boot report
+ */
+bool app_state_boot_report_needed(void);
+
+/**
+ * @brief Records that the boot report went out. Saved right away.
+ *
+ */
+void app_state_boot_reported(void);
+
+/**
+ * @brief Last position from this boot or the one before
+ *
+ * @param p_gnss filled on success
+ * @return int 0 on success. -ENODATA if there isn't one.
+ */
+int app_state_gnss_get(struct app_state_gnss *p_gnss);
+
+/**
+ * @brief Updates the last position. Written back lazily.
+ *
+ * @param p_gnss the position
+ */
+void app_state_gnss_set(const struct app_state_gnss *p_gnss);
+
+/**
+ * @brief Updates the motion config. Written back lazily.
+ *
+ * @param p_config the config
+ */
+void app_state_motion_set(const struct app_motion_config *p_config);
+
+/**
+ * @brief Writes out anything that changed. Call before a reboot.
+ *
+ * @return int 0 on success
+ */
+int app_state_flush(void);
+
+#endif
@@ -8,12 +8,32 @@
 #include <zephyr/init.h>
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
 #include <zephyr/fs/fs.h>
 #include <zephyr/fs/littlefs.h>
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(nor_storage);
 
+#include <app_fifo.h>
+#include <app_storage.h>
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+#include <app_battery.h>
+#endif
+
+#ifdef CONFIG_APP_HISTORY
+#include <app_history.h>
+#endif
+
+#ifdef CONFIG_APP_STATE
+#include <app_state.h>
+#endif
+
+#ifdef CONFIG_APP_FLASH_STATS
+#include <app_flash_stats.h>
+#endif
+
 /* Used to determine if FS is in good state */
 #define NOR_STORAGE_ERASED_ON_BOOT "/lfs/erased"
 
@@ -28,12 +48,94 @@ static struct fs_mount_t lfs_storage_mnt = {
     .mnt_point = "/lfs",
 };
 
+#define NOR_STORAGE_STACK_SIZE 2048
+
+/* Storage work runs here so a long erase doesn't hold up the system work queue */
+static K_THREAD_STACK_DEFINE(nor_storage_stack, NOR_STORAGE_STACK_SIZE);
+static struct k_work_q nor_storage_work_q;
+
+static void nor_storage_init_work_fn(struct k_work *work);
+static K_WORK_DEFINE(nor_storage_init_work, nor_storage_init_work_fn);
+
+/* Ready signal */
+static K_SEM_DEFINE(storage_ready_sem, 0, 1);
+static atomic_t storage_ready;
+static int storage_err;
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+static void nor_storage_check_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(nor_storage_check_work, nor_storage_check_fn);
+
+static void nor_storage_check_fn(struct k_work *work)
+{
+    int err;
+    static bool low_battery;
+
+    /* Battery level */
+    app_battery_measure_enable(true);
+    int sample = app_battery_sample();
+    app_battery_measure_enable(false);
+
+    /* A brown out would lose whatever is buffered. Write through until the battery recovers. */
+    if (sample > 0 && sample < CONFIG_APP_STORAGE_WRITE_BUFFER_BATTERY_MV && !low_battery)
+    {
+        LOG_WRN("Low battery (%i mV). Writing through.", sample);
+
+        err = app_history_flush(WRITE_BUFFER_FLUSH_BATTERY);
+        if (err)
+            LOG_ERR("Unable to flush history. Err: %i", err);
+
+        app_history_write_through(true);
+        low_battery = true;
+    }
+    else if (sample >= CONFIG_APP_STORAGE_WRITE_BUFFER_BATTERY_MV && low_battery)
+    {
+        app_history_write_through(false);
+        low_battery = false;
+    }
+
+    /* Age */
+    err = app_history_poll();
+    if (err)
+        LOG_ERR("Unable to flush history. Err: %i", err);
+
+    k_work_schedule_for_queue(&nor_storage_work_q, &nor_storage_check_work,
+                              K_SECONDS(CONFIG_APP_STORAGE_WRITE_BUFFER_CHECK_INTERVAL));
+}
+#endif
+
+int app_storage_flush(void)
+{
+    int err = 0;
+
+#ifdef CONFIG_APP_STATE
+    err = app_state_flush();
+#endif
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+    int history_err = app_history_flush(WRITE_BUFFER_FLUSH_RESET);
+    if (history_err)
+        err = history_err;
+#endif
+
+    return err;
+}
+
+int app_storage_schedule(struct k_work_delayable *p_work, k_timeout_t delay)
+{
+    return k_work_schedule_for_queue(&nor_storage_work_q, p_work, delay);
+}
+
 static int nor_storage_erase(void)
 {
     int err;
     struct fs_mount_t *mp = &lfs_storage_mnt;
     unsigned int id = (uintptr_t)mp->storage_dev;
     const struct flash_area *pfa;
+    const struct device *dev;
+    struct flash_pages_info info;
+    uint8_t buf[64];
+    size_t erased = 0;
 
     /* Unmount if mounted */
     fs_unmount(&lfs_storage_mnt);
@@ -50,9 +152,40 @@ static int nor_storage_erase(void)
             id, (unsigned int)pfa->fa_off,
             (unsigned int)pfa->fa_size);
 
-    LOG_INF("Erasing flash area ... ");
-    err = flash_area_erase(pfa, 0, pfa->fa_size);
-    LOG_INF("Done. Code: %i", err);
+    dev = flash_area_get_device(pfa);
+
+    /* One sector at a time so LTE and GNSS keep running */
+    for (off_t off = 0; off < pfa->fa_size; off += info.size)
+    {
+        err = flash_get_page_info_by_offs(dev, pfa->fa_off + off, &info);
+        if (err)
+            break;
+
+        /* A blank sector is cheaper to read than to erase */
+        bool blank = true;
+        for (size_t pos = 0; pos < info.size && blank; pos += sizeof(buf))
+        {
+            err = flash_area_read(pfa, off + pos, buf, sizeof(buf));
+            if (err)
+                break;
+
+            for (size_t i = 0; i < sizeof(buf) && blank; i++)
+                blank = buf[i] == 0xff;
+        }
+
+        if (!blank || err)
+        {
+            err = flash_area_erase(pfa, off, info.size);
+            if (err)
+                break;
+
+            erased++;
+        }
+
+        k_yield();
+    }
+
+    flash_area_close(pfa);
 
     if (err)
     {
@@ -60,12 +193,12 @@ static int nor_storage_erase(void)
         return err;
     }
 
-    flash_area_close(pfa);
+    LOG_INF("Erased %i sectors", erased);
 
     return 0;
 }
 
-int nor_storage_init(void)
+static int nor_storage_init(void)
 {
     int err;
     struct fs_dirent dirent;
@@ -79,10 +212,10 @@ int nor_storage_init(void)
     err = fs_statvfs(lfs_storage_mnt.mnt_point, &sbuf);
     if (err < 0)
         LOG_ERR("statvfs: %d", err);
-
-    LOG_INF("bsize = %lu ; frsize = %lu ; blocks = %lu ; bfree = %lu",
-            sbuf.f_bsize, sbuf.f_frsize,
-            sbuf.f_blocks, sbuf.f_bfree);
+    else
+        LOG_DBG("bsize = %lu ; frsize = %lu ; blocks = %lu ; bfree = %lu",
+                sbuf.f_bsize, sbuf.f_frsize,
+                sbuf.f_blocks, sbuf.f_bfree);
 
     /* Make sure the flash has been erased */
     err = fs_stat(NOR_STORAGE_ERASED_ON_BOOT, &dirent);
@@ -90,12 +223,21 @@ int nor_storage_init(void)
     {
         LOG_INF("Erasing storage!");
 
+#ifdef CONFIG_APP_FLASH_STATS
+        /* Formatting isn't wear */
+        app_flash_stats_pause(true);
+#endif
+
         err = nor_storage_erase();
-        if (err < 0)
-            return err;
 
         /* Re-mount */
-        err = fs_mount(&lfs_storage_mnt);
+        if (err == 0)
+            err = fs_mount(&lfs_storage_mnt);
+
+#ifdef CONFIG_APP_FLASH_STATS
+        app_flash_stats_pause(false);
+#endif
+
         if (err)
             return err;
 
@@ -105,12 +247,73 @@ int nor_storage_init(void)
             return err;
     }
 
+#ifdef CONFIG_APP_STATE
+    /* Before anything that uses it */
+    err = app_state_init();
+    if (err)
+        LOG_ERR("Unable to restore state. Err: %i", err);
+#endif
+
+#ifdef CONFIG_APP_FIFO
+    /* Recover store and forward queue */
+    err = app_fifo_init();
+    if (err)
+        LOG_ERR("Unable to init store and forward queue. Err: %i", err);
+#endif
+
+#ifdef CONFIG_APP_HISTORY
+    err = app_history_init();
+    if (err)
+        LOG_ERR("Unable to init history. Err: %i", err);
+#endif
+
+#ifdef CONFIG_APP_STORAGE_WRITE_BUFFER
+    k_work_schedule_for_queue(&nor_storage_work_q, &nor_storage_check_work,
+                              K_SECONDS(CONFIG_APP_STORAGE_WRITE_BUFFER_CHECK_INTERVAL));
+#endif
+
     return 0;
 }
 
+static void nor_storage_init_work_fn(struct k_work *work)
+{
+    int err = nor_storage_init();
+    if (err)
+        LOG_ERR("Unable to init storage. Err: %i", err);
+
+    LOG_INF("Storage ready at %lld ms", k_uptime_get());
+
+    /* Release everyone waiting, even on failure. Consumers check their own state. */
+    storage_err = err;
+    atomic_set(&storage_ready, true);
+    k_sem_give(&storage_ready_sem);
+}
+
+int app_storage_wait_ready(k_timeout_t timeout)
+{
+    if (atomic_get(&storage_ready))
+        return storage_err;
+
+    int err = k_sem_take(&storage_ready_sem, timeout);
+    if (err)
+        return err;
+
+    /* Pass it on to the next waiter */
+    k_sem_give(&storage_ready_sem);
+
+    return storage_err;
+}
+
 static int nor_storage_init_fn(void)
 {
-    return nor_storage_init();
+    /* Mount and first time erase happen off the boot path */
+    k_work_queue_start(&nor_storage_work_q, nor_storage_stack,
+                       K_THREAD_STACK_SIZEOF(nor_storage_stack),
+                       K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+
+    k_work_submit_to_queue(&nor_storage_work_q, &nor_storage_init_work);
+
+    return 0;
 }
 
 SYS_INIT(nor_storage_init_fn, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
\ No newline at end of file
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_STORAGE_H
+#define _APP_STORAGE_H
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Waits for the background mount (and first time erase) to finish.
+ * Nothing on /lfs can be used before this returns 0.
+ *
+ * @param timeout how long to wait
+ * @return int 0 when storage is up. -EAGAIN or -EBUSY on timeout.
+ */
+int app_storage_wait_ready(k_timeout_t timeout);
+
+/**
+ * @brief Writes everything buffered in RAM to flash. Call before a reboot.
+ *
+ * @return int 0 on success
+ */
+int app_storage_flush(void);
+
+/**
+ * @brief Runs flash work on the storage work queue instead of the system one
+ *
+ * @param p_work the work item
+ * @param delay when to run it. Not moved if it's already scheduled.
+ * @return int same as k_work_schedule_for_queue()
+ */
+int app_storage_schedule(struct k_work_delayable *p_work, k_timeout_t delay);
+
+#endif
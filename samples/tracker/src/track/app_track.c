@@ -0,0 +1,81 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_track);
+
+#include <lib/track/track_simplify.h>
+
+#include <app_track.h>
+
+static struct track_simplify m_track;
+
+/* Full copy of the last point held by the simplifier */
+static struct app_gps_data m_candidate;
+
+static void app_track_log_stats(void)
+{
+    struct track_simplify_stats stats;
+
+    track_simplify_stats_get(&m_track, &stats);
+
+    LOG_INF("Track: in %u out %u dropped %u max err %d m", stats.points_in,
+            stats.points_out, stats.points_dropped, (int)stats.max_error_m);
+}
+
+int app_track_simplify(struct app_gps_data *p_data)
+{
+    struct app_gps_data previous;
+    struct track_simplify_point point = {
+        .ts = p_data->ts,
+        .lat = p_data->data.latitude,
+        .lng = p_data->data.longitude,
+    };
+
+    switch (track_simplify_push(&m_track, &point))
+    {
+    case TRACK_SIMPLIFY_EMIT_CURRENT:
+        break;
+    case TRACK_SIMPLIFY_EMIT_PREVIOUS:
+
+        /* Send the held fix, hold on to the new one */
+        previous = m_candidate;
+        m_candidate = *p_data;
+        *p_data = previous;
+
+        break;
+    default:
+        m_candidate = *p_data;
+        return -EAGAIN;
+    }
+
+    app_track_log_stats();
+
+    return 0;
+}
+
+int app_track_flush(struct app_gps_data *p_data)
+{
+    if (!track_simplify_flush(&m_track))
+        return -ENODATA;
+
+    *p_data = m_candidate;
+
+    app_track_log_stats();
+
+    return 0;
+}
+
+static int app_track_init(void)
+{
+    track_simplify_init(&m_track, CONFIG_APP_TRACK_SIMPLIFY_ERROR_M,
+                        CONFIG_APP_TRACK_SIMPLIFY_MAX_HOLD_SEC * MSEC_PER_SEC);
+
+    return 0;
+}
+
+SYS_INIT(app_track_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
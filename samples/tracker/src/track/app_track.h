@@ -0,0 +1,28 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _APP_TRACK_H
+#define _APP_TRACK_H
+
+#include <app_gps.h>
+
+/**
+ * @brief Passes a fix through the track simplification stage
+ *
+ * @param p_data the latest fix. Replaced with the fix that should be sent.
+ * @return int 0 if p_data should be sent. -EAGAIN if it's held.
+ */
+int app_track_simplify(struct app_gps_data *p_data);
+
+/**
+ * @brief Gets the held fix (if any) so the end of the track is sent
+ *
+ * @param p_data where the held fix is copied to
+ * @return int 0 on success. -ENODATA if nothing is held.
+ */
+int app_track_flush(struct app_gps_data *p_data);
+
+#endif
@@ -0,0 +1,269 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include <app_backend.h>
+#include <app_backend_loopback.h>
+#include <app_event_manager.h>
+#include <app_radio.h>
+
+/* Events the backend pushed */
+static atomic_t connected;
+static atomic_t disconnected;
+
+int app_event_manager_push(struct app_event *p_evt)
+{
+	if (p_evt->type == APP_EVENT_BACKEND_CONNECTED)
+		atomic_inc(&connected);
+	else if (p_evt->type == APP_EVENT_BACKEND_DISCONNECTED)
+		atomic_inc(&disconnected);
+
+	return 0;
+}
+
+void app_radio_stats_get(struct app_radio_stats *p_stats)
+{
+	memset(p_stats, 0, sizeof(*p_stats));
+}
+
+void app_radio_tx_count(void)
+{
+}
+
+/* What the downlink handler saw */
+static struct
+{
+	const uint8_t *p_data;
+	size_t len;
+	void *p_user;
+	int calls;
+} downlink;
+
+static void test_downlink_cb(const struct app_backend_downlink *p_downlink, void *p_user)
+{
+	downlink.p_data = p_downlink->p_data;
+	downlink.len = p_downlink->len;
+	downlink.p_user = p_user;
+	downlink.calls++;
+}
+
+static const struct app_backend_loopback_config no_faults = {
+	.reconnect_ms = CONFIG_APP_BACKEND_LOOPBACK_RECONNECT_MS,
+};
+
+static void *backend_loopback_setup(void)
+{
+	char id[] = "test";
+
+	app_backend_init(id, sizeof(id));
+
+	return NULL;
+}
+
+static void backend_loopback_before(void *f)
+{
+	app_backend_loopback_config_set(&no_faults);
+	app_backend_connect();
+
+	/* Connects on the system workqueue */
+	k_sleep(K_MSEC(CONFIG_APP_BACKEND_LOOPBACK_RECONNECT_MS * 2));
+
+	app_backend_loopback_reset();
+	atomic_clear(&connected);
+	atomic_clear(&disconnected);
+}
+
+ZTEST_SUITE(backend_loopback_tests, NULL, backend_loopback_setup, backend_loopback_before, NULL,
+	    NULL);
+
+/**
+ * @brief Transmits are recorded as they were made
+ *
+ */
+ZTEST(backend_loopback_tests, test_record)
+{
+	struct app_backend_loopback_record rec;
+	uint8_t data[] = {0x01, 0x02, 0x03};
+
+	zassert_true(app_backend_is_connected());
+
+	zassert_ok(app_backend_publish("gps", data, sizeof(data)));
+	zassert_ok(app_backend_stream("motion", data, 1));
+
+	zassert_equal(app_backend_loopback_count(), 2);
+
+	zassert_ok(app_backend_loopback_record_get(0, &rec));
+	zassert_equal(rec.kind, APP_BACKEND_LOOPBACK_PUBLISH);
+	zassert_equal(strcmp(rec.topic, "gps"), 0);
+	zassert_equal(rec.len, sizeof(data));
+	zassert_mem_equal(rec.data, data, sizeof(data));
+
+	zassert_ok(app_backend_loopback_record_get(1, &rec));
+	zassert_equal(rec.kind, APP_BACKEND_LOOPBACK_STREAM);
+	zassert_equal(strcmp(rec.topic, "motion"), 0);
+
+	zassert_equal(app_backend_loopback_record_get(2, &rec), -ENOENT);
+}
+
+/**
+ * @brief Only the newest records are held, the totals keep counting
+ *
+ */
+ZTEST(backend_loopback_tests, test_wrap)
+{
+	struct app_backend_loopback_record rec;
+	struct app_backend_loopback_stats stats;
+
+	for (uint8_t i = 0; i < CONFIG_APP_BACKEND_LOOPBACK_RECORDS + 2; i++)
+		zassert_ok(app_backend_merged("gps", &i, 1));
+
+	zassert_equal(app_backend_loopback_count(), CONFIG_APP_BACKEND_LOOPBACK_RECORDS);
+
+	zassert_ok(app_backend_loopback_record_get(0, &rec));
+	zassert_equal(rec.data[0], 2);
+
+	app_backend_loopback_stats_get(&stats);
+	zassert_equal(stats.messages[APP_BACKEND_LOOPBACK_MERGED],
+		      CONFIG_APP_BACKEND_LOOPBACK_RECORDS + 2);
+	zassert_equal(stats.bytes[APP_BACKEND_LOOPBACK_MERGED],
+		      CONFIG_APP_BACKEND_LOOPBACK_RECORDS + 2);
+}
+
+/**
+ * @brief Every Nth transmit fails and isn't recorded
+ *
+ */
+ZTEST(backend_loopback_tests, test_fail_every)
+{
+	struct app_backend_loopback_config config = no_faults;
+	struct app_backend_loopback_stats stats;
+	uint8_t data = 0;
+
+	config.fail_every = 3;
+	app_backend_loopback_config_set(&config);
+
+	for (int i = 1; i <= 6; i++)
+	{
+		int err = app_backend_publish("gps", &data, 1);
+
+		zassert_equal(err, i % 3 ? 0 : -EIO, "transmit %d", i);
+	}
+
+	app_backend_loopback_stats_get(&stats);
+	zassert_equal(stats.failures, 2);
+	zassert_equal(app_backend_loopback_count(), 4);
+}
+
+/**
+ * @brief Dropping the connection fires the events and rejects transmits
+ * until it's back
+ *
+ */
+ZTEST(backend_loopback_tests, test_disconnect)
+{
+	struct app_backend_loopback_config config = no_faults;
+	struct app_backend_loopback_stats stats;
+	uint8_t data = 0;
+
+	config.disconnect_every = 2;
+	app_backend_loopback_config_set(&config);
+
+	zassert_ok(app_backend_publish("gps", &data, 1));
+	zassert_ok(app_backend_publish("gps", &data, 1));
+
+	zassert_false(app_backend_is_connected());
+	zassert_equal(atomic_get(&disconnected), 1);
+	zassert_equal(app_backend_publish("gps", &data, 1), -ENOTCONN);
+
+	k_sleep(K_MSEC(config.reconnect_ms * 2));
+
+	zassert_true(app_backend_is_connected());
+	zassert_equal(atomic_get(&connected), 1);
+
+	app_backend_loopback_stats_get(&stats);
+	zassert_equal(stats.disconnects, 1);
+	zassert_equal(stats.rejected, 1);
+}
+
+/**
+ * @brief Downlinks reach the topic's handler without a copy
+ *
+ */
+ZTEST(backend_loopback_tests, test_downlink)
+{
+	static int user;
+	uint8_t payload[] = {0xa1, 0x68, 'i', 'n', 't', 'e', 'r', 'v', 'a', 'l', 0x18, 0x3c};
+
+	zassert_ok(app_backend_downlink_register("config/test", test_downlink_cb, &user));
+
+	zassert_ok(app_backend_loopback_downlink("config/test", payload, sizeof(payload)));
+	zassert_equal(downlink.calls, 1);
+	zassert_equal_ptr(downlink.p_data, payload);
+	zassert_equal(downlink.len, sizeof(payload));
+	zassert_equal_ptr(downlink.p_user, &user);
+
+	/* Nobody registered for it */
+	zassert_equal(app_backend_loopback_downlink("config/other", payload, 1), -ENOENT);
+
+	/* Same prefix isn't the same topic */
+	zassert_equal(app_backend_loopback_downlink("config/tes", payload, 1), -ENOENT);
+
+	app_backend_disconnect();
+	zassert_equal(app_backend_loopback_downlink("config/test", payload, 1), -ENOTCONN);
+	zassert_equal(downlink.calls, 1);
+}
+
+/**
+ * @brief Same records sent one by one and batched. Prints what each cost.
+ *
+ */
+ZTEST(backend_loopback_tests, test_bench)
+{
+	const int count = 100;
+	struct app_backend_loopback_config config = no_faults;
+	struct app_backend_loopback_stats direct, batched;
+	int64_t start, direct_ms, batched_ms;
+
+	/* Stands in for the time on the air */
+	config.latency_ms = 2;
+	app_backend_loopback_config_set(&config);
+
+	start = k_uptime_get();
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t record = i % 24;
+
+		zassert_ok(app_backend_send("gps", &record, 1));
+	}
+
+	direct_ms = k_uptime_get() - start;
+	app_backend_loopback_stats_get(&direct);
+
+	app_backend_loopback_reset();
+	start = k_uptime_get();
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t record = i % 24;
+
+		zassert_ok(app_backend_batch_put("gps", &record, 1, APP_BACKEND_PRIO_STATE, 0));
+	}
+
+	zassert_ok(app_backend_batch_flush());
+
+	batched_ms = k_uptime_get() - start;
+	app_backend_loopback_stats_get(&batched);
+
+	uint32_t direct_msgs = direct.messages[APP_BACKEND_LOOPBACK_MERGED];
+	uint32_t batched_msgs = batched.messages[APP_BACKEND_LOOPBACK_MERGED];
+
+	TC_PRINT("direct: %u transmits, %u bytes, %lld ms\n", direct_msgs,
+		 direct.bytes[APP_BACKEND_LOOPBACK_MERGED], direct_ms);
+	TC_PRINT("batched: %u transmits, %u bytes, %lld ms\n", batched_msgs,
+		 batched.bytes[APP_BACKEND_LOOPBACK_MERGED], batched_ms);
+
+	zassert_equal(direct_msgs, count);
+	zassert_true(batched_msgs > 0 && batched_msgs < direct_msgs);
+	zassert_true(batched_ms < direct_ms);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2023 Circuit Dojo LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FLASH_SIM_COUNTERS_H
+#define FLASH_SIM_COUNTERS_H
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/stats/stats.h>
+
+/* Counters kept by the flash simulator (CONFIG_FLASH_SIMULATOR_STATS) */
+struct flash_sim_counters
+{
+	uint32_t bytes_read;
+	uint32_t bytes_written;
+	uint32_t write_calls;
+	uint32_t erase_calls;
+};
+
+static int flash_sim_counters_walk(struct stats_hdr *hdr, void *arg, const char *name, uint16_t off)
+{
+	struct flash_sim_counters *p_counters = arg;
+	uint32_t val = *(uint32_t *)((uint8_t *)hdr + off);
+
+	if (strcmp(name, "bytes_read") == 0)
+		p_counters->bytes_read = val;
+	else if (strcmp(name, "bytes_written") == 0)
+		p_counters->bytes_written = val;
+	else if (strcmp(name, "flash_write_calls") == 0)
+		p_counters->write_calls = val;
+	else if (strcmp(name, "flash_erase_calls") == 0)
+		p_counters->erase_calls = val;
+
+	return 0;
+}
+
+/**
+ * @brief Reads the flash simulator counters
+ *
+ * @param p_counters destination
+ * @return int 0 on success
+ */
+static inline int flash_sim_counters_get(struct flash_sim_counters *p_counters)
+{
+	struct stats_hdr *hdr = stats_group_find("flash_sim_stats");
+
+	if (hdr == NULL)
+		return -ENOENT;
+
+	memset(p_counters, 0, sizeof(*p_counters));
+
+	return stats_walk(hdr, flash_sim_counters_walk, p_counters);
+}
+
+/**
+ * @brief Difference between two readings
+ *
+ * @param p_end later reading (updated in place)
+ * @param p_start earlier reading
+ */
+static inline void flash_sim_counters_diff(struct flash_sim_counters *p_end,
+					   const struct flash_sim_counters *p_start)
+{
+	p_end->bytes_read -= p_start->bytes_read;
+	p_end->bytes_written -= p_start->bytes_written;
+	p_end->write_calls -= p_start->write_calls;
+	p_end->erase_calls -= p_start->erase_calls;
+}
+
+#endif
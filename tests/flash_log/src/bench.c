@@ -0,0 +1,153 @@
+#include <zephyr/ztest.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+
+#include <lib/flash_log/flash_log.h>
+
+#include <flash_sim_counters.h>
+
+/*
+ * Throughput and write amplification of the flash log against appending to
+ * a littlefs file. Time comes from the flash simulator's timing model so it
+ * reflects program/erase cost, not host CPU speed.
+ */
+
+#define BENCH_RECORD_SIZE 32
+#define BENCH_RECORDS 2000
+
+FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(bench_lfs);
+static struct fs_mount_t lfs_mnt = {
+	.type = FS_LITTLEFS,
+	.fs_data = &bench_lfs,
+	.storage_dev = (void *)FLASH_AREA_ID(lfs),
+	.mnt_point = "/bench",
+};
+
+struct bench_result
+{
+	int64_t ms;
+	struct flash_sim_counters counters;
+};
+
+static void bench_start(struct bench_result *p_res)
+{
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	p_res->ms = k_uptime_get();
+}
+
+static void bench_end(struct bench_result *p_res, const char *name)
+{
+	struct flash_sim_counters start = p_res->counters;
+	uint32_t payload = BENCH_RECORDS * BENCH_RECORD_SIZE;
+
+	p_res->ms = k_uptime_get() - p_res->ms;
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	flash_sim_counters_diff(&p_res->counters, &start);
+
+	TC_PRINT("%-20s %6lld ms %8u B/s  programmed %7u B (x%u.%02u)  erases %4u  writes %5u\n",
+		 name, p_res->ms,
+		 p_res->ms ? (uint32_t)(payload * 1000LL / p_res->ms) : 0,
+		 p_res->counters.bytes_written,
+		 p_res->counters.bytes_written / payload,
+		 (p_res->counters.bytes_written % payload) * 100 / payload,
+		 p_res->counters.erase_calls,
+		 p_res->counters.write_calls);
+}
+
+static void bench_lfs_append(const char *name, int sync_every)
+{
+	struct fs_file_t file;
+	struct bench_result res;
+	uint8_t rec[BENCH_RECORD_SIZE] = {0};
+
+	/* Start from a blank file system */
+	fs_unmount(&lfs_mnt);
+	zassert_ok(fs_mkfs(FS_LITTLEFS, (uintptr_t)FLASH_AREA_ID(lfs), NULL, 0));
+	zassert_ok(fs_mount(&lfs_mnt));
+
+	fs_file_t_init(&file);
+	zassert_ok(fs_open(&file, "/bench/log", FS_O_CREATE | FS_O_APPEND | FS_O_WRITE));
+
+	bench_start(&res);
+
+	for (int i = 0; i < BENCH_RECORDS; i++)
+	{
+		memcpy(rec, &i, sizeof(i));
+		zassert_equal(fs_write(&file, rec, sizeof(rec)), sizeof(rec));
+
+		if ((i + 1) % sync_every == 0)
+			zassert_ok(fs_sync(&file));
+	}
+
+	zassert_ok(fs_close(&file));
+
+	bench_end(&res, name);
+
+	zassert_ok(fs_unmount(&lfs_mnt));
+}
+
+ZTEST_SUITE(flash_log_bench, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Appends with every record durable
+ *
+ */
+ZTEST(flash_log_bench, test_append)
+{
+	static struct flash_log test_log;
+	struct bench_result res;
+	uint8_t rec[BENCH_RECORD_SIZE] = {0};
+	const struct flash_log_config config = {
+		.area_id = FLASH_AREA_ID(log),
+		.record_size = BENCH_RECORD_SIZE,
+	};
+
+	zassert_ok(flash_log_init(&test_log, &config));
+	zassert_ok(flash_log_clear(&test_log));
+
+	bench_start(&res);
+
+	for (int i = 0; i < BENCH_RECORDS; i++)
+	{
+		memcpy(rec, &i, sizeof(i));
+		zassert_ok(flash_log_append(&test_log, rec));
+	}
+
+	bench_end(&res, "flash_log");
+
+	/* Slot overhead plus sector headers. No metadata. */
+	zassert_true(res.counters.bytes_written < 2 * BENCH_RECORDS * BENCH_RECORD_SIZE);
+
+	bench_lfs_append("littlefs sync/1", 1);
+	bench_lfs_append("littlefs sync/16", 16);
+}
+
+/**
+ * @brief Time and reads needed to find head and tail at init
+ *
+ */
+ZTEST(flash_log_bench, test_mount)
+{
+	static struct flash_log test_log;
+	struct flash_sim_counters start;
+	struct flash_sim_counters end;
+	const struct flash_log_config config = {
+		.area_id = FLASH_AREA_ID(log),
+		.record_size = BENCH_RECORD_SIZE,
+	};
+
+	zassert_ok(flash_sim_counters_get(&start));
+	int64_t ms = k_uptime_get();
+
+	zassert_ok(flash_log_init(&test_log, &config));
+
+	ms = k_uptime_get() - ms;
+	zassert_ok(flash_sim_counters_get(&end));
+	flash_sim_counters_diff(&end, &start);
+
+	TC_PRINT("flash_log init: %u records, %lld ms, %u bytes read\n",
+		 flash_log_count(&test_log), ms, end.bytes_read);
+
+	/* Sector headers, a binary search and one sector erase check */
+	zassert_true(end.bytes_read < 2 * test_log.sector_size);
+}
@@ -0,0 +1,218 @@
+#include <zephyr/ztest.h>
+
+#include <lib/flash_log/flash_log.h>
+
+#define RECORD_SIZE 60
+
+static struct flash_log test_log;
+
+static const struct flash_log_config config = {
+	.area_id = FLASH_AREA_ID(log),
+	.record_size = RECORD_SIZE,
+};
+
+static void record_fill(uint8_t *p_rec, uint32_t index)
+{
+	memset(p_rec, (uint8_t)index, RECORD_SIZE);
+	memcpy(p_rec, &index, sizeof(index));
+}
+
+static uint32_t record_index(uint8_t *p_rec)
+{
+	uint32_t index;
+
+	memcpy(&index, p_rec, sizeof(index));
+
+	return index;
+}
+
+static void append_range(uint32_t start, uint32_t count)
+{
+	uint8_t rec[RECORD_SIZE];
+
+	for (uint32_t i = start; i < start + count; i++)
+	{
+		record_fill(rec, i);
+		zassert_ok(flash_log_append(&test_log, rec));
+	}
+}
+
+/* Reads everything and checks the indexes are consecutive. Returns the first index. */
+static uint32_t read_all(uint32_t *p_count)
+{
+	uint8_t rec[RECORD_SIZE];
+	uint8_t expected[RECORD_SIZE];
+	struct flash_log_cursor cursor;
+	uint32_t first = 0;
+	uint32_t count = 0;
+
+	flash_log_cursor_init(&test_log, &cursor);
+
+	while (flash_log_read(&test_log, &cursor, rec) == 0)
+	{
+		if (count == 0)
+			first = record_index(rec);
+
+		record_fill(expected, first + count);
+		zassert_mem_equal(rec, expected, RECORD_SIZE, "record %u", first + count);
+		count++;
+	}
+
+	*p_count = count;
+
+	return first;
+}
+
+static void before(void *fixture)
+{
+	zassert_ok(flash_log_init(&test_log, &config));
+	zassert_ok(flash_log_clear(&test_log));
+}
+
+ZTEST_SUITE(flash_log_tests, NULL, NULL, before, NULL, NULL);
+
+/**
+ * @brief Records come back in order
+ *
+ */
+ZTEST(flash_log_tests, test_append_read)
+{
+	uint32_t count;
+
+	append_range(0, 200);
+
+	zassert_equal(flash_log_count(&test_log), 200);
+	zassert_equal(read_all(&count), 0);
+	zassert_equal(count, 200);
+}
+
+/**
+ * @brief A reader catches up with a head sector that's exactly full
+ *
+ */
+ZTEST(flash_log_tests, test_full_sector)
+{
+	uint8_t rec[RECORD_SIZE];
+	struct flash_log_cursor cursor;
+	uint32_t count;
+
+	append_range(0, test_log.slots_per_sector);
+
+	zassert_equal(read_all(&count), 0);
+	zassert_equal(count, test_log.slots_per_sector);
+
+	/* Picks up the next record from there */
+	flash_log_cursor_init(&test_log, &cursor);
+	while (flash_log_read(&test_log, &cursor, rec) == 0)
+		;
+
+	append_range(test_log.slots_per_sector, 1);
+
+	zassert_ok(flash_log_read(&test_log, &cursor, rec));
+	zassert_equal(record_index(rec), test_log.slots_per_sector);
+	zassert_equal(flash_log_read(&test_log, &cursor, rec), -ENODATA);
+}
+
+/**
+ * @brief Head and tail are recovered at init
+ *
+ */
+ZTEST(flash_log_tests, test_recovery)
+{
+	uint32_t count;
+
+	append_range(0, 150);
+
+	/* Like a reset */
+	zassert_ok(flash_log_init(&test_log, &config));
+	zassert_equal(flash_log_count(&test_log), 150);
+
+	append_range(150, 50);
+
+	zassert_equal(read_all(&count), 0);
+	zassert_equal(count, 200);
+}
+
+/**
+ * @brief Oldest sector is dropped once the log wraps
+ *
+ */
+ZTEST(flash_log_tests, test_wrap)
+{
+	uint32_t count;
+	uint32_t first;
+	uint32_t total = 3 * test_log.sector_count * test_log.slots_per_sector + 17;
+	uint32_t capacity = (test_log.sector_count - 1) * test_log.slots_per_sector;
+
+	append_range(0, total);
+
+	first = read_all(&count);
+	zassert_true(count <= capacity, "count %u", count);
+	zassert_true(count > capacity - test_log.slots_per_sector, "count %u", count);
+	zassert_equal(first + count, total);
+
+	/* Same after a reset */
+	zassert_ok(flash_log_init(&test_log, &config));
+	zassert_equal(read_all(&count), first);
+	zassert_equal(first + count, total);
+}
+
+/**
+ * @brief A record that was only partly written is skipped
+ *
+ */
+ZTEST(flash_log_tests, test_torn_record)
+{
+	uint32_t count;
+	struct flash_log_stats stats;
+	uint8_t junk[8] = {0x31, 0x43, 0x45, 0x52, 0x00, 0x01, 0x02, 0x03};
+
+	append_range(0, 10);
+
+	/* Marker and the start of a record, no CRC */
+	off_t off = test_log.hdr_size + 10 * test_log.slot_size;
+
+	zassert_ok(flash_area_write(test_log.p_fa, off, junk, sizeof(junk)));
+
+	zassert_ok(flash_log_init(&test_log, &config));
+	zassert_equal(flash_log_count(&test_log), 11);
+
+	append_range(10, 5);
+
+	zassert_equal(read_all(&count), 0);
+	zassert_equal(count, 15);
+
+	flash_log_stats_get(&test_log, &stats);
+	zassert_equal(stats.corrupt, 1);
+}
+
+/**
+ * @brief Appends only erase inline when the erase ahead didn't happen
+ *
+ */
+ZTEST(flash_log_tests, test_deferred_erase)
+{
+	struct flash_log_stats stats;
+	struct flash_log_config deferred = config;
+
+	deferred.deferred_erase = true;
+	zassert_ok(flash_log_init(&test_log, &deferred));
+
+	/* Wrap once so no sector is erased anymore */
+	append_range(0, test_log.sector_count * test_log.slots_per_sector);
+
+	flash_log_stats_get(&test_log, &stats);
+	zassert_true(stats.inline_erases > 0);
+
+	/* Keep up with the erases */
+	uint32_t inline_erases = stats.inline_erases;
+
+	for (uint32_t i = 0; i < 4 * test_log.slots_per_sector; i++)
+	{
+		zassert_ok(flash_log_erase_ahead(&test_log));
+		append_range(i, 1);
+	}
+
+	flash_log_stats_get(&test_log, &stats);
+	zassert_equal(stats.inline_erases, inline_erases);
+}
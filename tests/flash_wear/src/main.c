@@ -0,0 +1,125 @@
+#include <zephyr/ztest.h>
+
+#include <lib/flash_wear/flash_wear.h>
+
+#define TEST_SECTORS 8
+#define TEST_SECTOR_SIZE 4096
+
+static uint16_t erase_counts[TEST_SECTORS];
+static struct flash_wear wear;
+
+static void flash_wear_before(void *f)
+{
+	flash_wear_init(&wear, erase_counts, TEST_SECTORS, TEST_SECTOR_SIZE);
+}
+
+ZTEST_SUITE(flash_wear_tests, NULL, NULL, flash_wear_before, NULL, NULL);
+
+/**
+ * @brief Bytes, calls, errors and latency per operation
+ *
+ */
+ZTEST(flash_wear_tests, test_record)
+{
+	flash_wear_record(&wear, FLASH_WEAR_READ, 0, 64, 30, 0);
+	flash_wear_record(&wear, FLASH_WEAR_READ, 64, 64, 120, 0);
+	flash_wear_record(&wear, FLASH_WEAR_PROGRAM, 0, 256, 700, 0);
+	flash_wear_record(&wear, FLASH_WEAR_PROGRAM, 0, 256, 700, -EIO);
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, 0, TEST_SECTOR_SIZE, 45000, 0);
+
+	zassert_equal(wear.calls[FLASH_WEAR_READ], 2);
+	zassert_equal(wear.bytes[FLASH_WEAR_READ], 128);
+	zassert_equal(wear.calls[FLASH_WEAR_PROGRAM], 1);
+	zassert_equal(wear.bytes[FLASH_WEAR_PROGRAM], 256);
+	zassert_equal(wear.errors[FLASH_WEAR_PROGRAM], 1);
+	zassert_equal(wear.bytes[FLASH_WEAR_ERASE], TEST_SECTOR_SIZE);
+
+	/* 50 us and 200 us buckets */
+	zassert_equal(wear.latency[FLASH_WEAR_READ].counts[0], 1);
+	zassert_equal(wear.latency[FLASH_WEAR_READ].counts[2], 1);
+	zassert_equal(histogram_percentile(&wear.latency[FLASH_WEAR_ERASE], 50), 50000);
+
+	flash_wear_reset(&wear);
+	zassert_equal(wear.calls[FLASH_WEAR_READ], 0);
+	zassert_equal(histogram_total(&wear.latency[FLASH_WEAR_ERASE]), 0);
+	zassert_equal(erase_counts[0], 0);
+}
+
+/**
+ * @brief Erases count against every sector they cover
+ *
+ */
+ZTEST(flash_wear_tests, test_sectors)
+{
+	struct flash_wear_summary summary;
+
+	/* Two sectors, then the second one alone */
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, TEST_SECTOR_SIZE, 2 * TEST_SECTOR_SIZE, 0, 0);
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, 2 * TEST_SECTOR_SIZE, TEST_SECTOR_SIZE, 0, 0);
+
+	/* Past the end is ignored */
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, TEST_SECTORS * TEST_SECTOR_SIZE, TEST_SECTOR_SIZE,
+			  0, 0);
+
+	zassert_equal(erase_counts[0], 0);
+	zassert_equal(erase_counts[1], 1);
+	zassert_equal(erase_counts[2], 2);
+	zassert_equal(erase_counts[3], 0);
+
+	flash_wear_summary_get(&wear, &summary);
+	zassert_equal(summary.erases, 3);
+	zassert_equal(summary.min, 0);
+	zassert_equal(summary.max, 2);
+	zassert_equal(summary.used_sectors, 2);
+	zassert_equal(summary.avg_x100, 3 * 100 / TEST_SECTORS);
+}
+
+/**
+ * @brief Saved counts add to the ones since boot
+ *
+ */
+ZTEST(flash_wear_tests, test_erase_counts_load)
+{
+	uint16_t saved[3] = {5, UINT16_MAX, 7};
+	uint16_t out[TEST_SECTORS];
+
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, 0, TEST_SECTOR_SIZE, 0, 0);
+	flash_wear_record(&wear, FLASH_WEAR_ERASE, TEST_SECTOR_SIZE, TEST_SECTOR_SIZE, 0, 0);
+
+	/* The last one is past the end */
+	flash_wear_erase_counts_add(&wear, TEST_SECTORS - 3, saved, ARRAY_SIZE(saved));
+	flash_wear_erase_counts_add(&wear, 0, saved, 2);
+
+	zassert_equal(erase_counts[0], 6);
+	zassert_equal(erase_counts[1], UINT16_MAX);
+	zassert_equal(erase_counts[TEST_SECTORS - 3], 5);
+	zassert_equal(erase_counts[TEST_SECTORS - 1], 7);
+
+	zassert_equal(flash_wear_erase_counts_get(&wear, 0, out, ARRAY_SIZE(out)), TEST_SECTORS);
+	zassert_equal(out[0], 6);
+	zassert_equal(flash_wear_erase_counts_get(&wear, TEST_SECTORS - 1, out, ARRAY_SIZE(out)), 1);
+	zassert_equal(out[0], 7);
+	zassert_equal(flash_wear_erase_counts_get(&wear, TEST_SECTORS, out, ARRAY_SIZE(out)), 0);
+}
+
+/**
+ * @brief Endurance follows the most worn sector
+ *
+ */
+ZTEST(flash_wear_tests, test_endurance)
+{
+	struct flash_wear_summary summary = {0};
+	int64_t day = 24LL * 3600 * 1000;
+
+	zassert_equal(flash_wear_endurance_days(&summary, 100000, day), UINT32_MAX);
+
+	/* 10 cycles a day leaves 9999 days */
+	summary.max = 10;
+	zassert_equal(flash_wear_endurance_days(&summary, 100000, day), 9999);
+
+	/* Half a day */
+	zassert_equal(flash_wear_endurance_days(&summary, 100000, day / 2), 4999);
+
+	summary.max = 100;
+	zassert_equal(flash_wear_endurance_days(&summary, 100, day), 0);
+}
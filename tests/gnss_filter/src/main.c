@@ -0,0 +1,206 @@
+#include <stdlib.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/gnss/gnss_filter.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(gnss_filter_tests);
+
+/* 1 m of latitude in 1e-7 degrees */
+#define E7_PER_M 90
+
+static const struct gnss_filter_config config = {
+	.max_speed_cm_s = 5000,
+	.accel_sigma_cm_s2 = 200,
+	.max_gap_ms = 30000,
+	.max_rejects = 3,
+};
+
+static struct gnss_filter filter;
+
+/* Deterministic noise in [-amplitude, amplitude] */
+static int32_t noise(uint32_t *p_seed, int32_t amplitude)
+{
+	*p_seed = *p_seed * 1103515245 + 12345;
+
+	return (int32_t)((*p_seed >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	gnss_filter_init(&filter, &config);
+}
+
+ZTEST_SUITE(gnss_filter_tests, NULL, NULL, before, NULL, NULL);
+
+/**
+ * @brief Test smoothing of a noisy track
+ *
+ * Filtered positions should be closer to the truth than the raw ones
+ *
+ */
+ZTEST(gnss_filter_tests, test_smoothing)
+{
+	struct gnss_filter_fix fix;
+	uint32_t seed = 1;
+	int64_t raw_error = 0;
+	int64_t filtered_error = 0;
+
+	zassert_equal(gnss_filter_get(&filter, &fix), -ENODATA);
+
+	/* 10 m/s north with +-8 m of noise */
+	for (int i = 0; i < 120; i++)
+	{
+		int32_t truth = 450000000 + i * 10 * E7_PER_M;
+
+		struct gnss_filter_meas meas = {
+			.ts = i * 1000,
+			.lat_e7 = truth + noise(&seed, 8 * E7_PER_M),
+			.lng_e7 = -1220000000,
+			.accuracy_cm = 800,
+			.sats_used = 7,
+		};
+
+		enum gnss_filter_result res = gnss_filter_update(&filter, &meas);
+		zassert_not_equal(res, GNSS_FILTER_REJECTED);
+
+		zassert_ok(gnss_filter_get(&filter, &fix));
+
+		/* Skip the settling period */
+		if (i >= 20)
+		{
+			raw_error += abs(meas.lat_e7 - truth);
+			filtered_error += abs(fix.lat_e7 - truth);
+		}
+	}
+
+	LOG_INF("Mean error raw: %d cm filtered: %d cm", (int)(raw_error * 111 / 100 / 100),
+		(int)(filtered_error * 111 / 100 / 100));
+
+	zassert_true(filtered_error < raw_error);
+	zassert_true(fix.accuracy_cm < 800);
+}
+
+/**
+ * @brief Test rejection of a jump
+ *
+ * A single bad fix should be rejected. Persistent ones restart the filter.
+ *
+ */
+ZTEST(gnss_filter_tests, test_outlier_rejection)
+{
+	struct gnss_filter_fix fix;
+	struct gnss_filter_meas meas = {
+		.ts = 0,
+		.lat_e7 = 450000000,
+		.lng_e7 = -1220000000,
+		.accuracy_cm = 500,
+		.sats_used = 8,
+	};
+
+	zassert_equal(gnss_filter_update(&filter, &meas), GNSS_FILTER_RESET);
+
+	meas.ts = 1000;
+	zassert_equal(gnss_filter_update(&filter, &meas), GNSS_FILTER_ACCEPTED);
+
+	/* 500 m in a second */
+	meas.ts = 2000;
+	meas.lat_e7 += 500 * E7_PER_M;
+	zassert_equal(gnss_filter_update(&filter, &meas), GNSS_FILTER_REJECTED);
+
+	zassert_ok(gnss_filter_get(&filter, &fix));
+	zassert_within(fix.lat_e7, 450000000, E7_PER_M);
+
+	/* It's still there. Eventually the filter follows. */
+	for (int i = 0; i < config.max_rejects - 1; i++)
+	{
+		meas.ts += 1000;
+		zassert_equal(gnss_filter_update(&filter, &meas), GNSS_FILTER_REJECTED);
+	}
+
+	meas.ts += 1000;
+	zassert_equal(gnss_filter_update(&filter, &meas), GNSS_FILTER_RESET);
+
+	zassert_ok(gnss_filter_get(&filter, &fix));
+	zassert_equal(fix.lat_e7, meas.lat_e7);
+}
+
+/**
+ * @brief Test weighting of poor fixes
+ *
+ * A poor fix should barely move the filter compared to a good one
+ *
+ */
+ZTEST(gnss_filter_tests, test_weighting)
+{
+	struct gnss_filter_fix good, poor;
+	struct gnss_filter_meas meas = {
+		.ts = 0,
+		.lat_e7 = 450000000,
+		.lng_e7 = -1220000000,
+		.accuracy_cm = 300,
+		.sats_used = 8,
+	};
+
+	gnss_filter_update(&filter, &meas);
+
+	/* Same 20 m offset: once with a good fix, once with a poor one */
+	struct gnss_filter_meas offset = meas;
+	offset.ts = 1000;
+	offset.lat_e7 += 20 * E7_PER_M;
+
+	gnss_filter_update(&filter, &offset);
+	gnss_filter_get(&filter, &good);
+
+	gnss_filter_init(&filter, &config);
+	gnss_filter_update(&filter, &meas);
+
+	offset.accuracy_cm = 3000;
+	offset.sats_used = 4;
+
+	gnss_filter_update(&filter, &offset);
+	gnss_filter_get(&filter, &poor);
+
+	zassert_true(poor.lat_e7 - meas.lat_e7 < (good.lat_e7 - meas.lat_e7) / 4);
+}
+
+/**
+ * @brief Test a track across the antimeridian
+ *
+ * The longitude wraps from +180 to -180. That's a few meters, not a jump.
+ *
+ */
+ZTEST(gnss_filter_tests, test_antimeridian)
+{
+	struct gnss_filter_fix fix;
+
+	/* 10 m/s east on the equator, starting 100 m short of it */
+	for (int i = 0; i < 30; i++)
+	{
+		int64_t truth = 1800000000LL - 100 * E7_PER_M + i * 10 * E7_PER_M;
+
+		if (truth > 1800000000LL)
+			truth -= 3600000000LL;
+
+		struct gnss_filter_meas meas = {
+			.ts = i * 1000,
+			.lat_e7 = 0,
+			.lng_e7 = (int32_t)truth,
+			.accuracy_cm = 500,
+			.sats_used = 8,
+		};
+
+		enum gnss_filter_result res = gnss_filter_update(&filter, &meas);
+		zassert_equal(res, i == 0 ? GNSS_FILTER_RESET : GNSS_FILTER_ACCEPTED, "fix %d", i);
+
+		zassert_ok(gnss_filter_get(&filter, &fix));
+		zassert_true(fix.lng_e7 >= -1800000000 && fix.lng_e7 <= 1800000000);
+	}
+
+	/* Past it and following */
+	zassert_true(fix.lng_e7 < 0);
+	zassert_within(fix.lng_e7, -1800000000 + 190 * E7_PER_M, 5 * E7_PER_M);
+}
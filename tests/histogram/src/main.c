@@ -0,0 +1,61 @@
+#include <zephyr/ztest.h>
+
+#include <lib/stats/histogram.h>
+
+static const int32_t bounds[] = {5, 10, 20, 60};
+
+ZTEST_SUITE(histogram_tests, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test bucketing of values
+ *
+ * Values on a bound go into that bound's bucket. Anything above the
+ * largest bound goes into the overflow bucket.
+ *
+ */
+ZTEST(histogram_tests, test_buckets)
+{
+	struct histogram hist = HISTOGRAM_INITIALIZER(bounds);
+
+	zassert_equal(histogram_buckets(&hist), 5);
+	zassert_equal(histogram_total(&hist), 0);
+	zassert_equal(histogram_percentile(&hist, 50), 0);
+
+	histogram_add(&hist, -1);
+	histogram_add(&hist, 5);
+	histogram_add(&hist, 6);
+	histogram_add(&hist, 20);
+	histogram_add(&hist, 61);
+
+	zassert_equal(hist.counts[0], 2);
+	zassert_equal(hist.counts[1], 1);
+	zassert_equal(hist.counts[2], 1);
+	zassert_equal(hist.counts[3], 0);
+	zassert_equal(hist.counts[4], 1);
+	zassert_equal(histogram_total(&hist), 5);
+
+	histogram_reset(&hist);
+	zassert_equal(histogram_total(&hist), 0);
+}
+
+/**
+ * @brief Test percentiles
+ *
+ * Percentiles resolve to the upper bound of the bucket they fall in
+ *
+ */
+ZTEST(histogram_tests, test_percentile)
+{
+	struct histogram hist = HISTOGRAM_INITIALIZER(bounds);
+
+	for (int i = 1; i <= 100; i++)
+		histogram_add(&hist, i);
+
+	zassert_equal(histogram_percentile(&hist, 0), 5);
+	zassert_equal(histogram_percentile(&hist, 5), 5);
+	zassert_equal(histogram_percentile(&hist, 6), 10);
+	zassert_equal(histogram_percentile(&hist, 50), 60);
+	zassert_equal(histogram_percentile(&hist, 60), 60);
+	zassert_equal(histogram_percentile(&hist, 61), INT32_MAX);
+	zassert_equal(histogram_percentile(&hist, 100), INT32_MAX);
+}
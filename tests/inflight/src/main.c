@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/inflight/inflight.h>
+
+/* Two slots of 32 bytes each */
+#define TEST_MEM_SIZE 64
+
+static uint8_t mem[TEST_MEM_SIZE];
+static struct inflight table;
+
+static const struct inflight_config config = {
+	.timeout_ms = 1000,
+	.backoff_min_ms = 100,
+	.backoff_max_ms = 400,
+	.max_attempts = 4,
+};
+
+/* What the callbacks saw */
+static struct
+{
+	uint32_t id;
+	char topic[CONFIG_INFLIGHT_TOPIC_LEN];
+	uint8_t kind;
+	uint8_t data[TEST_MEM_SIZE];
+	size_t len;
+	int sends;
+	int err;
+
+	int results;
+	int result_err;
+	uint32_t result_ms;
+
+	int fails;
+	int fail_err;
+	uint8_t failed[TEST_MEM_SIZE];
+	size_t failed_len;
+} sink;
+
+static int test_send(uint32_t id, const char *p_topic, uint8_t kind, const uint8_t *p_data,
+		     size_t len, void *p_user)
+{
+	sink.sends++;
+
+	if (sink.err)
+		return sink.err;
+
+	sink.id = id;
+	strcpy(sink.topic, p_topic);
+	sink.kind = kind;
+	memcpy(sink.data, p_data, len);
+	sink.len = len;
+
+	return 0;
+}
+
+static void test_result(const char *p_topic, uint8_t kind, int err, uint32_t ms, void *p_user)
+{
+	sink.results++;
+	sink.result_err = err;
+	sink.result_ms = ms;
+}
+
+static void test_fail(const char *p_topic, uint8_t kind, const uint8_t *p_data, size_t len,
+		      int err, void *p_user)
+{
+	sink.fails++;
+	sink.fail_err = err;
+	memcpy(sink.failed, p_data, len);
+	sink.failed_len = len;
+}
+
+static void inflight_before(void *f)
+{
+	memset(&sink, 0, sizeof(sink));
+	inflight_init(&table, mem, sizeof(mem), &config, test_send, test_result, test_fail, NULL);
+}
+
+ZTEST_SUITE(inflight_tests, NULL, NULL, inflight_before, NULL, NULL);
+
+/**
+ * @brief An acked request frees its slot and records the latency
+ *
+ */
+ZTEST(inflight_tests, test_ack)
+{
+	uint8_t data[] = {1, 2, 3};
+	struct inflight_stats stats;
+
+	zassert_ok(inflight_submit(&table, "gps", 7, data, sizeof(data), 1000));
+	zassert_equal(sink.sends, 1);
+	zassert_equal(strcmp(sink.topic, "gps"), 0);
+	zassert_equal(sink.kind, 7);
+	zassert_mem_equal(sink.data, data, sizeof(data));
+
+	zassert_equal(inflight_count(&table), 1);
+	zassert_equal(inflight_deadline(&table), 2000);
+
+	inflight_complete(&table, sink.id, 0, 1150);
+	zassert_equal(inflight_count(&table), 0);
+	zassert_equal(sink.results, 1);
+	zassert_equal(sink.result_err, 0);
+	zassert_equal(sink.result_ms, 150);
+	zassert_equal(inflight_deadline(&table), INT64_MAX);
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.submitted, 1);
+	zassert_equal(stats.acked, 1);
+	zassert_equal(histogram_total(&stats.latency), 1);
+	zassert_equal(histogram_percentile(&stats.latency, 50), 200);
+}
+
+/**
+ * @brief Only as many requests as there are slots are outstanding
+ *
+ */
+ZTEST(inflight_tests, test_window)
+{
+	uint8_t data = 1;
+	uint8_t big[TEST_MEM_SIZE / 2 + 1] = {0};
+	struct inflight_stats stats;
+
+	zassert_equal(inflight_submit(&table, "gps", 0, big, sizeof(big), 0), -EMSGSIZE);
+
+	zassert_ok(inflight_submit(&table, "gps", 0, &data, 1, 0));
+	uint32_t first = sink.id;
+
+	zassert_ok(inflight_submit(&table, "gps", 0, &data, 1, 0));
+	zassert_equal(inflight_submit(&table, "gps", 0, &data, 1, 0), -EBUSY);
+
+	inflight_complete(&table, first, 0, 10);
+	zassert_ok(inflight_submit(&table, "gps", 0, &data, 1, 10));
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.window_full, 1);
+	zassert_equal(stats.submitted, 3);
+}
+
+/**
+ * @brief Failures back off exponentially (half of it random) up to the max
+ *
+ */
+ZTEST(inflight_tests, test_backoff)
+{
+	uint8_t data = 1;
+	int64_t now = 0;
+	struct inflight_stats stats;
+
+	zassert_ok(inflight_submit(&table, "gps", 0, &data, 1, now));
+
+	/* 100, 200 then 400 ms (halved at most by the jitter) */
+	for (uint32_t delay = 100; delay <= 400; delay *= 2)
+	{
+		inflight_complete(&table, sink.id, -EIO, now);
+
+		int64_t due = inflight_deadline(&table);
+		zassert_true(due >= now + delay / 2 && due <= now + delay, "due %lld", due - now);
+
+		inflight_poll(&table, due - 1);
+		zassert_equal(sink.sends, delay == 100 ? 1 : delay == 200 ? 2 : 3);
+
+		now = due;
+		inflight_poll(&table, now);
+	}
+
+	zassert_equal(sink.sends, 4);
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.retries, 3);
+	zassert_equal(stats.failed, 0);
+}
+
+/**
+ * @brief Attempts without a result time out. Their late results are ignored.
+ *
+ */
+ZTEST(inflight_tests, test_timeout)
+{
+	uint8_t data = 1;
+	struct inflight_stats stats;
+
+	zassert_ok(inflight_submit(&table, "gps", 0, &data, 1, 0));
+	uint32_t first = sink.id;
+
+	inflight_poll(&table, 1000);
+	zassert_equal(sink.result_err, -ETIMEDOUT);
+
+	inflight_poll(&table, inflight_deadline(&table));
+	zassert_equal(sink.sends, 2);
+
+	inflight_complete(&table, first, 0, 1200);
+	zassert_equal(inflight_count(&table), 1);
+
+	inflight_complete(&table, sink.id, 0, 1300);
+	zassert_equal(inflight_count(&table), 0);
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.timeouts, 1);
+	zassert_equal(stats.late, 1);
+	zassert_equal(stats.acked, 1);
+}
+
+/**
+ * @brief Out of attempts the payload goes to the fail callback
+ *
+ */
+ZTEST(inflight_tests, test_exhausted)
+{
+	uint8_t data[] = {4, 5};
+	struct inflight_stats stats;
+
+	/* Every retry fails right away */
+	zassert_ok(inflight_submit(&table, "motion", 0, data, sizeof(data), 0));
+	inflight_complete(&table, sink.id, -EIO, 0);
+	sink.err = -ENOTCONN;
+
+	for (int i = 1; i < config.max_attempts; i++)
+		inflight_poll(&table, inflight_deadline(&table));
+
+	zassert_equal(sink.sends, config.max_attempts);
+	zassert_equal(sink.fails, 1);
+	zassert_equal(sink.fail_err, -ENOTCONN);
+	zassert_equal(sink.failed_len, sizeof(data));
+	zassert_mem_equal(sink.failed, data, sizeof(data));
+	zassert_equal(inflight_count(&table), 0);
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.failed, 1);
+	zassert_equal(stats.retries, config.max_attempts - 1);
+}
+
+/**
+ * @brief A first attempt that fails right away is handed back to the caller
+ *
+ */
+ZTEST(inflight_tests, test_first_attempt)
+{
+	uint8_t data = 1;
+	struct inflight_stats stats;
+
+	sink.err = -ENOTCONN;
+	zassert_equal(inflight_submit(&table, "gps", 0, &data, 1, 0), -ENOTCONN);
+	zassert_equal(inflight_count(&table), 0);
+	zassert_equal(sink.fails, 0);
+
+	inflight_stats_get(&table, &stats);
+	zassert_equal(stats.submitted, 0);
+	zassert_equal(stats.failed, 0);
+}
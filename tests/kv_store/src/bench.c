@@ -0,0 +1,146 @@
+#include <zephyr/ztest.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+
+#include <lib/kv_store/kv_store.h>
+
+#include <flash_sim_counters.h>
+
+/*
+ * Counter updates on NVS against the open/read/seek/write/close pattern on
+ * a littlefs file (samples/external_flash). Time comes from the flash
+ * simulator's timing model so it reflects program/erase cost, not host CPU
+ * speed.
+ */
+
+#define BENCH_INCREMENTS 500
+
+FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(bench_lfs);
+static struct fs_mount_t lfs_mnt = {
+	.type = FS_LITTLEFS,
+	.fs_data = &bench_lfs,
+	.storage_dev = (void *)FLASH_AREA_ID(lfs),
+	.mnt_point = "/bench",
+};
+
+struct bench_result
+{
+	int64_t ms;
+	struct flash_sim_counters counters;
+};
+
+static void bench_start(struct bench_result *p_res)
+{
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	p_res->ms = k_uptime_get();
+}
+
+static void bench_end(struct bench_result *p_res, const char *name)
+{
+	struct flash_sim_counters start = p_res->counters;
+
+	p_res->ms = k_uptime_get() - p_res->ms;
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	flash_sim_counters_diff(&p_res->counters, &start);
+
+	TC_PRINT("%-16s %6lld ms  %4u us/op  programmed %7u B  read %7u B  erases %4u\n",
+		 name, p_res->ms, (uint32_t)(p_res->ms * 1000 / BENCH_INCREMENTS),
+		 p_res->counters.bytes_written, p_res->counters.bytes_read,
+		 p_res->counters.erase_calls);
+}
+
+/* Same steps as nor_storage_increment() */
+static int bench_lfs_increment(const char *p_path, uint32_t *p_val)
+{
+	struct fs_file_t file;
+	uint32_t val = 0;
+
+	fs_file_t_init(&file);
+
+	int err = fs_open(&file, p_path, FS_O_CREATE | FS_O_RDWR);
+	if (err)
+		return err;
+
+	if (fs_read(&file, &val, sizeof(val)) < 0 || fs_seek(&file, 0, FS_SEEK_SET) < 0)
+		err = -EIO;
+
+	val++;
+
+	if (!err && fs_write(&file, &val, sizeof(val)) != sizeof(val))
+		err = -EIO;
+
+	int close_err = fs_close(&file);
+
+	*p_val = val;
+
+	return err ? err : close_err;
+}
+
+static int bench_lfs_read(const char *p_path, uint32_t *p_val)
+{
+	struct fs_file_t file;
+
+	fs_file_t_init(&file);
+
+	int err = fs_open(&file, p_path, FS_O_READ);
+	if (err)
+		return err;
+
+	if (fs_read(&file, p_val, sizeof(*p_val)) != sizeof(*p_val))
+		err = -EIO;
+
+	fs_close(&file);
+
+	return err;
+}
+
+ZTEST_SUITE(kv_store_bench, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Increments and reads on both
+ *
+ */
+ZTEST(kv_store_bench, test_increment)
+{
+	static struct kv_store kv;
+	struct bench_result add;
+	struct bench_result res;
+	struct bench_result lfs;
+	uint32_t val = 0;
+
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+	zassert_ok(kv_store_clear(&kv));
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+
+	bench_start(&add);
+	for (int i = 0; i < BENCH_INCREMENTS; i++)
+		zassert_ok(kv_store_counter_add(&kv, 0, 1));
+	bench_end(&add, "kv_store add");
+
+	bench_start(&res);
+	for (int i = 0; i < BENCH_INCREMENTS; i++)
+		val = kv_store_counter_get(&kv, 0);
+	bench_end(&res, "kv_store get");
+	zassert_equal(val, BENCH_INCREMENTS);
+
+	/* Start from a blank file system */
+	fs_unmount(&lfs_mnt);
+	zassert_ok(fs_mkfs(FS_LITTLEFS, (uintptr_t)FLASH_AREA_ID(lfs), NULL, 0));
+	zassert_ok(fs_mount(&lfs_mnt));
+
+	bench_start(&lfs);
+	for (int i = 0; i < BENCH_INCREMENTS; i++)
+		zassert_ok(bench_lfs_increment("/bench/count", &val));
+	bench_end(&lfs, "littlefs rmw");
+	zassert_equal(val, BENCH_INCREMENTS);
+
+	bench_start(&res);
+	for (int i = 0; i < BENCH_INCREMENTS; i++)
+		zassert_ok(bench_lfs_read("/bench/count", &val));
+	bench_end(&res, "littlefs read");
+
+	zassert_ok(fs_unmount(&lfs_mnt));
+
+	/* An append per increment against a metadata commit per increment */
+	zassert_true(add.counters.bytes_written < lfs.counters.bytes_written);
+}
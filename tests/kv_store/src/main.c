@@ -0,0 +1,112 @@
+#include <zephyr/ztest.h>
+
+#include <lib/kv_store/kv_store.h>
+
+#include <flash_sim_counters.h>
+
+#define TEST_BOOTS 0
+#define TEST_UPLINKS 1
+
+static struct kv_store kv;
+
+static void kv_store_before(void *f)
+{
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+	zassert_ok(kv_store_clear(&kv));
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+}
+
+ZTEST_SUITE(kv_store_tests, NULL, NULL, kv_store_before, NULL, NULL);
+
+/**
+ * @brief Counters survive a re-init and reads don't touch flash
+ *
+ */
+ZTEST(kv_store_tests, test_counters)
+{
+	struct flash_sim_counters start;
+	struct flash_sim_counters end;
+
+	zassert_equal(kv_store_counter_get(&kv, TEST_BOOTS), 0);
+
+	for (int i = 0; i < 3; i++)
+		zassert_ok(kv_store_counter_add(&kv, TEST_BOOTS, 1));
+
+	zassert_ok(kv_store_counter_add(&kv, TEST_UPLINKS, 10));
+
+	/* Like a reboot */
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+
+	zassert_ok(flash_sim_counters_get(&start));
+	zassert_equal(kv_store_counter_get(&kv, TEST_BOOTS), 3);
+	zassert_equal(kv_store_counter_get(&kv, TEST_UPLINKS), 10);
+	zassert_ok(flash_sim_counters_get(&end));
+	flash_sim_counters_diff(&end, &start);
+	zassert_equal(end.bytes_read, 0);
+
+	/* An increment is a single write */
+	zassert_ok(flash_sim_counters_get(&start));
+	zassert_ok(kv_store_counter_add(&kv, TEST_BOOTS, 1));
+	zassert_ok(flash_sim_counters_get(&end));
+	flash_sim_counters_diff(&end, &start);
+	zassert_equal(end.erase_calls, 0);
+	zassert_true(end.bytes_written <= 16);
+
+	zassert_equal(kv_store_counter_add(&kv, CONFIG_KV_STORE_COUNTERS, 1), -EINVAL);
+}
+
+/**
+ * @brief Plain values
+ *
+ */
+ZTEST(kv_store_tests, test_values)
+{
+	struct kv_store_stats stats;
+	char buf[8];
+
+	zassert_equal(kv_store_read(&kv, 1, buf, sizeof(buf)), -ENOENT);
+
+	zassert_ok(kv_store_write(&kv, 1, "abc", 4));
+	zassert_equal(kv_store_read(&kv, 1, buf, sizeof(buf)), 4);
+	zassert_mem_equal(buf, "abc", 4);
+
+	/* Same value again isn't written */
+	zassert_ok(kv_store_write(&kv, 1, "abc", 4));
+
+	kv_store_stats_get(&kv, &stats);
+	zassert_equal(stats.writes, 1);
+	zassert_equal(stats.unchanged, 1);
+
+	/* Counter ids are off limits */
+	zassert_equal(kv_store_write(&kv, KV_STORE_COUNTER_ID_BASE, "abc", 4), -EINVAL);
+	zassert_equal(kv_store_read(&kv, KV_STORE_COUNTER_ID_BASE, buf, sizeof(buf)), -EINVAL);
+}
+
+/**
+ * @brief Values survive garbage collection
+ *
+ * Enough increments to roll over every sector several times.
+ *
+ */
+ZTEST(kv_store_tests, test_gc)
+{
+	struct flash_sim_counters start;
+	struct flash_sim_counters end;
+	char buf[8];
+
+	zassert_ok(kv_store_write(&kv, 2, "keep", 5));
+
+	zassert_ok(flash_sim_counters_get(&start));
+
+	for (int i = 0; i < 3000; i++)
+		zassert_ok(kv_store_counter_add(&kv, TEST_UPLINKS, 1));
+
+	zassert_ok(flash_sim_counters_get(&end));
+	flash_sim_counters_diff(&end, &start);
+	zassert_true(end.erase_calls > 3);
+
+	zassert_ok(kv_store_init(&kv, FLASH_AREA_ID(nvs_storage)));
+	zassert_equal(kv_store_counter_get(&kv, TEST_UPLINKS), 3000);
+	zassert_equal(kv_store_read(&kv, 2, buf, sizeof(buf)), 5);
+	zassert_mem_equal(buf, "keep", 5);
+}
@@ -0,0 +1,357 @@
+#include <stdio.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+#include <zephyr/storage/flash_map.h>
+
+#include <flash_sim_counters.h>
+
+/*
+ * littlefs parameter matrix on a simulated w25q32jv (4 MB, 4 KB sectors).
+ * Time comes from the flash simulator's timing model so it reflects
+ * program/erase cost, not host CPU speed.
+ *
+ * Workloads match the tracker:
+ *  - small: 32 byte records synced every 16 (history through the write buffer)
+ *  - large: 256 byte records synced every record (store and forward segment
+ *    appends, one close per record)
+ *  - open/read: open a file, random 32 byte reads (history queries)
+ *  - mount: remount of the populated file system (boot)
+ */
+
+#define BENCH_SMALL_SIZE 32
+#define BENCH_SMALL_RECORDS 1024
+#define BENCH_SMALL_SYNC 16
+#define BENCH_LARGE_SIZE 256
+#define BENCH_LARGE_RECORDS 256
+#define BENCH_OPENS 50
+#define BENCH_READS 200
+
+/* Buffers sized for the largest profile */
+#define BENCH_CACHE_MAX 512
+#define BENCH_LOOKAHEAD_MAX 128
+
+/* A profile is picked if it needs at most this many % more program calls
+ * than the best one. The cheapest in RAM wins among those. */
+#define BENCH_PICK_TOLERANCE 5
+
+/* Caches littlefs holds at once: read, program and one per open file (the
+ * tracker keeps up to two open) */
+#define BENCH_CACHES 4
+
+FS_LITTLEFS_DECLARE_CUSTOM_CONFIG(bench_lfs, 16, 16, BENCH_CACHE_MAX, BENCH_LOOKAHEAD_MAX);
+static struct fs_mount_t lfs_mnt = {
+	.type = FS_LITTLEFS,
+	.fs_data = &bench_lfs,
+	.storage_dev = (void *)FLASH_AREA_ID(lfs),
+	.mnt_point = "/bench",
+};
+
+struct bench_profile
+{
+	uint16_t cache_size;
+	uint16_t lookahead_size;
+	int32_t block_cycles;
+};
+
+struct bench_append
+{
+	uint32_t bytes_per_sec;
+	uint32_t amplification; /* programmed bytes per 100 payload bytes */
+	struct flash_sim_counters counters;
+};
+
+struct bench_row
+{
+	struct bench_append small;
+	struct bench_append large;
+	uint32_t open_us;
+	uint32_t read_us;
+	uint32_t mount_ms;
+	uint32_t mount_read;
+};
+
+static const uint16_t cache_sizes[] = {64, 256, 512};
+static const uint16_t lookahead_sizes[] = {32, 128};
+static const int32_t block_cycles[] = {100, 512};
+
+/* What the tracker and samples/external_flash ship. Has to be what
+ * bench_pick() picks. */
+static const struct bench_profile tracker_profile = {
+	.cache_size = 256,
+	.lookahead_size = 128,
+	.block_cycles = 512,
+};
+
+/* Zephyr's defaults */
+static const struct bench_profile default_profile = {
+	.cache_size = 64,
+	.lookahead_size = 32,
+	.block_cycles = 512,
+};
+
+struct bench_result
+{
+	struct bench_profile profile;
+	struct bench_row row;
+};
+
+static struct bench_result results[ARRAY_SIZE(cache_sizes) * ARRAY_SIZE(lookahead_sizes) *
+				  ARRAY_SIZE(block_cycles)];
+static size_t results_count;
+
+static uint32_t bench_rand(uint32_t *p_state)
+{
+	*p_state = *p_state * 1103515245 + 12345;
+	return *p_state >> 16;
+}
+
+static void bench_format(const struct bench_profile *p_profile)
+{
+	fs_unmount(&lfs_mnt);
+
+	bench_lfs.cfg.cache_size = p_profile->cache_size;
+	bench_lfs.cfg.lookahead_size = p_profile->lookahead_size;
+	bench_lfs.cfg.block_cycles = p_profile->block_cycles;
+
+	zassert_ok(fs_mkfs(FS_LITTLEFS, (uintptr_t)FLASH_AREA_ID(lfs), &bench_lfs, 0));
+	zassert_ok(fs_mount(&lfs_mnt));
+}
+
+static void bench_append(const char *p_path, size_t size, int records, int sync_every,
+			 struct bench_append *p_res)
+{
+	struct fs_file_t file;
+	struct flash_sim_counters start;
+	uint8_t rec[BENCH_LARGE_SIZE] = {0};
+	uint32_t payload = size * records;
+
+	fs_file_t_init(&file);
+	zassert_ok(fs_open(&file, p_path, FS_O_CREATE | FS_O_APPEND | FS_O_WRITE));
+
+	zassert_ok(flash_sim_counters_get(&start));
+	int64_t ms = k_uptime_get();
+
+	for (int i = 0; i < records; i++)
+	{
+		memcpy(rec, &i, sizeof(i));
+		zassert_equal(fs_write(&file, rec, size), size);
+
+		if ((i + 1) % sync_every == 0)
+			zassert_ok(fs_sync(&file));
+	}
+
+	zassert_ok(fs_close(&file));
+
+	ms = k_uptime_get() - ms;
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	flash_sim_counters_diff(&p_res->counters, &start);
+
+	p_res->bytes_per_sec = ms ? (uint32_t)(payload * 1000LL / ms) : 0;
+	p_res->amplification = (uint64_t)p_res->counters.bytes_written * 100 / payload;
+}
+
+static void bench_read(struct bench_row *p_row)
+{
+	struct fs_file_t file;
+	uint8_t rec[BENCH_SMALL_SIZE];
+	uint32_t state = 1;
+
+	fs_file_t_init(&file);
+
+	/* Open latency */
+	uint32_t cycles = k_cycle_get_32();
+
+	for (int i = 0; i < BENCH_OPENS; i++)
+	{
+		zassert_ok(fs_open(&file, "/bench/small", FS_O_READ));
+		zassert_ok(fs_close(&file));
+	}
+
+	p_row->open_us = k_cyc_to_us_floor32(k_cycle_get_32() - cycles) / BENCH_OPENS;
+
+	/* Seek and read latency */
+	zassert_ok(fs_open(&file, "/bench/small", FS_O_READ));
+
+	cycles = k_cycle_get_32();
+
+	for (int i = 0; i < BENCH_READS; i++)
+	{
+		int idx = bench_rand(&state) % BENCH_SMALL_RECORDS;
+
+		zassert_ok(fs_seek(&file, idx * BENCH_SMALL_SIZE, FS_SEEK_SET));
+		zassert_equal(fs_read(&file, rec, sizeof(rec)), sizeof(rec));
+		zassert_mem_equal(rec, &idx, sizeof(idx));
+	}
+
+	p_row->read_us = k_cyc_to_us_floor32(k_cycle_get_32() - cycles) / BENCH_READS;
+
+	zassert_ok(fs_close(&file));
+}
+
+static void bench_mount(struct bench_row *p_row)
+{
+	struct flash_sim_counters start;
+	struct flash_sim_counters end;
+
+	zassert_ok(fs_unmount(&lfs_mnt));
+
+	zassert_ok(flash_sim_counters_get(&start));
+	int64_t ms = k_uptime_get();
+
+	zassert_ok(fs_mount(&lfs_mnt));
+
+	p_row->mount_ms = k_uptime_get() - ms;
+	zassert_ok(flash_sim_counters_get(&end));
+	flash_sim_counters_diff(&end, &start);
+	p_row->mount_read = end.bytes_read;
+}
+
+static void bench_run(const struct bench_profile *p_profile, struct bench_row *p_row)
+{
+	char name[32];
+
+	bench_format(p_profile);
+
+	bench_append("/bench/small", BENCH_SMALL_SIZE, BENCH_SMALL_RECORDS, BENCH_SMALL_SYNC,
+		     &p_row->small);
+	bench_append("/bench/large", BENCH_LARGE_SIZE, BENCH_LARGE_RECORDS, 1, &p_row->large);
+	bench_read(p_row);
+	bench_mount(p_row);
+
+	zassert_ok(fs_unmount(&lfs_mnt));
+
+	snprintf(name, sizeof(name), "c%u/la%u/bc%d", p_profile->cache_size,
+		 p_profile->lookahead_size, p_profile->block_cycles);
+
+	TC_PRINT("%-16s %6u x%u.%02u %5u %4u | %6u x%u.%02u %5u %4u | %5u %5u | %4u %7u\n",
+		 name,
+		 p_row->small.bytes_per_sec,
+		 p_row->small.amplification / 100, p_row->small.amplification % 100,
+		 p_row->small.counters.write_calls, p_row->small.counters.erase_calls,
+		 p_row->large.bytes_per_sec,
+		 p_row->large.amplification / 100, p_row->large.amplification % 100,
+		 p_row->large.counters.write_calls, p_row->large.counters.erase_calls,
+		 p_row->open_us, p_row->read_us,
+		 p_row->mount_ms, p_row->mount_read);
+}
+
+static void bench_header(void)
+{
+	TC_PRINT("%-16s %-24s | %-24s | %-11s | %s\n",
+		 "", "small: B/s amp prog erase", "large: B/s amp prog erase",
+		 "open/read us", "mount ms/B read");
+}
+
+static uint32_t bench_writes(const struct bench_row *p_row)
+{
+	return p_row->small.counters.write_calls + p_row->large.counters.write_calls;
+}
+
+static uint32_t bench_ram(const struct bench_profile *p_profile)
+{
+	return p_profile->cache_size * BENCH_CACHES + p_profile->lookahead_size;
+}
+
+/* Every combination of cache, lookahead and block cycles, once */
+static void bench_matrix(void)
+{
+	if (results_count)
+		return;
+
+	bench_header();
+
+	for (size_t c = 0; c < ARRAY_SIZE(cache_sizes); c++)
+		for (size_t l = 0; l < ARRAY_SIZE(lookahead_sizes); l++)
+			for (size_t b = 0; b < ARRAY_SIZE(block_cycles); b++)
+			{
+				struct bench_result *p_res = &results[results_count++];
+
+				p_res->profile.cache_size = cache_sizes[c];
+				p_res->profile.lookahead_size = lookahead_sizes[l];
+				p_res->profile.block_cycles = block_cycles[b];
+
+				bench_run(&p_res->profile, &p_res->row);
+			}
+}
+
+/* Fewest program calls within the tolerance, then least RAM, then the
+ * faster mount. Ties keep the larger block_cycles (fewer relocations). */
+static const struct bench_result *bench_pick(void)
+{
+	uint32_t best = UINT32_MAX;
+	const struct bench_result *p_pick = NULL;
+
+	for (size_t i = 0; i < results_count; i++)
+		best = MIN(best, bench_writes(&results[i].row));
+
+	for (size_t i = 0; i < results_count; i++)
+	{
+		const struct bench_result *p_res = &results[i];
+
+		if ((uint64_t)bench_writes(&p_res->row) * 100 > (uint64_t)best * (100 + BENCH_PICK_TOLERANCE))
+			continue;
+
+		if (p_pick == NULL || bench_ram(&p_res->profile) < bench_ram(&p_pick->profile) ||
+		    (bench_ram(&p_res->profile) == bench_ram(&p_pick->profile) &&
+		     (p_res->row.mount_ms < p_pick->row.mount_ms ||
+		      (p_res->row.mount_ms == p_pick->row.mount_ms &&
+		       p_res->profile.block_cycles > p_pick->profile.block_cycles))))
+			p_pick = p_res;
+	}
+
+	return p_pick;
+}
+
+ZTEST_SUITE(littlefs_bench, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Every combination, and the profile the numbers pick
+ *
+ */
+ZTEST(littlefs_bench, test_matrix)
+{
+	bench_matrix();
+
+	const struct bench_result *p_pick = bench_pick();
+
+	zassert_not_null(p_pick);
+
+	TC_PRINT("Pick (%u program calls, %u B RAM):\n", bench_writes(&p_pick->row),
+		 bench_ram(&p_pick->profile));
+	TC_PRINT("CONFIG_FS_LITTLEFS_CACHE_SIZE=%u\n", p_pick->profile.cache_size);
+	TC_PRINT("CONFIG_FS_LITTLEFS_LOOKAHEAD_SIZE=%u\n", p_pick->profile.lookahead_size);
+	TC_PRINT("CONFIG_FS_LITTLEFS_BLOCK_CYCLES=%d\n", p_pick->profile.block_cycles);
+}
+
+/**
+ * @brief The shipped profile is the one the numbers pick, and beats Zephyr's
+ * defaults
+ *
+ */
+ZTEST(littlefs_bench, test_tracker_profile)
+{
+	struct bench_row def;
+	struct bench_row tuned;
+
+	bench_matrix();
+
+	const struct bench_result *p_pick = bench_pick();
+
+	zassert_not_null(p_pick);
+	zassert_equal(p_pick->profile.cache_size, tracker_profile.cache_size,
+		      "Ship CONFIG_FS_LITTLEFS_CACHE_SIZE=%u", p_pick->profile.cache_size);
+	zassert_equal(p_pick->profile.lookahead_size, tracker_profile.lookahead_size,
+		      "Ship CONFIG_FS_LITTLEFS_LOOKAHEAD_SIZE=%u", p_pick->profile.lookahead_size);
+	zassert_equal(p_pick->profile.block_cycles, tracker_profile.block_cycles,
+		      "Ship CONFIG_FS_LITTLEFS_BLOCK_CYCLES=%d", p_pick->profile.block_cycles);
+
+	bench_header();
+	bench_run(&default_profile, &def);
+	bench_run(&tracker_profile, &tuned);
+
+	zassert_true(tuned.small.counters.write_calls < def.small.counters.write_calls);
+	zassert_true(tuned.large.counters.write_calls < def.large.counters.write_calls);
+	zassert_true(tuned.small.bytes_per_sec >= def.small.bytes_per_sec);
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/lz/lz.h>
+
+#define TEST_SIZE 1024
+
+static struct lz_ctx ctx;
+static uint8_t raw[TEST_SIZE];
+static uint8_t packed[LZ_BOUND(TEST_SIZE)];
+static uint8_t unpacked[TEST_SIZE];
+
+static uint32_t test_rand(uint32_t *p_state)
+{
+	*p_state = *p_state * 1103515245 + 12345;
+	return *p_state >> 16;
+}
+
+/* Text stand in for a run of encoded fixes from a parked tracker */
+static size_t test_make_fixes(uint8_t *p_buf, size_t size)
+{
+	size_t len = 0;
+	uint32_t state = 7;
+
+	for (int i = 0; len + 80 < size; i++)
+	{
+		len += snprintf((char *)&p_buf[len], size - len,
+				"{lat:41.12345%u,lng:-71.54321%u,alt:3%u,acc:%u,spd:0,ts:16900000%02u}",
+				test_rand(&state) % 10, test_rand(&state) % 10,
+				test_rand(&state) % 10, 5 + test_rand(&state) % 5, i % 100);
+	}
+
+	return len;
+}
+
+static int test_roundtrip(const uint8_t *p_data, size_t len)
+{
+	int packed_len = lz_compress(&ctx, p_data, len, packed, sizeof(packed));
+	zassert_true(packed_len >= 0);
+	zassert_true(packed_len <= LZ_BOUND(len));
+
+	int unpacked_len = lz_decompress(packed, packed_len, unpacked, sizeof(unpacked));
+	zassert_equal(unpacked_len, len);
+	zassert_mem_equal(unpacked, p_data, len);
+
+	return packed_len;
+}
+
+ZTEST_SUITE(lz_tests, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Repetitive records shrink
+ *
+ */
+ZTEST(lz_tests, test_fixes)
+{
+	size_t len = test_make_fixes(raw, sizeof(raw));
+
+	uint32_t cycles = k_cycle_get_32();
+	int packed_len = test_roundtrip(raw, len);
+	cycles = k_cycle_get_32() - cycles;
+
+	TC_PRINT("fixes: %u -> %i bytes (%u%%), %u cycles for both ways\n",
+		 len, packed_len, packed_len * 100 / len, cycles);
+
+	zassert_true(packed_len * 2 < len);
+}
+
+/**
+ * @brief Runs, empty input and incompressible input
+ *
+ */
+ZTEST(lz_tests, test_edges)
+{
+	uint32_t state = 1;
+
+	/* Overlapping matches */
+	memset(raw, 'a', sizeof(raw));
+	zassert_true(test_roundtrip(raw, sizeof(raw)) < sizeof(raw) / 8);
+
+	zassert_equal(test_roundtrip(raw, 0), 0);
+	zassert_equal(test_roundtrip(raw, 2), 3);
+
+	for (size_t i = 0; i < sizeof(raw); i++)
+		raw[i] = test_rand(&state);
+
+	test_roundtrip(raw, sizeof(raw));
+}
+
+/**
+ * @brief Short output buffers and corrupt input are caught
+ *
+ */
+ZTEST(lz_tests, test_errors)
+{
+	size_t len = test_make_fixes(raw, sizeof(raw));
+
+	int packed_len = lz_compress(&ctx, raw, len, packed, sizeof(packed));
+	zassert_true(packed_len > 0);
+
+	zassert_equal(lz_compress(&ctx, raw, len, packed, packed_len - 1), -ENOSPC);
+	zassert_equal(lz_decompress(packed, packed_len, unpacked, len - 1), -ENOSPC);
+
+	/* First item as a match pointing before the start */
+	uint8_t bad[] = {0x01, 0x05, 0x00};
+	zassert_equal(lz_decompress(bad, sizeof(bad), unpacked, sizeof(unpacked)), -EINVAL);
+}
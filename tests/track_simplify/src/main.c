@@ -0,0 +1,172 @@
+#include <zephyr/ztest.h>
+
+#include <math.h>
+
+#include <lib/track/track_simplify.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(track_simplify_tests);
+
+/* Roughly 1 m in degrees of latitude */
+#define DEG_PER_M (1.0 / 111194.93)
+
+#define TOLERANCE_M 10.0f
+
+static struct track_simplify track;
+
+/* Deterministic noise in [-amplitude, amplitude] meters */
+static double noise_m(uint32_t *p_seed, double amplitude)
+{
+	*p_seed = *p_seed * 1103515245 + 12345;
+
+	return ((double)((*p_seed >> 16) & 0x7fff) / 0x7fff * 2.0 - 1.0) * amplitude;
+}
+
+/* Pushes a point and records it as sent if the simplifier says so */
+static void push(struct track_simplify_point *p_point, struct track_simplify_point *p_sent,
+		 size_t *p_sent_count, struct track_simplify_point *p_previous)
+{
+	switch (track_simplify_push(&track, p_point))
+	{
+	case TRACK_SIMPLIFY_EMIT_CURRENT:
+		p_sent[(*p_sent_count)++] = *p_point;
+		break;
+	case TRACK_SIMPLIFY_EMIT_PREVIOUS:
+		p_sent[(*p_sent_count)++] = *p_previous;
+		break;
+	default:
+		break;
+	}
+
+	*p_previous = *p_point;
+}
+
+static void report(const char *name)
+{
+	struct track_simplify_stats stats;
+
+	track_simplify_stats_get(&track, &stats);
+
+	LOG_INF("%s: in %u out %u dropped %u max error %d.%02d m mean error %d.%02d m", name,
+		stats.points_in, stats.points_out, stats.points_dropped,
+		(int)stats.max_error_m, (int)(stats.max_error_m * 100) % 100,
+		(int)(stats.sum_error_m / MAX(stats.points_dropped, 1)),
+		(int)(stats.sum_error_m * 100 / MAX(stats.points_dropped, 1)) % 100);
+}
+
+ZTEST_SUITE(track_simplify_tests, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test a straight noisy road
+ *
+ * Every point within the error bound of the straight line should be dropped
+ *
+ */
+ZTEST(track_simplify_tests, test_straight_line)
+{
+	struct track_simplify_point sent[100];
+	struct track_simplify_point previous = {0};
+	size_t sent_count = 0;
+	uint32_t seed = 1;
+
+	track_simplify_init(&track, TOLERANCE_M, 0);
+
+	/* 100 points, 20 m apart heading north with +-3 m of noise */
+	for (int i = 0; i < 100; i++)
+	{
+		struct track_simplify_point point = {
+			.ts = i * 1000,
+			.lat = 45.0 + (i * 20.0 + noise_m(&seed, 3.0)) * DEG_PER_M,
+			.lng = -122.0 + noise_m(&seed, 3.0) * DEG_PER_M,
+		};
+
+		push(&point, sent, &sent_count, &previous);
+	}
+
+	zassert_true(track_simplify_flush(&track));
+	sent[sent_count++] = previous;
+
+	report("straight");
+
+	struct track_simplify_stats stats;
+	track_simplify_stats_get(&track, &stats);
+
+	/* Start and end of the road plus the odd forced vertex once the window is full */
+	zassert_true(sent_count <= 2 + 100 / CONFIG_TRACK_SIMPLIFY_WINDOW, "Sent %u", sent_count);
+	zassert_equal(stats.points_in, 100);
+	zassert_equal(stats.points_out + stats.points_dropped, 100);
+	zassert_true(stats.max_error_m <= TOLERANCE_M);
+}
+
+/**
+ * @brief Test a route with a corner
+ *
+ * The corner should be kept and the error bound respected
+ *
+ */
+ZTEST(track_simplify_tests, test_corner)
+{
+	struct track_simplify_point sent[40];
+	struct track_simplify_point previous = {0};
+	size_t sent_count = 0;
+
+	track_simplify_init(&track, TOLERANCE_M, 0);
+
+	/* 10 points north and then 10 points east, 50 m apart */
+	for (int i = 0; i < 20; i++)
+	{
+		int north = MIN(i, 10);
+		int east = MAX(i - 10, 0);
+
+		struct track_simplify_point point = {
+			.ts = i * 1000,
+			.lat = 45.0 + north * 50.0 * DEG_PER_M,
+			.lng = -122.0 + east * 50.0 * DEG_PER_M / 0.70710678,
+		};
+
+		push(&point, sent, &sent_count, &previous);
+	}
+
+	zassert_true(track_simplify_flush(&track));
+	sent[sent_count++] = previous;
+
+	report("corner");
+
+	/* Start, corner and end */
+	zassert_equal(sent_count, 3, "Sent %u", sent_count);
+	zassert_within(sent[1].lat, 45.0 + 500.0 * DEG_PER_M, DEG_PER_M);
+	zassert_within(sent[1].lng, -122.0, DEG_PER_M);
+}
+
+/**
+ * @brief Test stationary fixes
+ *
+ * Nothing but the heartbeat should go out while parked
+ *
+ */
+ZTEST(track_simplify_tests, test_max_hold)
+{
+	struct track_simplify_point sent[20];
+	struct track_simplify_point previous = {0};
+	size_t sent_count = 0;
+
+	track_simplify_init(&track, TOLERANCE_M, 10000);
+
+	/* 20 identical fixes a second apart */
+	for (int i = 0; i < 20; i++)
+	{
+		struct track_simplify_point point = {
+			.ts = i * 1000,
+			.lat = 45.0,
+			.lng = -122.0,
+		};
+
+		push(&point, sent, &sent_count, &previous);
+	}
+
+	report("parked");
+
+	/* First fix and one every 10 seconds */
+	zassert_equal(sent_count, 2, "Sent %u", sent_count);
+	zassert_equal(sent[1].ts, 10000);
+}
@@ -0,0 +1,105 @@
+#include <zephyr/ztest.h>
+
+#include <lib/ts_store/ts_store.h>
+
+#include <flash_sim_counters.h>
+
+#include "ts_store_test.h"
+
+/*
+ * Query cost against the amount of stored data. One 24 byte record per
+ * minute (a GPS fix) for 1 to 7 days, then a one hour query on the last
+ * day and a query for everything as the scan baseline.
+ */
+
+#define BENCH_PERIOD_MS (60 * MSEC_PER_SEC)
+#define BENCH_DAY_MS (24 * 60 * 60 * MSEC_PER_SEC)
+#define BENCH_HOUR_MS (60 * 60 * MSEC_PER_SEC)
+
+extern struct ts_store store;
+
+static const struct ts_store_config bench_config = {
+	.p_dir = TS_STORE_TEST_DIR,
+	.segment_blocks = 64,
+	.max_segments = CONFIG_TS_STORE_MAX_SEGMENTS,
+};
+
+struct bench_query
+{
+	int count;
+	int64_t ms;
+	struct ts_store_stats stats;
+	struct flash_sim_counters counters;
+};
+
+static int bench_cb(int64_t ts, const uint8_t *p_data, size_t len, void *p_user)
+{
+	return 0;
+}
+
+static void bench_query(int64_t from, int64_t to, struct bench_query *p_res)
+{
+	struct ts_store_stats start_stats;
+	struct flash_sim_counters start;
+
+	ts_store_stats_get(&store, &start_stats);
+	zassert_ok(flash_sim_counters_get(&start));
+	p_res->ms = k_uptime_get();
+
+	p_res->count = ts_store_query(&store, from, to, bench_cb, NULL);
+
+	p_res->ms = k_uptime_get() - p_res->ms;
+	zassert_ok(flash_sim_counters_get(&p_res->counters));
+	flash_sim_counters_diff(&p_res->counters, &start);
+	ts_store_stats_get(&store, &p_res->stats);
+	p_res->stats.blocks_read -= start_stats.blocks_read;
+	p_res->stats.index_reads -= start_stats.index_reads;
+}
+
+ZTEST_SUITE(ts_store_bench, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Query time for 1 to 7 days of fixes
+ *
+ */
+ZTEST(ts_store_bench, test_query_days)
+{
+	static const int days[] = {1, 2, 4, 7};
+	uint8_t rec[24] = {0};
+
+	TC_PRINT("days records |  1h query: n  ms  blocks idx  flash B | full scan: ms  blocks  flash B\n");
+
+	for (int d = 0; d < ARRAY_SIZE(days); d++)
+	{
+		struct bench_query hour;
+		struct bench_query all;
+		int64_t end = (int64_t)days[d] * BENCH_DAY_MS;
+
+		ts_store_test_fs_reset();
+		zassert_ok(ts_store_init(&store, &bench_config));
+
+		for (int64_t ts = 0; ts < end; ts += BENCH_PERIOD_MS)
+			zassert_ok(ts_store_append(&store, ts, rec, sizeof(rec)));
+
+		zassert_ok(ts_store_sync(&store));
+
+		/* Noon on the last day */
+		int64_t from = end - BENCH_DAY_MS / 2;
+
+		bench_query(from, from + BENCH_HOUR_MS - 1, &hour);
+		bench_query(0, end, &all);
+
+		zassert_equal(hour.count, 60);
+
+		TC_PRINT("%4d %7d | %14d %3lld %7u %3u %8u | %13lld %7u %8u\n",
+			 days[d], all.count,
+			 hour.count, hour.ms, hour.stats.blocks_read, hour.stats.index_reads,
+			 hour.counters.bytes_read,
+			 all.ms, all.stats.blocks_read, all.counters.bytes_read);
+
+		/* Cost of a short query shouldn't grow with the data */
+		zassert_true(hour.stats.blocks_read <= 8, "%u blocks", hour.stats.blocks_read);
+
+		zassert_ok(ts_store_close(&store));
+	}
+}
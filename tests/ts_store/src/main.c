@@ -0,0 +1,199 @@
+#include <zephyr/ztest.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+
+#include <lib/ts_store/ts_store.h>
+
+#include "ts_store_test.h"
+
+FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(test_lfs);
+static struct fs_mount_t lfs_mnt = {
+	.type = FS_LITTLEFS,
+	.fs_data = &test_lfs,
+	.storage_dev = (void *)FLASH_AREA_ID(lfs),
+	.mnt_point = "/lfs",
+};
+
+struct ts_store store;
+
+static const struct ts_store_config config = {
+	.p_dir = TS_STORE_TEST_DIR,
+	.segment_blocks = 4,
+	.max_segments = 4,
+};
+
+struct query_result
+{
+	uint32_t count;
+	int64_t first;
+	int64_t last;
+	bool ordered;
+};
+
+static int query_cb(int64_t ts, const uint8_t *p_data, size_t len, void *p_user)
+{
+	struct query_result *p_res = p_user;
+
+	if (p_res->count == 0)
+		p_res->first = ts;
+	else if (ts < p_res->last)
+		p_res->ordered = false;
+
+	/* Record holds its own timestamp */
+	zassert_equal(len, sizeof(ts));
+	zassert_mem_equal(p_data, &ts, sizeof(ts));
+
+	p_res->last = ts;
+	p_res->count++;
+
+	return 0;
+}
+
+static int query(int64_t from, int64_t to, struct query_result *p_res)
+{
+	memset(p_res, 0, sizeof(*p_res));
+	p_res->ordered = true;
+
+	return ts_store_query(&store, from, to, query_cb, p_res);
+}
+
+void ts_store_test_fill(struct ts_store *p_store, int64_t start, int64_t step, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int64_t ts = start + i * step;
+
+		zassert_ok(ts_store_append(p_store, ts, &ts, sizeof(ts)));
+	}
+
+	zassert_ok(ts_store_sync(p_store));
+}
+
+void ts_store_test_fs_reset(void)
+{
+	fs_unmount(&lfs_mnt);
+	zassert_ok(fs_mkfs(FS_LITTLEFS, (uintptr_t)FLASH_AREA_ID(lfs), NULL, 0));
+	zassert_ok(fs_mount(&lfs_mnt));
+	zassert_ok(fs_mkdir(TS_STORE_TEST_DIR));
+}
+
+static void before(void *fixture)
+{
+	ts_store_test_fs_reset();
+	zassert_ok(ts_store_init(&store, &config));
+}
+
+static void after(void *fixture)
+{
+	zassert_ok(ts_store_close(&store));
+}
+
+ZTEST_SUITE(ts_store_tests, NULL, NULL, before, after, NULL);
+
+/**
+ * @brief Range queries return exactly the records in range
+ *
+ */
+ZTEST(ts_store_tests, test_range)
+{
+	struct query_result res;
+
+	/* 10 s apart, across several blocks and segments */
+	ts_store_test_fill(&store, 1000, 10, 300);
+
+	zassert_equal(query(1000, 3990, &res), 300);
+	zassert_equal(res.first, 1000);
+	zassert_equal(res.last, 3990);
+	zassert_true(res.ordered);
+
+	zassert_equal(query(1505, 2000, &res), 50);
+	zassert_equal(res.first, 1510);
+	zassert_equal(res.last, 2000);
+	zassert_true(res.ordered);
+
+	zassert_equal(query(0, 999, &res), 0);
+	zassert_equal(query(4000, 5000, &res), 0);
+}
+
+/**
+ * @brief Range queries don't read the whole log
+ *
+ */
+ZTEST(ts_store_tests, test_seek)
+{
+	struct query_result res;
+	struct ts_store_stats before;
+	struct ts_store_stats after;
+
+	ts_store_test_fill(&store, 0, 1, 120);
+
+	ts_store_stats_get(&store, &before);
+	zassert_equal(query(100, 100, &res), 1);
+	ts_store_stats_get(&store, &after);
+
+	/* Block holding the record, maybe one more to find the end */
+	zassert_true(after.blocks_read - before.blocks_read <= 2);
+}
+
+/**
+ * @brief Timestamps can't go backwards
+ *
+ */
+ZTEST(ts_store_tests, test_order)
+{
+	int64_t ts = 100;
+
+	zassert_ok(ts_store_append(&store, ts, &ts, sizeof(ts)));
+	zassert_ok(ts_store_append(&store, ts, &ts, sizeof(ts)));
+
+	ts = 99;
+	zassert_equal(ts_store_append(&store, ts, &ts, sizeof(ts)), -EINVAL);
+}
+
+/**
+ * @brief Oldest segments are deleted beyond the limit
+ *
+ */
+ZTEST(ts_store_tests, test_retention)
+{
+	struct query_result res;
+	struct ts_store_stats stats;
+
+	/* More than max_segments * segment_blocks blocks */
+	ts_store_test_fill(&store, 0, 1, 2000);
+
+	ts_store_stats_get(&store, &stats);
+	zassert_true(stats.segments_deleted > 0);
+
+	zassert_true(query(0, 2000, &res) > 0);
+	zassert_true(res.first > 0);
+	zassert_equal(res.last, 1999);
+	zassert_true(res.ordered);
+}
+
+/**
+ * @brief Store picks up where it left off after a reset
+ *
+ */
+ZTEST(ts_store_tests, test_recovery)
+{
+	struct query_result res;
+
+	ts_store_test_fill(&store, 0, 1, 150);
+
+	/* Like a reset */
+	zassert_ok(ts_store_close(&store));
+	zassert_ok(ts_store_init(&store, &config));
+
+	/* Still in order */
+	int64_t ts = 149;
+
+	zassert_ok(ts_store_append(&store, ts, &ts, sizeof(ts)));
+	ts = 148;
+	zassert_equal(ts_store_append(&store, ts, &ts, sizeof(ts)), -EINVAL);
+
+	ts_store_test_fill(&store, 150, 1, 50);
+
+	zassert_equal(query(0, 199, &res), 201);
+	zassert_true(res.ordered);
+}
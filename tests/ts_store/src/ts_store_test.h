@@ -0,0 +1,14 @@
+#ifndef TS_STORE_TEST_H
+#define TS_STORE_TEST_H
+
+#include <lib/ts_store/ts_store.h>
+
+#define TS_STORE_TEST_DIR "/lfs/ts"
+
+/* Appends count records (holding their timestamp) and syncs */
+void ts_store_test_fill(struct ts_store *p_store, int64_t start, int64_t step, uint32_t count);
+
+/* Fresh file system with an empty store directory */
+void ts_store_test_fs_reset(void);
+
+#endif
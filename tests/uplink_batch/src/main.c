@@ -0,0 +1,314 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/uplink_batch/uplink_batch.h>
+
+/* Two topics of 64 bytes each */
+#define TEST_MEM_SIZE 128
+
+/* Not urgent */
+#define TEST_PRIO 1
+
+static uint8_t mem[TEST_MEM_SIZE];
+static struct uplink_batch batch;
+
+/* What the send callback saw */
+static struct
+{
+	char topic[CONFIG_UPLINK_BATCH_TOPIC_LEN];
+	uint8_t packed[TEST_MEM_SIZE];
+	size_t len;
+	uint8_t latest[TEST_MEM_SIZE];
+	size_t latest_len;
+	uint16_t records;
+	int calls;
+	int err;
+
+	/* Topics in the order they were sent */
+	char order[CONFIG_UPLINK_BATCH_TOPICS][CONFIG_UPLINK_BATCH_TOPIC_LEN];
+
+	/* What the expired callback saw */
+	char expired_topic[CONFIG_UPLINK_BATCH_TOPIC_LEN];
+	uint8_t expired_prio;
+	uint16_t expired_records;
+	int expired_calls;
+} sink;
+
+static int test_send(const char *p_topic, const uint8_t *p_packed, size_t len,
+		     const uint8_t *p_latest, size_t latest_len, uint16_t records, void *p_user)
+{
+	if (sink.err)
+		return sink.err;
+
+	strcpy(sink.topic, p_topic);
+	memcpy(sink.packed, p_packed, len);
+	sink.len = len;
+	memcpy(sink.latest, p_latest, latest_len);
+	sink.latest_len = latest_len;
+	sink.records = records;
+
+	if (sink.calls < CONFIG_UPLINK_BATCH_TOPICS)
+		strcpy(sink.order[sink.calls], p_topic);
+
+	sink.calls++;
+
+	return 0;
+}
+
+static void test_expired(const char *p_topic, uint8_t prio, const uint8_t *p_packed, size_t len,
+			 const uint8_t *p_latest, size_t latest_len, uint16_t records, void *p_user)
+{
+	strcpy(sink.expired_topic, p_topic);
+	sink.expired_prio = prio;
+	sink.expired_records = records;
+	sink.expired_calls++;
+}
+
+static void uplink_batch_before(void *f)
+{
+	memset(&sink, 0, sizeof(sink));
+	uplink_batch_init(&batch, mem, sizeof(mem), 1000, test_send, test_expired, NULL);
+}
+
+ZTEST_SUITE(uplink_batch_tests, NULL, NULL, uplink_batch_before, NULL, NULL);
+
+/**
+ * @brief Records of a topic go out as one CBOR array
+ *
+ * Each record is a one byte CBOR unsigned int (0x00 - 0x17). 61 fit in the
+ * 64 byte slot after the header so the 62nd sends the first 61.
+ *
+ */
+ZTEST(uplink_batch_tests, test_size)
+{
+	struct uplink_batch_stats stats;
+
+	for (uint8_t i = 0; i < 62; i++)
+	{
+		uint8_t rec = i % 24;
+
+		zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+					    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+	}
+
+	zassert_equal(sink.calls, 1);
+	zassert_equal(sink.records, 61);
+	zassert_equal(strcmp(sink.topic, "gps"), 0);
+
+	/* 0x98 0x3d is an array of 61 */
+	zassert_equal(sink.len, 63);
+	zassert_equal(sink.packed[0], 0x98);
+	zassert_equal(sink.packed[1], 61);
+	zassert_equal(sink.packed[2], 0);
+	zassert_equal(sink.packed[62], 60 % 24);
+	zassert_equal(sink.latest_len, 1);
+	zassert_equal(sink.latest[0], 60 % 24);
+
+	/* The last one is still waiting. Short arrays have a one byte header. */
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.len, 2);
+	zassert_equal(sink.packed[0], 0x81);
+	zassert_equal(sink.packed[1], 61 % 24);
+
+	uplink_batch_stats_get(&batch, &stats);
+	zassert_equal(stats.records, 62);
+	zassert_equal(stats.uplinks, 2);
+	zassert_equal(stats.reasons[UPLINK_BATCH_FLUSH_SIZE], 1);
+	zassert_equal(stats.reasons[UPLINK_BATCH_FLUSH_MANUAL], 1);
+
+	/* Never fits */
+	uint8_t big[TEST_MEM_SIZE / 2];
+	zassert_equal(uplink_batch_put(&batch, "gps", big, sizeof(big),
+				       TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0), -EMSGSIZE);
+}
+
+/**
+ * @brief Topics are kept apart. An urgent record sends them all, its own
+ * topic first.
+ *
+ */
+ZTEST(uplink_batch_tests, test_urgent)
+{
+	uint8_t rec = 1;
+
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_ok(uplink_batch_put(&batch, "motion", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+
+	/* Both slots are taken */
+	zassert_equal(uplink_batch_put(&batch, "other", &rec, sizeof(rec),
+				       TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0), -ENOSPC);
+	zassert_equal(sink.calls, 0);
+
+	zassert_ok(uplink_batch_put(&batch, "motion", &rec, sizeof(rec),
+				    UPLINK_BATCH_PRIO_URGENT, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_equal(sink.calls, 2);
+	zassert_equal(strcmp(sink.order[0], "motion"), 0);
+	zassert_equal(strcmp(sink.order[1], "gps"), 0);
+
+	/* Empty slots can be reused by another topic */
+	zassert_ok(uplink_batch_put(&batch, "other", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+}
+
+/**
+ * @brief Age is measured from the oldest record of each topic
+ *
+ */
+ZTEST(uplink_batch_tests, test_age)
+{
+	uint8_t rec = 1;
+
+	zassert_equal(uplink_batch_deadline(&batch), INT64_MAX);
+
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 100));
+	zassert_ok(uplink_batch_put(&batch, "motion", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 500));
+	zassert_equal(uplink_batch_deadline(&batch), 1100);
+
+	zassert_ok(uplink_batch_poll(&batch, 1099));
+	zassert_equal(sink.calls, 0);
+
+	zassert_ok(uplink_batch_poll(&batch, 1100));
+	zassert_equal(sink.calls, 1);
+	zassert_equal(strcmp(sink.topic, "gps"), 0);
+	zassert_equal(uplink_batch_deadline(&batch), 1500);
+}
+
+/**
+ * @brief Records survive a failed send
+ *
+ */
+ZTEST(uplink_batch_tests, test_send_error)
+{
+	uint8_t rec = 1;
+	struct uplink_batch_stats stats;
+
+	sink.err = -ENOTCONN;
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+				    UPLINK_BATCH_PRIO_URGENT, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_equal(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL), -ENOTCONN);
+
+	sink.err = 0;
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.records, 2);
+
+	uplink_batch_stats_get(&batch, &stats);
+	zassert_equal(stats.send_errors, 2);
+	zassert_equal(stats.uplinks, 1);
+}
+
+/**
+ * @brief The more important class goes first, then the earlier deadline.
+ * A failure leaves the rest for the next window.
+ *
+ */
+ZTEST(uplink_batch_tests, test_order)
+{
+	uint8_t rec = 1;
+
+	zassert_ok(uplink_batch_put(&batch, "bulk", &rec, sizeof(rec),
+				    3, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec, sizeof(rec),
+				    2, UPLINK_BATCH_NO_DEADLINE, 10));
+
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.calls, 2);
+	zassert_equal(strcmp(sink.order[0], "gps"), 0);
+	zassert_equal(strcmp(sink.order[1], "bulk"), 0);
+
+	/* Same class. Earlier deadline first. */
+	memset(&sink, 0, sizeof(sink));
+	zassert_ok(uplink_batch_put(&batch, "late", &rec, sizeof(rec), 2, 5000, 0));
+	zassert_ok(uplink_batch_put(&batch, "soon", &rec, sizeof(rec), 2, 2000, 10));
+
+	sink.err = -ENOTCONN;
+	zassert_equal(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL), -ENOTCONN);
+
+	/* A batch takes the best class of its records */
+	zassert_ok(uplink_batch_put(&batch, "late", &rec, sizeof(rec),
+				    1, UPLINK_BATCH_NO_DEADLINE, 20));
+
+	sink.err = 0;
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.calls, 2);
+	zassert_equal(strcmp(sink.order[0], "late"), 0);
+	zassert_equal(strcmp(sink.order[1], "soon"), 0);
+}
+
+/**
+ * @brief Records still waiting at their deadline are expired, not sent.
+ * Newer records of the batch keep waiting.
+ *
+ */
+ZTEST(uplink_batch_tests, test_deadline)
+{
+	uint8_t rec[] = {1, 2, 3};
+	struct uplink_batch_stats stats;
+
+	zassert_ok(uplink_batch_put(&batch, "diag", &rec[0], 1, 2, 300, 0));
+	zassert_ok(uplink_batch_put(&batch, "diag", &rec[1], 1, 2, 500, 100));
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec[0], 1,
+				    TEST_PRIO, UPLINK_BATCH_NO_DEADLINE, 0));
+	zassert_equal(uplink_batch_deadline(&batch), 300);
+	zassert_equal(uplink_batch_expiry(&batch), 300);
+
+	zassert_ok(uplink_batch_poll(&batch, 299));
+	zassert_equal(sink.expired_calls, 0);
+
+	/* Only the oldest one is past its deadline */
+	zassert_ok(uplink_batch_poll(&batch, 300));
+	zassert_equal(sink.calls, 0);
+	zassert_equal(sink.expired_calls, 1);
+	zassert_equal(strcmp(sink.expired_topic, "diag"), 0);
+	zassert_equal(sink.expired_prio, 2);
+	zassert_equal(sink.expired_records, 1);
+	zassert_equal(uplink_batch_expiry(&batch), 500);
+
+	/* The newer one goes out with the next */
+	zassert_ok(uplink_batch_put(&batch, "diag", &rec[2], 1, 2, 2000, 400));
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.calls, 2);
+	zassert_equal(strcmp(sink.order[1], "diag"), 0);
+	zassert_equal(sink.records, 2);
+	zassert_equal(sink.packed[1], 2);
+	zassert_equal(sink.latest[0], 3);
+
+	/* Sent in time, nothing else expires */
+	zassert_ok(uplink_batch_poll(&batch, 2000));
+	zassert_equal(sink.expired_calls, 1);
+	zassert_equal(uplink_batch_expiry(&batch), UPLINK_BATCH_NO_DEADLINE);
+
+	uplink_batch_stats_get(&batch, &stats);
+	zassert_equal(stats.expired, 1);
+}
+
+/**
+ * @brief An expired prefix comes out as its own array, the rest is moved up
+ *
+ */
+ZTEST(uplink_batch_tests, test_deadline_split)
+{
+	uint8_t rec[] = {1, 2, 3};
+
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec[0], 1, TEST_PRIO, 100, 0));
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec[1], 1, TEST_PRIO, 200, 0));
+	zassert_ok(uplink_batch_put(&batch, "gps", &rec[2], 1, TEST_PRIO, 900, 0));
+
+	zassert_ok(uplink_batch_poll(&batch, 200));
+	zassert_equal(sink.expired_records, 2);
+	zassert_equal(uplink_batch_expiry(&batch), 900);
+
+	zassert_ok(uplink_batch_flush(&batch, UPLINK_BATCH_FLUSH_MANUAL));
+	zassert_equal(sink.records, 1);
+	zassert_equal(sink.len, 2);
+	zassert_equal(sink.packed[0], 0x81);
+	zassert_equal(sink.packed[1], 3);
+	zassert_equal(sink.latest_len, 1);
+	zassert_equal(sink.latest[0], 3);
+}
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/uplink_frame/uplink_frame.h>
+
+#define TEST_FRAME_SIZE 64
+
+static uint8_t buf[TEST_FRAME_SIZE];
+static struct uplink_frame frame;
+
+static void uplink_frame_before(void *f)
+{
+	memset(buf, 0, sizeof(buf));
+	uplink_frame_init(&frame, buf, sizeof(buf));
+}
+
+ZTEST_SUITE(uplink_frame_tests, NULL, NULL, uplink_frame_before, NULL, NULL);
+
+/**
+ * @brief Records come back out as they went in, behind a version byte and
+ * a one byte length each
+ *
+ */
+ZTEST(uplink_frame_tests, test_roundtrip)
+{
+	uint8_t a[] = {0x01, 0x02, 0x03};
+	uint8_t b[] = {0x04};
+	const uint8_t *p_record;
+	size_t len, offset = 0;
+
+	zassert_ok(uplink_frame_add(&frame, a, sizeof(a)));
+	zassert_ok(uplink_frame_add(&frame, b, sizeof(b)));
+
+	zassert_equal(frame.count, 2);
+	zassert_equal(frame.used, 1 + 1 + sizeof(a) + 1 + sizeof(b));
+	zassert_equal(buf[0], UPLINK_FRAME_VERSION);
+	zassert_equal(buf[1], sizeof(a));
+
+	zassert_ok(uplink_frame_next(buf, frame.used, &offset, &p_record, &len));
+	zassert_equal(len, sizeof(a));
+	zassert_mem_equal(p_record, a, sizeof(a));
+
+	/* Points into the frame */
+	zassert_equal_ptr(p_record, &buf[2]);
+
+	zassert_ok(uplink_frame_next(buf, frame.used, &offset, &p_record, &len));
+	zassert_equal(len, sizeof(b));
+	zassert_equal(p_record[0], b[0]);
+
+	zassert_equal(uplink_frame_next(buf, frame.used, &offset, &p_record, &len), -ENOENT);
+
+	/* Empty again. Just the version. */
+	uplink_frame_reset(&frame);
+	zassert_equal(frame.used, 1);
+	zassert_equal(frame.count, 0);
+
+	offset = 0;
+	zassert_equal(uplink_frame_next(buf, frame.used, &offset, &p_record, &len), -ENOENT);
+}
+
+/**
+ * @brief Lengths from 128 up take two bytes
+ *
+ */
+ZTEST(uplink_frame_tests, test_long)
+{
+	static uint8_t big_buf[UPLINK_FRAME_BOUND(300)];
+	static uint8_t record[300];
+	struct uplink_frame big;
+	const uint8_t *p_record;
+	size_t len, offset = 0;
+
+	for (int i = 0; i < sizeof(record); i++)
+		record[i] = i;
+
+	uplink_frame_init(&big, big_buf, sizeof(big_buf));
+
+	zassert_ok(uplink_frame_add(&big, record, sizeof(record)));
+	zassert_equal(big.used, sizeof(big_buf));
+
+	/* 300 = 0b10 0101100 */
+	zassert_equal(big_buf[1], 0x80 | 44);
+	zassert_equal(big_buf[2], 2);
+
+	zassert_ok(uplink_frame_next(big_buf, big.used, &offset, &p_record, &len));
+	zassert_equal(len, sizeof(record));
+	zassert_mem_equal(p_record, record, sizeof(record));
+
+	/* Exactly full */
+	zassert_equal(uplink_frame_add(&big, record, 1), -ENOSPC);
+}
+
+/**
+ * @brief A full frame turns records away until it's reset. Records that
+ * never fit are told apart.
+ *
+ */
+ZTEST(uplink_frame_tests, test_full)
+{
+	uint8_t record[30] = {0};
+
+	/* 1 + 31 + 31 */
+	zassert_ok(uplink_frame_add(&frame, record, sizeof(record)));
+	zassert_ok(uplink_frame_add(&frame, record, sizeof(record)));
+	zassert_equal(uplink_frame_add(&frame, record, 1), -ENOSPC);
+	zassert_equal(frame.count, 2);
+
+	uplink_frame_reset(&frame);
+	zassert_ok(uplink_frame_add(&frame, record, 1));
+
+	uint8_t big[TEST_FRAME_SIZE];
+	zassert_equal(uplink_frame_add(&frame, big, sizeof(big)), -EMSGSIZE);
+	zassert_equal(uplink_frame_add(&frame, big, 0), -EMSGSIZE);
+}
+
+/**
+ * @brief Truncated frames and other versions are rejected
+ *
+ */
+ZTEST(uplink_frame_tests, test_corrupt)
+{
+	uint8_t record[] = {0x01, 0x02, 0x03};
+	const uint8_t *p_record;
+	size_t len, offset = 0;
+
+	zassert_ok(uplink_frame_add(&frame, record, sizeof(record)));
+
+	/* Cut short */
+	zassert_equal(uplink_frame_next(buf, frame.used - 1, &offset, &p_record, &len), -EBADMSG);
+
+	/* Nothing but the start of a two byte length */
+	uint8_t half[] = {UPLINK_FRAME_VERSION, 0x80};
+	offset = 0;
+	zassert_equal(uplink_frame_next(half, sizeof(half), &offset, &p_record, &len), -EBADMSG);
+
+	buf[0] = UPLINK_FRAME_VERSION + 1;
+	offset = 0;
+	zassert_equal(uplink_frame_next(buf, frame.used, &offset, &p_record, &len), -EBADMSG);
+}
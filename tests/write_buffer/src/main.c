@@ -0,0 +1,195 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include <lib/write_buffer/write_buffer.h>
+
+#define TEST_PAGE_SIZE 64
+
+static uint8_t page[TEST_PAGE_SIZE];
+static struct write_buffer wb;
+
+/* What the flush callback saw */
+static struct
+{
+	uint8_t data[TEST_PAGE_SIZE * 4];
+	size_t len;
+	int calls;
+	int records;
+	int err;
+
+	/* Records that make it before err */
+	int partial;
+} sink;
+
+static int test_flush(const uint8_t *p_data, size_t len, size_t *p_done, void *p_user)
+{
+	size_t pos = 0;
+	const uint8_t *p_rec;
+	size_t rec_len;
+	int taken = 0;
+
+	if (sink.err && sink.partial == 0)
+		return sink.err;
+
+	sink.calls++;
+
+	while (write_buffer_next(p_data, len, &pos, &p_rec, &rec_len) == 0)
+	{
+		memcpy(&sink.data[sink.len], p_rec, rec_len);
+		sink.len += rec_len;
+		sink.records++;
+		*p_done = pos;
+
+		if (sink.err && ++taken == sink.partial)
+			return sink.err;
+	}
+
+	return 0;
+}
+
+static void write_buffer_before(void *f)
+{
+	memset(&sink, 0, sizeof(sink));
+	write_buffer_init(&wb, page, sizeof(page), 1000, test_flush, NULL);
+}
+
+ZTEST_SUITE(write_buffer_tests, NULL, NULL, write_buffer_before, NULL, NULL);
+
+/**
+ * @brief Records are held until the page is full
+ *
+ * Six 8 byte records take 60 of the 64 bytes. The seventh doesn't fit so
+ * the first six go out in a single flush.
+ *
+ */
+ZTEST(write_buffer_tests, test_size)
+{
+	uint8_t rec[8];
+	struct write_buffer_stats stats;
+
+	for (int i = 0; i < 7; i++)
+	{
+		memset(rec, i, sizeof(rec));
+		zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+	}
+
+	zassert_equal(sink.calls, 1);
+	zassert_equal(sink.records, 6);
+	zassert_equal(sink.data[5 * sizeof(rec)], 5);
+
+	/* The last one is still buffered */
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_RESET), 0);
+	zassert_equal(sink.records, 7);
+	zassert_equal(sink.data[6 * sizeof(rec)], 6);
+
+	write_buffer_stats_get(&wb, &stats);
+	zassert_equal(stats.records, 7);
+	zassert_equal(stats.flushes, 2);
+	zassert_equal(stats.bytes_flushed, 7 * (sizeof(rec) + 2));
+	zassert_equal(stats.reasons[WRITE_BUFFER_FLUSH_SIZE], 1);
+	zassert_equal(stats.reasons[WRITE_BUFFER_FLUSH_RESET], 1);
+
+	/* Nothing left to flush */
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_RESET), 0);
+	zassert_equal(sink.calls, 2);
+
+	/* Never fits */
+	uint8_t big[TEST_PAGE_SIZE];
+	zassert_equal(write_buffer_put(&wb, big, sizeof(big), 0), -EMSGSIZE);
+}
+
+/**
+ * @brief A page filled exactly is flushed right away
+ *
+ */
+ZTEST(write_buffer_tests, test_exact)
+{
+	uint8_t rec[TEST_PAGE_SIZE / 2 - 2] = {0};
+
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+	zassert_equal(sink.calls, 0);
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+	zassert_equal(sink.calls, 1);
+	zassert_equal(sink.records, 2);
+}
+
+/**
+ * @brief Age is measured from the oldest buffered record
+ *
+ */
+ZTEST(write_buffer_tests, test_age)
+{
+	uint8_t rec[4] = {0};
+
+	zassert_equal(write_buffer_poll(&wb, 5000), 0);
+	zassert_equal(sink.calls, 0);
+
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 100), 0);
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 900), 0);
+
+	zassert_equal(write_buffer_poll(&wb, 1099), 0);
+	zassert_equal(sink.calls, 0);
+
+	zassert_equal(write_buffer_poll(&wb, 1100), 0);
+	zassert_equal(sink.calls, 1);
+	zassert_equal(sink.records, 2);
+}
+
+/**
+ * @brief Records survive a failed flush
+ *
+ */
+ZTEST(write_buffer_tests, test_flush_error)
+{
+	uint8_t rec[40] = {1};
+	struct write_buffer_stats stats;
+
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+
+	sink.err = -EIO;
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), -EIO);
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_BATTERY), -EIO);
+
+	sink.err = 0;
+	zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_BATTERY), 0);
+	zassert_equal(sink.records, 2);
+
+	write_buffer_stats_get(&wb, &stats);
+	zassert_equal(stats.flush_errors, 2);
+	zassert_equal(stats.records, 2);
+}
+
+/**
+ * @brief Records written before a failure are dropped, the rest are kept
+ *
+ */
+ZTEST(write_buffer_tests, test_flush_partial)
+{
+	uint8_t rec[8];
+	struct write_buffer_stats stats;
+
+	for (int i = 0; i < 3; i++)
+	{
+		memset(rec, i, sizeof(rec));
+		zassert_equal(write_buffer_put(&wb, rec, sizeof(rec), 0), 0);
+	}
+
+	sink.err = -EIO;
+	sink.partial = 1;
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_RESET), -EIO);
+	zassert_equal(sink.records, 1);
+
+	/* Only the two that didn't make it go again */
+	sink.err = 0;
+	zassert_equal(write_buffer_flush(&wb, WRITE_BUFFER_FLUSH_RESET), 0);
+	zassert_equal(sink.records, 3);
+	zassert_equal(sink.data[0], 0);
+	zassert_equal(sink.data[sizeof(rec)], 1);
+	zassert_equal(sink.data[2 * sizeof(rec)], 2);
+
+	write_buffer_stats_get(&wb, &stats);
+	zassert_equal(stats.flush_errors, 1);
+	zassert_equal(stats.bytes_flushed, 3 * (sizeof(rec) + 2));
+}